@@ -12,6 +12,8 @@
 // Color formats
 #define PR_UBYTE_RGB        0x00000001
 //#define PR_UBYTE_RGBA       0x00000002
+#define PR_UBYTE_RGB_PALETTE4   0x00000003
+#define PR_UBYTE_RGB_BLOCK      0x00000004
 
 // prGetString arguments
 #define PR_STRING_VERSION   0x00000011
@@ -40,13 +42,23 @@
 #define PR_POLYGON_LINE     0x00000054
 #define PR_POLYGON_POINT    0x00000055
 
+// Index formats
+#define PR_UBYTE            0x00000070
+#define PR_USHORT           0x00000071
+#define PR_UINT             0x00000072
+
 // prGetTexLevelParameteri arguments
 #define PR_TEXTURE_WIDTH    0x00000060
 #define PR_TEXTURE_HEIGHT   0x00000061
 
 // States
-#define PR_SCISSOR          0
-#define PR_MIP_MAPPING      1
+#define PR_SCISSOR                  0
+#define PR_MIP_MAPPING              1
+#define PR_TILE_BINNING             2
+#define PR_HALF_SPACE_RASTERIZER    3
+#define PR_FAST_CLEAR               4
+#define PR_GUARD_BAND               5
+#define PR_TEXTURE_TILING           6
 
 // Texture environment parameters
 #define PR_TEXTURE_LOD_BIAS 0
@@ -31,10 +31,10 @@ PRboolean prInit();
 //! Releases the pico renderer.
 PRboolean prRelease();
 
-//! Returns the last error. By default PR_ERROR_NONE.
+//! Returns the last error of the calling thread. By default PR_ERROR_NONE.
 PRenum prGetError();
 
-//! Sets the error event handler.
+//! Sets the error event handler for the calling thread.
 void prErrorHandler(PR_ERROR_HANDLER_PROC errorHandler);
 
 /**
@@ -72,8 +72,11 @@ This must be generated by 'prCreateContext'.
 void prDeleteContext(PRobject context);
 
 /**
-Makes the specified context to the current context.
+Makes the specified context to the current context of the calling thread.
 By default each new created context will be the new current context.
+\remarks Each thread has its own current context, so several threads can render concurrently,
+as long as each thread uses its own context and frame buffer (see PR_THREAD_LOCAL_CONTEXT in "static_config.h").
+Resources like textures and vertex buffers can be shared, but must not be modified while they are in use by another thread.
 \param[in] context Specifies the new current context, which was created with a call to prCreateContext.
 \see prCreateContext
 */
@@ -152,7 +155,10 @@ Sets the 2D image data to the specified texture.
 \param[in] texture Specifies the texture whose image data is to be set.
 \param[in] width Specifies the image width. This will be the final texture width.
 \param[in] height Specifies the image height. This will be the final texture height.
-\param[in] format Specifies the image data format. This must be PR_UBYTE_RGB.
+\param[in] format Specifies the image data format. This must be PR_UBYTE_RGB, PR_UBYTE_RGB_PALETTE4, or PR_UBYTE_RGB_BLOCK.
+The image data is always in RGB format, but with PR_UBYTE_RGB_PALETTE4 the texels are stored with 4 bits per texel
+and a palette of 16 colors per texture, and with PR_UBYTE_RGB_BLOCK the texels are stored in blocks of 4x4 texels
+with two colors each (2 bits per texel). Such textures are never tiled or dithered, and sub-images can not be set.
 \param[in] data Raw pointer to the image data. This must be in the format: PRubyte[width*height*3].
 \param[in] dither Specifies whether dithering is to be applied to the image (to compensate 8-bit colors).
 \param[in] generateMips Specifies whether MIP maps are to be generated for this texture.
@@ -162,6 +168,60 @@ void prTexImage2D(
     const PRvoid* data, PRboolean dither, PRboolean generateMips
 );
 
+/**
+Sets the 2D image data of all layers to the specified texture array. The layers are stacked vertically inside the texture,
+and the integer part of the V texture coordinate selects the layer, i.e. V in [i, i + 1) samples from layer i,
+so that a single draw call can use all layers (texture coordinates must not repeat vertically).
+\param[in] texture Specifies the texture whose image data is to be set.
+\param[in] width Specifies the width of each layer.
+\param[in] height Specifies the height of each layer. The total height (height*layers) must not exceed PR_MAX_TEXTURE_SIZE.
+\param[in] layers Specifies the number of layers. This must be greater than 0.
+\param[in] format Specifies the image data format (see prTexImage2D).
+\param[in] data Raw pointer to the image data of all layers, one after another. This must be in the format: PRubyte[width*height*layers*3].
+\param[in] dither Specifies whether dithering is to be applied to the image (to compensate 8-bit colors).
+\param[in] generateMips Specifies whether MIP maps are to be generated for this texture.
+MIP maps are only generated as long as the layer height can be halved, so that layers are never mixed.
+\see prTexImage2D
+\see prTexRegion
+*/
+void prTexArrayImage2D(
+    PRobject texture, PRtexsize width, PRtexsize height, PRtexsize layers, PRenum format,
+    const PRvoid* data, PRboolean dither, PRboolean generateMips
+);
+
+/**
+Sets the texture region for the next draw calls, i.e. the sub-rectangle of an atlas texture into which
+the texture coordinates in [0, 1] are mapped. Draw calls with different regions of the same texture
+can then be batched, e.g. in a command buffer, and the integer part of the V texture coordinate steps by the region height,
+so a single draw call can also use several regions which are stacked vertically.
+\param[in] x Specifies the left position of the region (in texels of the first MIP-map).
+\param[in] y Specifies the top position of the region (in texels of the first MIP-map).
+\param[in] width Specifies the region width.
+\param[in] height Specifies the region height. If the width or height is zero, the whole texture
+(or the first layer of a texture array) is used. By default the width and height are zero.
+\remarks The region is independent of the bound texture. Texture coordinates outside [0, 1] sample the texels around the region.
+\see prTexArrayImage2D
+*/
+void prTexRegion(PRint x, PRint y, PRint width, PRint height);
+
+/**
+Sets the image data of a rectangular region inside the specified texture MIP-map.
+\param[in] texture Specifies the texture whose image data is to be set.
+\param[in] mipLevel Specifies the MIP-map level.
+\param[in] x Specifies the left position of the region.
+\param[in] y Specifies the top position of the region.
+\param[in] width Specifies the region width. The region must be inside the MIP-map.
+\param[in] height Specifies the region height. The region must be inside the MIP-map.
+\param[in] format Specifies the image data format. This must be PR_UBYTE_RGB.
+\param[in] data Raw pointer to the image data. This must be in the format: PRubyte[width*height*3].
+\param[in] dither Specifies whether dithering is to be applied to the image (to compensate 8-bit colors).
+\see prTexImage2D
+*/
+void prTexSubImage2D(
+    PRobject texture, PRubyte mipLevel, PRtexsize x, PRtexsize y, PRtexsize width, PRtexsize height,
+    PRenum format, const PRvoid* data, PRboolean dither
+);
+
 /**
 Sets the 2D image data from file to the specified texture.
 \param[in] texture Specifies the texture whose image data is to be set.
@@ -172,6 +232,71 @@ Sets the 2D image data from file to the specified texture.
 */
 void prTexImage2DFromFile(PRobject texture, const char* filename, PRboolean dither, PRboolean generateMips);
 
+/**
+Starts loading the 2D image data from file into the specified texture on a background thread and returns immediately.
+Until the image is loaded, the texture has no image data and is drawn with the current color (see prColor), like an unbound texture.
+The loaded image data is taken over by the first draw call with this texture after the load is done, or by 'prIsTexImageLoaded' or 'prWaitTexImage'.
+\param[in] texture Specifies the texture whose image data is to be set. Its previous image data is released immediately.
+\param[in] filename Specifies the image filename. Valid image file formats are: BMP, PNG, TGA, JPEG (base line only).
+\param[in] dither Specifies whether dithering is to be applied to the image (to compensate 8-bit colors).
+\param[in] generateMips Specifies whether MIP maps are to be generated for this texture.
+\remarks The PR_TEXTURE_TILING state is taken when this function is called. Setting new image data or deleting the texture cancels the load.
+\see prTexImage2DFromFile
+\see prIsTexImageLoaded
+\see prWaitTexImage
+*/
+void prTexImage2DFromFileAsync(PRobject texture, const char* filename, PRboolean dither, PRboolean generateMips);
+
+/**
+Returns PR_TRUE if the image data of the specified texture is loaded, i.e. if it has no pending load (see prTexImage2DFromFileAsync).
+This does not block; if the load is done, its image data is taken over by the texture.
+\param[in] texture Specifies the texture whose image load is to be queried.
+\see prWaitTexImage
+*/
+PRboolean prIsTexImageLoaded(PRobject texture);
+
+/**
+Blocks until the pending image load of the specified texture is done and takes over its image data (see prTexImage2DFromFileAsync).
+\param[in] texture Specifies the texture whose image load is to be waited for.
+\see prIsTexImageLoaded
+*/
+void prWaitTexImage(PRobject texture);
+
+/**
+Sets the virtual texture file to the specified texture. Virtual textures can be larger than PR_MAX_TEXTURE_SIZE
+(up to 16384x16384 texels) and their MIP levels are paged in on demand, in pages of 128x128 texels.
+Only the coarse MIP levels which fit into a single page are always resident; when a page is missing,
+it is sampled from the next coarser MIP level whose page is resident, until the page is loaded with 'prUpdateVirtualTexture'.
+\param[in] texture Specifies the texture whose image data is to be set.
+\param[in] filename Specifies the virtual texture filename. This must be written by 'prWriteVirtualTextureFile'.
+\param[in] numCachePages Specifies the number of pages in the page cache, which bounds the memory of the texture
+(each page takes 128*128 color indices). This must be greater than 0.
+\see prUpdateVirtualTexture
+\see prWriteVirtualTextureFile
+*/
+void prTexVirtualImage2DFromFile(PRobject texture, const char* filename, PRuint numCachePages);
+
+/**
+Loads all pages of the specified virtual texture, which were missing while drawing since the last update.
+Pages are loaded from the coarsest to the finest MIP level. If the page cache is full, the least recently used pages are evicted,
+but never the pages which were used since the last update (the remaining pages are loaded with the next updates).
+\param[in] texture Specifies the virtual texture whose pages are to be loaded.
+\remarks This should be called once per frame, after all draw calls (and outside of command buffers).
+\see prTexVirtualImage2DFromFile
+*/
+void prUpdateVirtualTexture(PRobject texture);
+
+/**
+Writes the specified image with all its MIP levels into a virtual texture file.
+\param[in] filename Specifies the virtual texture filename.
+\param[in] width Specifies the image width. This must be in the range [1, 16384].
+\param[in] height Specifies the image height. This must be in the range [1, 16384].
+\param[in] data Raw pointer to the image data. This must be in the format: PRubyte[width*height*3].
+\return PR_TRUE on success, otherwise PR_FALSE.
+\see prTexVirtualImage2DFromFile
+*/
+PRboolean prWriteVirtualTextureFile(const char* filename, PRuint width, PRuint height, const PRubyte* data);
+
 /**
 Sets the texture environment parameters.
 \param[in] param Specifies the paramer whose value is to be set. Valid values are:
@@ -238,6 +363,12 @@ Reads and sets the vertex buffer data from the specified file.
 // File format:
 numVertices: 16-bit unsigned integer
 vertices[numVertices]: 'numVertices' * (five 32-bit floating point values for: x, y, z, u, v) (see 'PRvertex').
+
+// File format for more than 65534 vertices:
+0xffff: 16-bit unsigned integer
+0xffffffff: 32-bit unsigned integer (magic number, which distinguishes this header from files with exactly 65535 vertices)
+numVertices: 32-bit unsigned integer
+vertices[numVertices]: (see above).
 \endcode
 \see PRvertex
 */
@@ -271,10 +402,12 @@ void prDeleteIndexBuffer(PRobject indexBuffer);
 /**
 Sets the index buffer data.
 \param[in] indexBuffer Specifies the index buffer whose vertex data is to be set.
-\param[in] indices Pointer to the index data. Only 16-bit unsigned integers are allowed as vertex indices.
+\param[in] indices Pointer to the index data.
 \param[in] numIndices Specifies the number of indices. The array 'indices' must be large enough!
+\param[in] format Specifies the index format. Valid values are: PR_UBYTE (8-bit), PR_USHORT (16-bit) and PR_UINT (32-bit).
+Smaller indices need less memory, 32-bit indices are required for more than 65536 vertices.
 */
-void prIndexBufferData(PRobject indexBuffer, const PRushort* indices, PRsizei numIndices);
+void prIndexBufferData(PRobject indexBuffer, const PRvoid* indices, PRsizei numIndices, PRenum format);
 
 /**
 Reads and sets the index buffer data from the specified file.
@@ -285,10 +418,29 @@ Reads and sets the index buffer data from the specified file.
 // File format:
 numIndices: 16-bit unsigned integer
 indices[numVertices]: 'numIndices' * (16-bit unsigned integer).
+
+// File format for other index formats or more than 65534 indices:
+0xffff: 16-bit unsigned integer
+0xffffffff: 32-bit unsigned integer (magic number, which distinguishes this header from files with exactly 65535 indices)
+indexSize: 8-bit unsigned integer (1, 2 or 4 bytes per index)
+numIndices: 32-bit unsigned integer
+indices[numIndices]: 'numIndices' * ('indexSize' bytes unsigned integer).
 \endcode
 */
 void prIndexBufferDataFromFile(PRobject indexBuffer, PRsizei* numIndices, FILE* file);
 
+/**
+Loads the vertex buffer data and index buffer data from the specified .pico file. The file is mapped into memory
+and converted at once, which is much faster than 'prVertexBufferDataFromFile' and 'prIndexBufferDataFromFile' for large meshes.
+\param[in] vertexBuffer Specifies the vertex buffer whose vertex data is to be set.
+\param[in] indexBuffer Specifies the index buffer whose index data is to be set. If this is zero, only the vertex data is loaded.
+\param[out] numVertices Specifies the resulting number of vertices.
+\param[out] numIndices Specifies the resulting number of indices. This may be null if 'indexBuffer' is zero.
+\param[in] filename Specifies the filename of the mesh. The file contains the vertex data (see 'prVertexBufferDataFromFile')
+followed by the index data (see 'prIndexBufferDataFromFile').
+*/
+void prMeshDataFromFile(PRobject vertexBuffer, PRobject indexBuffer, PRsizei* numVertices, PRsizei* numIndices, const char* filename);
+
 /**
 Binds the specified index buffer.
 \param[in] indexBuffer Specifies the index buffer which is to be bound.
@@ -378,6 +530,17 @@ void prLoadIdentity(PRfloat* matrix4x4);
 Sets the specified state.
 \param[in] cap Specifies the capability whose state is to be changed. Valid values are:
 - PR_SCISSOR - Enables/disables the scissor rectangle (see prScissor). By default PR_FALSE.
+- PR_MIP_MAPPING - Enables/disables MIP-mapping for textured polygons. By default PR_FALSE.
+- PR_TILE_BINNING - Enables/disables tile binning for filled triangles. Triangles are then binned
+into screen tiles and the tiles are rasterized in parallel by worker threads at the end of each draw call. By default PR_FALSE.
+- PR_HALF_SPACE_RASTERIZER - Enables/disables the half-space rasterizer for filled triangles. Instead of scanlines,
+the triangles are rasterized with edge functions in blocks of 8x8 pixels. By default PR_FALSE.
+- PR_FAST_CLEAR - Enables/disables fast clears. prClearFrameBuffer then only marks the screen tiles as cleared,
+and each tile is cleared when it is drawn to the first time. Untouched tiles are presented directly with the clear color. By default PR_FALSE.
+- PR_GUARD_BAND - Enables/disables guard-band clipping for filled polygons. Polygons inside the guard band around the
+clipping rectangle are not clipped, instead the rasterizer only writes the pixels inside the clipping rectangle. By default PR_FALSE.
+- PR_TEXTURE_TILING - Enables/disables tiled texel storage for textures whose image data is set afterwards (see prTexImage2D).
+The texels are then stored in small square tiles instead of rows, which is faster for polygons that are sampled steeply. By default PR_FALSE.
 \param[in] state Specifies the new state.
 \see prEnable
 \see prDisable
@@ -472,19 +635,60 @@ PR_POINTS, PR_LINES, PR_LINE_STRIP, PR_LINE_LOOP, PR_TRIANGLES, PR_TRIANGLE_STRI
 \remarks A vertex buffer must be bound.
 \see prBindVertexBuffer
 */
-void prDraw(PRenum primitives, PRushort numVertices, PRushort firstVertex);
+void prDraw(PRenum primitives, PRsizei numVertices, PRsizei firstVertex);
 
 /**
 Draws the specified amount of primitives.
 \param[in] primitives Specifies the primitive types. Valid values are:
 PR_POINTS, PR_LINES, PR_LINE_STRIP, PR_LINE_LOOP, PR_TRIANGLES, PR_TRIANGLE_STRIP, PR_TRIANGLE_FAN.
-\param[in] numVertices Specifies the number of vertices to draw.
-\param[in] firstVertex Specifies the first vertex to draw.
+\param[in] numVertices Specifies the number of indices to draw.
+\param[in] firstVertex Specifies the first index to draw.
 \remarks A vertex buffer and an index buffer must be bound.
 \see prBindVertexBuffer
 \see prBindIndexBuffer
 */
-void prDrawIndexed(PRenum primitives, PRushort numVertices, PRushort firstVertex);
+void prDrawIndexed(PRenum primitives, PRsizei numVertices, PRsizei firstVertex);
+
+// --- command buffer --- //
+
+/**
+Creates a new command buffer. A command buffer records state changes and draw calls,
+which can then be submitted any number of times.
+\remarks The command buffer must be deleted with 'prDeleteCommandBuffer'.
+\see prBeginCommandBuffer
+\see prSubmitCommandBuffer
+*/
+PRobject prCreateCommandBuffer();
+
+//! Deletes the specified command buffer.
+void prDeleteCommandBuffer(PRobject commandBuffer);
+
+/**
+Discards all previous commands of the specified command buffer and starts recording into it.
+Until 'prEndCommandBuffer' is called, the following functions are recorded instead of being executed:
+prBindFrameBuffer, prClearFrameBuffer, prBindTexture, prTexRegion, prTexEnvi, prBindVertexBuffer, prBindIndexBuffer,
+prProjectionMatrix, prViewMatrix, prWorldMatrix, prSetState, prEnable, prDisable, prViewport, prScissor,
+prDepthRange, prCullMode, prPolygonMode, prClearColor, prColor, prDrawScreenPoint, prDrawScreenLine,
+prDrawScreenImage, prDraw and prDrawIndexed.
+\remarks Objects are recorded by reference, so they must not be deleted while the command buffer is in use.
+The immediate mode (prBegin/prEnd) can not be recorded.
+\see prEndCommandBuffer
+*/
+void prBeginCommandBuffer(PRobject commandBuffer);
+
+/**
+Finishes recording of the current command buffer. Redundant state changes are removed
+and consecutive draw calls over adjacent vertex ranges are merged.
+*/
+void prEndCommandBuffer();
+
+/**
+Executes all commands of the specified command buffer with the current context.
+The states which are set by the command buffer remain active after submission.
+\remarks Filled triangles of consecutive draw calls are rasterized together, when the PR_TILE_BINNING state is enabled.
+A recorded command buffer can be submitted from any thread, as long as it is not recorded at the same time.
+*/
+void prSubmitCommandBuffer(PRobject commandBuffer);
 
 // --- immediate mode --- //
 
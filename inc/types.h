@@ -40,6 +40,9 @@ typedef int PRint;
 //! 32-bit unsigned integer.
 typedef unsigned int PRuint;
 
+//! 64-bit signed integer.
+typedef long long PRlong;
+
 //! 32-bit floating-point.
 typedef float PRfloat;
 //! 64-bit floating-point.
@@ -11,6 +11,7 @@
 #include "framebuffer.h"
 #include "vertexbuffer.h"
 #include "indexbuffer.h"
+#include "mesh_file.h"
 #include "texture.h"
 #include "image.h"
 #include "state_machine.h"
@@ -21,6 +22,14 @@
 #include <string.h>
 
 
+// Returns a new command for the command buffer which is currently recorded, or null if no command buffer is recorded.
+static pr_command* _record_command(PRenum opcode)
+{
+    if (PR_STATE_MACHINE.recordCommandBuffer != NULL)
+        return _pr_command_buffer_append(PR_STATE_MACHINE.recordCommandBuffer, opcode);
+    return NULL;
+}
+
 // --- common --- //
 
 PRboolean prInit()
@@ -33,6 +42,7 @@ PRboolean prInit()
 PRboolean prRelease()
 {
     _pr_global_state_release();
+    _pr_state_machine_release_null();
     return PR_TRUE;
 }
 
@@ -110,12 +120,24 @@ void prDeleteFrameBuffer(PRobject frameBuffer)
 
 void prBindFrameBuffer(PRobject frameBuffer)
 {
-    _pr_state_machine_bind_framebuffer((pr_framebuffer*)frameBuffer);
+    pr_command* command = _record_command(PR_COMMAND_BIND_FRAMEBUFFER);
+    if (command != NULL)
+        command->args.object = frameBuffer;
+    else
+        _pr_state_machine_bind_framebuffer((pr_framebuffer*)frameBuffer);
 }
 
 void prClearFrameBuffer(PRobject frameBuffer, PRfloat clearDepth, PRbitfield clearFlags)
 {
-    _pr_framebuffer_clear((pr_framebuffer*)frameBuffer, clearDepth, clearFlags);
+    pr_command* command = _record_command(PR_COMMAND_CLEAR_FRAMEBUFFER);
+    if (command != NULL)
+    {
+        command->args.clear.frameBuffer = frameBuffer;
+        command->args.clear.depth       = clearDepth;
+        command->args.clear.flags       = clearFlags;
+    }
+    else
+        _pr_framebuffer_clear((pr_framebuffer*)frameBuffer, clearDepth, clearFlags);
 }
 
 // --- texture --- //
@@ -132,7 +154,11 @@ void prDeleteTexture(PRobject texture)
 
 void prBindTexture(PRobject texture)
 {
-    _pr_state_machine_bind_texture((pr_texture*)texture);
+    pr_command* command = _record_command(PR_COMMAND_BIND_TEXTURE);
+    if (command != NULL)
+        command->args.object = texture;
+    else
+        _pr_state_machine_bind_texture((pr_texture*)texture);
 }
 
 void prTexImage2D(
@@ -142,6 +168,37 @@ void prTexImage2D(
     _pr_texture_image2d((pr_texture*)texture, width, height, format, data, dither, generateMips);
 }
 
+void prTexArrayImage2D(
+    PRobject texture, PRtexsize width, PRtexsize height, PRtexsize layers, PRenum format,
+    const PRvoid* data, PRboolean dither, PRboolean generateMips)
+{
+    _pr_texture_array_image2d(
+        (pr_texture*)texture, width, height, layers, format, data, dither, generateMips,
+        _pr_state_machine_get_state(PR_TEXTURE_TILING)
+    );
+}
+
+void prTexRegion(PRint x, PRint y, PRint width, PRint height)
+{
+    pr_command* command = _record_command(PR_COMMAND_TEXTURE_REGION);
+    if (command != NULL)
+    {
+        command->args.rect.x1 = x;
+        command->args.rect.y1 = y;
+        command->args.rect.x2 = width;
+        command->args.rect.y2 = height;
+    }
+    else
+        _pr_state_machine_texture_region(x, y, width, height);
+}
+
+void prTexSubImage2D(
+    PRobject texture, PRubyte mipLevel, PRtexsize x, PRtexsize y, PRtexsize width, PRtexsize height,
+    PRenum format, const PRvoid* data, PRboolean dither)
+{
+    _pr_texture_subimage2d((pr_texture*)texture, mipLevel, x, y, width, height, format, data, dither);
+}
+
 void prTexImage2DFromFile(
     PRobject texture, const char* filename, PRboolean dither, PRboolean generateMips)
 {
@@ -160,9 +217,47 @@ void prTexImage2DFromFile(
     _pr_image_delete(image);
 }
 
+void prTexImage2DFromFileAsync(
+    PRobject texture, const char* filename, PRboolean dither, PRboolean generateMips)
+{
+    _pr_texture_image2d_from_file_async((pr_texture*)texture, filename, dither, generateMips);
+}
+
+PRboolean prIsTexImageLoaded(PRobject texture)
+{
+    return _pr_texture_finish_load((pr_texture*)texture, PR_FALSE);
+}
+
+void prWaitTexImage(PRobject texture)
+{
+    _pr_texture_finish_load((pr_texture*)texture, PR_TRUE);
+}
+
+void prTexVirtualImage2DFromFile(PRobject texture, const char* filename, PRuint numCachePages)
+{
+    _pr_texture_virtual_image2d((pr_texture*)texture, filename, numCachePages);
+}
+
+void prUpdateVirtualTexture(PRobject texture)
+{
+    _pr_texture_update_virtual((pr_texture*)texture);
+}
+
+PRboolean prWriteVirtualTextureFile(const char* filename, PRuint width, PRuint height, const PRubyte* data)
+{
+    return _pr_virtual_texture_write(filename, width, height, data);
+}
+
 void prTexEnvi(PRenum param, PRint value)
 {
-    _pr_state_machine_set_texenvi(param, value);
+    pr_command* command = _record_command(PR_COMMAND_TEXENVI);
+    if (command != NULL)
+    {
+        command->args.param.param = param;
+        command->args.param.value = value;
+    }
+    else
+        _pr_state_machine_set_texenvi(param, value);
 }
 
 PRint prGetTexLevelParameteri(PRobject texture, PRubyte mipLevel, PRenum param)
@@ -194,7 +289,11 @@ void prVertexBufferDataFromFile(PRobject vertexBuffer, PRsizei* numVertices, FIL
 
 void prBindVertexBuffer(PRobject vertexBuffer)
 {
-    _pr_state_machine_bind_vertexbuffer((pr_vertexbuffer*)vertexBuffer);
+    pr_command* command = _record_command(PR_COMMAND_BIND_VERTEXBUFFER);
+    if (command != NULL)
+        command->args.object = vertexBuffer;
+    else
+        _pr_state_machine_bind_vertexbuffer((pr_vertexbuffer*)vertexBuffer);
 }
 
 // --- indexbuffer --- //
@@ -209,9 +308,9 @@ void prDeleteIndexBuffer(PRobject indexBuffer)
     _pr_indexbuffer_delete((pr_indexbuffer*)indexBuffer);
 }
 
-void prIndexBufferData(PRobject indexBuffer, const PRushort* indices, PRsizei numIndices)
+void prIndexBufferData(PRobject indexBuffer, const PRvoid* indices, PRsizei numIndices, PRenum format)
 {
-    _pr_indexbuffer_data((pr_indexbuffer*)indexBuffer, indices, numIndices);
+    _pr_indexbuffer_data((pr_indexbuffer*)indexBuffer, indices, numIndices, format);
 }
 
 void prIndexBufferDataFromFile(PRobject indexBuffer, PRsizei* numIndices, FILE* file)
@@ -219,26 +318,47 @@ void prIndexBufferDataFromFile(PRobject indexBuffer, PRsizei* numIndices, FILE*
     _pr_indexbuffer_data_from_file((pr_indexbuffer*)indexBuffer, numIndices, file);
 }
 
+void prMeshDataFromFile(PRobject vertexBuffer, PRobject indexBuffer, PRsizei* numVertices, PRsizei* numIndices, const char* filename)
+{
+    _pr_mesh_data_from_file((pr_vertexbuffer*)vertexBuffer, (pr_indexbuffer*)indexBuffer, numVertices, numIndices, filename);
+}
+
 void prBindIndexBuffer(PRobject indexBuffer)
 {
-    _pr_state_machine_bind_indexbuffer((pr_indexbuffer*)indexBuffer);
+    pr_command* command = _record_command(PR_COMMAND_BIND_INDEXBUFFER);
+    if (command != NULL)
+        command->args.object = indexBuffer;
+    else
+        _pr_state_machine_bind_indexbuffer((pr_indexbuffer*)indexBuffer);
 }
 
 // --- matrices --- //
 
 void prProjectionMatrix(const PRfloat* matrix4x4)
 {
-    _pr_state_machine_projection_matrix((pr_matrix4*)matrix4x4);
+    pr_command* command = _record_command(PR_COMMAND_PROJECTION_MATRIX);
+    if (command != NULL)
+        memcpy(&(command->args.matrix), matrix4x4, sizeof(pr_matrix4));
+    else
+        _pr_state_machine_projection_matrix((pr_matrix4*)matrix4x4);
 }
 
 void prViewMatrix(const PRfloat* matrix4x4)
 {
-    _pr_state_machine_view_matrix((pr_matrix4*)matrix4x4);
+    pr_command* command = _record_command(PR_COMMAND_VIEW_MATRIX);
+    if (command != NULL)
+        memcpy(&(command->args.matrix), matrix4x4, sizeof(pr_matrix4));
+    else
+        _pr_state_machine_view_matrix((pr_matrix4*)matrix4x4);
 }
 
 void prWorldMatrix(const PRfloat* matrix4x4)
 {
-    _pr_state_machine_world_matrix((pr_matrix4*)matrix4x4);
+    pr_command* command = _record_command(PR_COMMAND_WORLD_MATRIX);
+    if (command != NULL)
+        memcpy(&(command->args.matrix), matrix4x4, sizeof(pr_matrix4));
+    else
+        _pr_state_machine_world_matrix((pr_matrix4*)matrix4x4);
 }
 
 void prBuildPerspectiveProjection(
@@ -277,7 +397,14 @@ void prLoadIdentity(PRfloat* matrix4x4)
 
 void prSetState(PRenum cap, PRboolean state)
 {
-    _pr_state_machine_set_state(cap, state);
+    pr_command* command = _record_command(PR_COMMAND_SET_STATE);
+    if (command != NULL)
+    {
+        command->args.param.param = cap;
+        command->args.param.value = (state != PR_FALSE ? PR_TRUE : PR_FALSE);
+    }
+    else
+        _pr_state_machine_set_state(cap, state);
 }
 
 PRboolean prGetState(PRenum cap)
@@ -287,139 +414,215 @@ PRboolean prGetState(PRenum cap)
 
 void prEnable(PRenum cap)
 {
-    _pr_state_machine_set_state(cap, PR_TRUE);
+    prSetState(cap, PR_TRUE);
 }
 
 void prDisable(PRenum cap)
 {
-    _pr_state_machine_set_state(cap, PR_FALSE);
+    prSetState(cap, PR_FALSE);
 }
 
 void prViewport(PRint x, PRint y, PRint width, PRint height)
 {
-    _pr_state_machine_viewport(x, y, width, height);
+    pr_command* command = _record_command(PR_COMMAND_VIEWPORT);
+    if (command != NULL)
+    {
+        command->args.rect.x1 = x;
+        command->args.rect.y1 = y;
+        command->args.rect.x2 = width;
+        command->args.rect.y2 = height;
+    }
+    else
+        _pr_state_machine_viewport(x, y, width, height);
 }
 
 void prScissor(PRint x, PRint y, PRint width, PRint height)
 {
-    _pr_state_machine_scissor(x, y, width, height);
+    pr_command* command = _record_command(PR_COMMAND_SCISSOR);
+    if (command != NULL)
+    {
+        command->args.rect.x1 = x;
+        command->args.rect.y1 = y;
+        command->args.rect.x2 = width;
+        command->args.rect.y2 = height;
+    }
+    else
+        _pr_state_machine_scissor(x, y, width, height);
 }
 
 void prDepthRange(PRfloat minDepth, PRfloat maxDepth)
 {
-    _pr_state_machine_depth_range(minDepth, maxDepth);
+    pr_command* command = _record_command(PR_COMMAND_DEPTH_RANGE);
+    if (command != NULL)
+    {
+        command->args.depthRange.minDepth = minDepth;
+        command->args.depthRange.maxDepth = maxDepth;
+    }
+    else
+        _pr_state_machine_depth_range(minDepth, maxDepth);
 }
 
 void prCullMode(PRenum mode)
 {
-    _pr_state_machine_cull_mode(mode);
+    pr_command* command = _record_command(PR_COMMAND_CULL_MODE);
+    if (command != NULL)
+        command->args.mode = mode;
+    else
+        _pr_state_machine_cull_mode(mode);
 }
 
 void prPolygonMode(PRenum mode)
 {
-    _pr_state_machine_polygon_mode(mode);
+    pr_command* command = _record_command(PR_COMMAND_POLYGON_MODE);
+    if (command != NULL)
+        command->args.mode = mode;
+    else
+        _pr_state_machine_polygon_mode(mode);
 }
 
 // --- drawing --- //
 
 void prClearColor(PRubyte r, PRubyte g, PRubyte b)
 {
-    PR_STATE_MACHINE.clearColor = _pr_color_to_colorindex(r, g, b);
+    pr_command* command = _record_command(PR_COMMAND_CLEAR_COLOR);
+    if (command != NULL)
+        command->args.colorIndex = _pr_color_to_colorindex(r, g, b);
+    else
+        PR_STATE_MACHINE.clearColor = _pr_color_to_colorindex(r, g, b);
 }
 
 void prColor(PRubyte r, PRubyte g, PRubyte b)
 {
-    PR_STATE_MACHINE.color0 = _pr_color_to_colorindex(r, g, b);
+    pr_command* command = _record_command(PR_COMMAND_COLOR);
+    if (command != NULL)
+        command->args.colorIndex = _pr_color_to_colorindex(r, g, b);
+    else
+        PR_STATE_MACHINE.color0 = _pr_color_to_colorindex(r, g, b);
 }
 
 void prDrawScreenPoint(PRint x, PRint y)
 {
-    _pr_render_screenspace_point(x, y);
+    pr_command* command = _record_command(PR_COMMAND_SCREEN_POINT);
+    if (command != NULL)
+    {
+        command->args.rect.x1 = x;
+        command->args.rect.y1 = y;
+    }
+    else
+        _pr_render_screenspace_point(x, y);
 }
 
 void prDrawScreenLine(PRint x1, PRint y1, PRint x2, PRint y2)
 {
-    _pr_render_screenspace_line(x1, y1, x2, y2);
+    pr_command* command = _record_command(PR_COMMAND_SCREEN_LINE);
+    if (command != NULL)
+    {
+        command->args.rect.x1 = x1;
+        command->args.rect.y1 = y1;
+        command->args.rect.x2 = x2;
+        command->args.rect.y2 = y2;
+    }
+    else
+        _pr_render_screenspace_line(x1, y1, x2, y2);
 }
 
 void prDrawScreenImage(PRint left, PRint top, PRint right, PRint bottom)
 {
-    _pr_render_screenspace_image(left, top, right, bottom);
+    pr_command* command = _record_command(PR_COMMAND_SCREEN_IMAGE);
+    if (command != NULL)
+    {
+        command->args.rect.x1 = left;
+        command->args.rect.y1 = top;
+        command->args.rect.x2 = right;
+        command->args.rect.y2 = bottom;
+    }
+    else
+        _pr_render_screenspace_image(left, top, right, bottom);
+}
+
+void prDraw(PRenum primitives, PRsizei numVertices, PRsizei firstVertex)
+{
+    pr_command* command = _record_command(PR_COMMAND_DRAW);
+    if (command != NULL)
+    {
+        command->args.draw.primitives   = primitives;
+        command->args.draw.numVertices  = numVertices;
+        command->args.draw.firstVertex  = firstVertex;
+    }
+    else
+        _pr_render_primitives(primitives, numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer);
 }
 
-void prDraw(PRenum primitives, PRushort numVertices, PRushort firstVertex)
+void prDrawIndexed(PRenum primitives, PRsizei numVertices, PRsizei firstVertex)
 {
-    switch (primitives)
+    pr_command* command = _record_command(PR_COMMAND_DRAW_INDEXED);
+    if (command != NULL)
     {
-        case PR_POINTS:
-            _pr_render_points(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer);
-            break;
-
-        case PR_LINES:
-            _pr_render_lines(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer);
-            break;
-        case PR_LINE_STRIP:
-            _pr_render_line_strip(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer);
-            break;
-        case PR_LINE_LOOP:
-            _pr_render_line_loop(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer);
-            break;
-
-        case PR_TRIANGLES:
-            _pr_render_triangles(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer);
-            break;
-        case PR_TRIANGLE_STRIP:
-            _pr_render_triangle_strip(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer);
-            break;
-        case PR_TRIANGLE_FAN:
-            _pr_render_triangle_fan(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer);
-            break;
-
-        default:
-            PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
-            break;
+        command->args.draw.primitives   = primitives;
+        command->args.draw.numVertices  = numVertices;
+        command->args.draw.firstVertex  = firstVertex;
     }
+    else
+        _pr_render_indexed_primitives(primitives, numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer, PR_STATE_MACHINE.boundIndexBuffer);
+}
+
+// --- command buffer --- //
+
+PRobject prCreateCommandBuffer()
+{
+    return (PRobject)_pr_command_buffer_create();
 }
 
-void prDrawIndexed(PRenum primitives, PRushort numVertices, PRushort firstVertex)
+void prDeleteCommandBuffer(PRobject commandBuffer)
 {
-    switch (primitives)
+    if (commandBuffer != NULL && commandBuffer == PR_STATE_MACHINE.recordCommandBuffer)
+        PR_STATE_MACHINE.recordCommandBuffer = NULL;
+    _pr_command_buffer_delete((pr_command_buffer*)commandBuffer);
+}
+
+void prBeginCommandBuffer(PRobject commandBuffer)
+{
+    if (commandBuffer == NULL)
+        PR_ERROR(PR_ERROR_NULL_POINTER);
+    else if (PR_STATE_MACHINE.recordCommandBuffer != NULL || PR_STATE_MACHINE.immModeActive)
+        PR_ERROR(PR_ERROR_INVALID_STATE);
+    else
     {
-        case PR_POINTS:
-            _pr_render_indexed_points(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer, PR_STATE_MACHINE.boundIndexBuffer);
-            break;
-
-        case PR_LINES:
-            _pr_render_indexed_lines(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer, PR_STATE_MACHINE.boundIndexBuffer);
-            break;
-        case PR_LINE_STRIP:
-            _pr_render_indexed_line_strip(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer, PR_STATE_MACHINE.boundIndexBuffer);
-            break;
-        case PR_LINE_LOOP:
-            _pr_render_indexed_line_loop(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer, PR_STATE_MACHINE.boundIndexBuffer);
-            break;
-
-        case PR_TRIANGLES:
-            _pr_render_indexed_triangles(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer, PR_STATE_MACHINE.boundIndexBuffer);
-            break;
-        case PR_TRIANGLE_STRIP:
-            _pr_render_indexed_triangle_strip(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer, PR_STATE_MACHINE.boundIndexBuffer);
-            break;
-        case PR_TRIANGLE_FAN:
-            _pr_render_indexed_triangle_fan(numVertices, firstVertex, PR_STATE_MACHINE.boundVertexBuffer, PR_STATE_MACHINE.boundIndexBuffer);
-            break;
-
-        default:
-            PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
-            break;
+        _pr_command_buffer_begin((pr_command_buffer*)commandBuffer);
+        PR_STATE_MACHINE.recordCommandBuffer = (pr_command_buffer*)commandBuffer;
     }
 }
 
+void prEndCommandBuffer()
+{
+    if (PR_STATE_MACHINE.recordCommandBuffer == NULL)
+        PR_ERROR(PR_ERROR_INVALID_STATE);
+    else
+    {
+        _pr_command_buffer_end(PR_STATE_MACHINE.recordCommandBuffer);
+        PR_STATE_MACHINE.recordCommandBuffer = NULL;
+    }
+}
+
+void prSubmitCommandBuffer(PRobject commandBuffer)
+{
+    if (commandBuffer == NULL)
+        PR_ERROR(PR_ERROR_NULL_POINTER);
+    else if (PR_STATE_MACHINE.recordCommandBuffer != NULL || PR_STATE_MACHINE.immModeActive)
+        PR_ERROR(PR_ERROR_INVALID_STATE);
+    else
+        _pr_command_buffer_submit((const pr_command_buffer*)commandBuffer);
+}
+
 // --- immediate mode --- //
 
 void prBegin(PRenum primitives)
 {
-    _pr_immediate_mode_begin(primitives);
+    // Immediate mode can not be recorded into a command buffer
+    if (PR_STATE_MACHINE.recordCommandBuffer != NULL)
+        PR_ERROR(PR_ERROR_INVALID_STATE);
+    else
+        _pr_immediate_mode_begin(primitives);
 }
 
 void prEnd()
@@ -39,7 +39,7 @@ typedef struct pr_context
 pr_context;
 
 
-extern pr_context* _currentContext;
+extern PR_THREAD_LOCAL pr_context* _currentContext;
 
 //! Creates a new render context for the specified device context.
 pr_context* _pr_context_create(const PRcontextdesc* desc, PRuint width, PRuint height);
@@ -41,7 +41,7 @@
 
 // MacOS specific graphics context
 
-pr_context* _currentContext = NULL;
+PR_THREAD_LOCAL pr_context* _currentContext = NULL;
 
 pr_context* _pr_context_create(const PRcontextdesc* desc, PRuint width, PRuint height)
 {
@@ -98,6 +98,7 @@ void _pr_context_delete(pr_context* context)
     if (context != NULL)
     {
         _pr_ref_assert(&(context->stateMachine));
+        _pr_state_machine_release(&(context->stateMachine));
         
         // Delete OSX objects
         [((NSBitmapImageRep*)context->bmp) release];
@@ -129,31 +130,10 @@ void _pr_context_present(pr_context* context, const pr_framebuffer* framebuffer)
         return;
     }
 
-    // Get iterators
-    const PRuint num = context->width * context->height;
-
+    // Convert framebuffer colors into the bitmap
     NSBitmapImageRep* bmp = (NSBitmapImageRep*)context->bmp;
 
-    pr_color* dst = (pr_color*)[bmp bitmapData];
-    pr_color* dstEnd = dst + num;
-
-    const pr_pixel* pixels = framebuffer->pixels;
-
-    const pr_color* palette = context->colorPalette->colors;
-    const pr_color* paletteColor;
-
-    // Iterate over all pixels
-    while (dst != dstEnd)
-    {
-        paletteColor = (palette + pixels->colorIndex);
-
-        dst->r = paletteColor->r;
-        dst->g = paletteColor->g;
-        dst->b = paletteColor->b;
-
-        ++dst;
-        ++pixels;
-    }
+    _pr_framebuffer_expand_colors(framebuffer, context->colorPalette->colors, (pr_color*)[bmp bitmapData]);
 
     // Trigger content view to be redrawn
     NSWindow* wnd = (NSWindow*)context->wnd;
@@ -10,7 +10,7 @@
 #include "helper.h"
 
 
-pr_context* _currentContext = NULL;
+PR_THREAD_LOCAL pr_context* _currentContext = NULL;
 
 pr_context* _pr_context_create(const PRcontextdesc* desc, PRuint width, PRuint height)
 {
@@ -61,6 +61,7 @@ void _pr_context_delete(pr_context* context)
     if (context != NULL)
     {
         _pr_ref_assert(&(context->stateMachine));
+        _pr_state_machine_release(&(context->stateMachine));
 
         if (context->bmp != NULL)
             DeleteObject(context->bmp);
@@ -95,35 +96,8 @@ void _pr_context_present(pr_context* context, const pr_framebuffer* framebuffer)
         return;
     }
 
-    // Get iterators
-    const PRuint num = context->width*context->height;
-
-    pr_color* dst = context->colors;
-    pr_color* dstEnd = dst + num;
-
-    const pr_pixel* pixels = framebuffer->pixels;
-    const pr_color* palette = context->colorPalette->colors;
-
-    #ifndef PR_COLOR_BUFFER_24BIT
-    const pr_color* paletteColor;
-    #endif
-
-    // Iterate over all pixels
-    while (dst != dstEnd)
-    {
-        #ifdef PR_COLOR_BUFFER_24BIT
-        *dst = pixels->colorIndex;
-        #else
-        paletteColor = (palette + pixels->colorIndex);
-
-        dst->r = paletteColor->r;
-        dst->g = paletteColor->g;
-        dst->b = paletteColor->b;
-        #endif
-
-        ++dst;
-        ++pixels;
-    }
+    // Convert framebuffer colors into the context colors
+    _pr_framebuffer_expand_colors(framebuffer, context->colorPalette->colors, context->colors);
 
     // Show framebuffer on device context ('SetDIBits' only needs a device context when 'DIB_PAL_COLORS' is used)
     SetDIBits(NULL, context->bmp, 0, context->height, context->colors, &(context->bmpInfo), DIB_RGB_COLORS);
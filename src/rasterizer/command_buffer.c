@@ -0,0 +1,339 @@
+/*
+ * command_buffer.c
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#include "command_buffer.h"
+#include "state_machine.h"
+#include "render.h"
+#include "helper.h"
+#include "error.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+// Number of state slots which are tracked to remove redundant state changes (one extra slot for each state)
+#define _NUM_STATE_SLOTS (PR_NUM_COMMANDS + PR_NUM_STATES)
+
+
+// --- internals --- //
+
+// Returns the state slot which is overwritten by the specified command, or -1 if the command is not a plain state change.
+static PRint _command_state_slot(const pr_command* command)
+{
+    switch (command->opcode)
+    {
+        case PR_COMMAND_BIND_VERTEXBUFFER:
+        case PR_COMMAND_BIND_INDEXBUFFER:
+        case PR_COMMAND_BIND_TEXTURE:
+        case PR_COMMAND_TEXTURE_REGION:
+        case PR_COMMAND_PROJECTION_MATRIX:
+        case PR_COMMAND_VIEW_MATRIX:
+        case PR_COMMAND_WORLD_MATRIX:
+        case PR_COMMAND_VIEWPORT:
+        case PR_COMMAND_SCISSOR:
+        case PR_COMMAND_DEPTH_RANGE:
+        case PR_COMMAND_CULL_MODE:
+        case PR_COMMAND_POLYGON_MODE:
+        case PR_COMMAND_CLEAR_COLOR:
+        case PR_COMMAND_COLOR:
+            return (PRint)command->opcode;
+
+        case PR_COMMAND_TEXENVI:
+            if (command->args.param.param == PR_TEXTURE_LOD_BIAS)
+                return (PRint)command->opcode;
+            break;
+
+        case PR_COMMAND_SET_STATE:
+            if (command->args.param.param < PR_NUM_STATES)
+                return PR_NUM_COMMANDS + (PRint)command->args.param.param;
+            break;
+    }
+    return -1;
+}
+
+// Returns PR_TRUE if the specified draw commands can be merged into a single draw command.
+static PRboolean _can_merge_draw_commands(const pr_command* prev, const pr_command* next)
+{
+    PRsizei primitiveSize = 0;
+
+    if (prev->opcode != next->opcode || prev->args.draw.primitives != next->args.draw.primitives)
+        return PR_FALSE;
+
+    // Only lists of independent primitives can be merged
+    switch (prev->args.draw.primitives)
+    {
+        case PR_POINTS:
+            primitiveSize = 1;
+            break;
+        case PR_LINES:
+            primitiveSize = 2;
+            break;
+        case PR_TRIANGLES:
+            primitiveSize = 3;
+            break;
+        default:
+            return PR_FALSE;
+    }
+
+    return
+        prev->args.draw.numVertices % primitiveSize == 0 &&
+        prev->args.draw.firstVertex + prev->args.draw.numVertices == next->args.draw.firstVertex;
+}
+
+/*
+Removes all state changes which set the same value as the previous change of the same state,
+and merges consecutive draw calls over adjacent vertex ranges.
+*/
+static void _command_buffer_optimize(pr_command_buffer* commandBuffer)
+{
+    PRint lastStateCommand[_NUM_STATE_SLOTS];
+    PRuint numCommands = 0;
+
+    for (PRint i = 0; i < _NUM_STATE_SLOTS; ++i)
+        lastStateCommand[i] = -1;
+
+    for (PRuint i = 0; i < commandBuffer->numCommands; ++i)
+    {
+        const pr_command* command = &(commandBuffer->commands[i]);
+        pr_command* prevCommand = (numCommands > 0 ? &(commandBuffer->commands[numCommands - 1]) : NULL);
+
+        const PRint slot = _command_state_slot(command);
+
+        if (slot >= 0)
+        {
+            // Skip state change if the state already has this value
+            const PRint last = lastStateCommand[slot];
+            if (last >= 0 && memcmp(&(commandBuffer->commands[last].args), &(command->args), sizeof(command->args)) == 0)
+                continue;
+            lastStateCommand[slot] = (PRint)numCommands;
+        }
+        else if (command->opcode == PR_COMMAND_BIND_FRAMEBUFFER)
+        {
+            // Binding a frame buffer resets the clipping rectangle, so all following state changes must be kept
+            for (PRint j = 0; j < _NUM_STATE_SLOTS; ++j)
+                lastStateCommand[j] = -1;
+        }
+        else if ( ( command->opcode == PR_COMMAND_DRAW || command->opcode == PR_COMMAND_DRAW_INDEXED ) &&
+                  prevCommand != NULL && _can_merge_draw_commands(prevCommand, command) )
+        {
+            // Extend previous draw command
+            prevCommand->args.draw.numVertices += command->args.draw.numVertices;
+            continue;
+        }
+
+        commandBuffer->commands[numCommands++] = *command;
+    }
+
+    commandBuffer->numCommands = numCommands;
+}
+
+// Returns PR_TRUE if the specified command can be executed while binned polygons of previous draw calls are still pending.
+static PRboolean _is_command_batchable(const pr_command* command)
+{
+    switch (command->opcode)
+    {
+        case PR_COMMAND_BIND_VERTEXBUFFER:
+        case PR_COMMAND_BIND_INDEXBUFFER:
+        case PR_COMMAND_BIND_TEXTURE:
+        case PR_COMMAND_TEXTURE_REGION:
+        case PR_COMMAND_PROJECTION_MATRIX:
+        case PR_COMMAND_VIEW_MATRIX:
+        case PR_COMMAND_WORLD_MATRIX:
+        case PR_COMMAND_TEXENVI:
+        case PR_COMMAND_DEPTH_RANGE:
+        case PR_COMMAND_CULL_MODE:
+            return PR_TRUE;
+
+        case PR_COMMAND_DRAW:
+        case PR_COMMAND_DRAW_INDEXED:
+            // Only filled triangles go through the tile binner, all other primitives are rasterized immediately
+            return
+                PR_STATE_MACHINE.polygonMode == PR_POLYGON_FILL &&
+                command->args.draw.primitives >= PR_TRIANGLES &&
+                command->args.draw.primitives <= PR_TRIANGLE_FAN;
+    }
+    return PR_FALSE;
+}
+
+static void _command_execute(const pr_command* command)
+{
+    switch (command->opcode)
+    {
+        case PR_COMMAND_BIND_FRAMEBUFFER:
+            _pr_state_machine_bind_framebuffer((pr_framebuffer*)command->args.object);
+            break;
+        case PR_COMMAND_BIND_VERTEXBUFFER:
+            _pr_state_machine_bind_vertexbuffer((pr_vertexbuffer*)command->args.object);
+            break;
+        case PR_COMMAND_BIND_INDEXBUFFER:
+            _pr_state_machine_bind_indexbuffer((pr_indexbuffer*)command->args.object);
+            break;
+        case PR_COMMAND_BIND_TEXTURE:
+            _pr_state_machine_bind_texture((pr_texture*)command->args.object);
+            break;
+        case PR_COMMAND_TEXTURE_REGION:
+            _pr_state_machine_texture_region(command->args.rect.x1, command->args.rect.y1, command->args.rect.x2, command->args.rect.y2);
+            break;
+
+        case PR_COMMAND_CLEAR_FRAMEBUFFER:
+            _pr_framebuffer_clear((pr_framebuffer*)command->args.clear.frameBuffer, command->args.clear.depth, command->args.clear.flags);
+            break;
+
+        case PR_COMMAND_PROJECTION_MATRIX:
+            _pr_state_machine_projection_matrix(&(command->args.matrix));
+            break;
+        case PR_COMMAND_VIEW_MATRIX:
+            _pr_state_machine_view_matrix(&(command->args.matrix));
+            break;
+        case PR_COMMAND_WORLD_MATRIX:
+            _pr_state_machine_world_matrix(&(command->args.matrix));
+            break;
+
+        case PR_COMMAND_SET_STATE:
+            _pr_state_machine_set_state(command->args.param.param, (PRboolean)command->args.param.value);
+            break;
+        case PR_COMMAND_TEXENVI:
+            _pr_state_machine_set_texenvi(command->args.param.param, command->args.param.value);
+            break;
+
+        case PR_COMMAND_VIEWPORT:
+            _pr_state_machine_viewport(command->args.rect.x1, command->args.rect.y1, command->args.rect.x2, command->args.rect.y2);
+            break;
+        case PR_COMMAND_SCISSOR:
+            _pr_state_machine_scissor(command->args.rect.x1, command->args.rect.y1, command->args.rect.x2, command->args.rect.y2);
+            break;
+        case PR_COMMAND_DEPTH_RANGE:
+            _pr_state_machine_depth_range(command->args.depthRange.minDepth, command->args.depthRange.maxDepth);
+            break;
+        case PR_COMMAND_CULL_MODE:
+            _pr_state_machine_cull_mode(command->args.mode);
+            break;
+        case PR_COMMAND_POLYGON_MODE:
+            _pr_state_machine_polygon_mode(command->args.mode);
+            break;
+
+        case PR_COMMAND_CLEAR_COLOR:
+            PR_STATE_MACHINE.clearColor = command->args.colorIndex;
+            break;
+        case PR_COMMAND_COLOR:
+            PR_STATE_MACHINE.color0 = command->args.colorIndex;
+            break;
+
+        case PR_COMMAND_SCREEN_POINT:
+            _pr_render_screenspace_point(command->args.rect.x1, command->args.rect.y1);
+            break;
+        case PR_COMMAND_SCREEN_LINE:
+            _pr_render_screenspace_line(command->args.rect.x1, command->args.rect.y1, command->args.rect.x2, command->args.rect.y2);
+            break;
+        case PR_COMMAND_SCREEN_IMAGE:
+            _pr_render_screenspace_image(command->args.rect.x1, command->args.rect.y1, command->args.rect.x2, command->args.rect.y2);
+            break;
+
+        case PR_COMMAND_DRAW:
+            _pr_render_primitives(
+                command->args.draw.primitives,
+                command->args.draw.numVertices,
+                command->args.draw.firstVertex,
+                PR_STATE_MACHINE.boundVertexBuffer
+            );
+            break;
+        case PR_COMMAND_DRAW_INDEXED:
+            _pr_render_indexed_primitives(
+                command->args.draw.primitives,
+                command->args.draw.numVertices,
+                command->args.draw.firstVertex,
+                PR_STATE_MACHINE.boundVertexBuffer,
+                PR_STATE_MACHINE.boundIndexBuffer
+            );
+            break;
+    }
+}
+
+// --- interface --- //
+
+pr_command_buffer* _pr_command_buffer_create()
+{
+    pr_command_buffer* commandBuffer = PR_MALLOC(pr_command_buffer);
+
+    commandBuffer->commands     = NULL;
+    commandBuffer->numCommands  = 0;
+    commandBuffer->capacity     = 0;
+    commandBuffer->recording    = PR_FALSE;
+
+    _pr_ref_add(commandBuffer);
+
+    return commandBuffer;
+}
+
+void _pr_command_buffer_delete(pr_command_buffer* commandBuffer)
+{
+    if (commandBuffer != NULL)
+    {
+        _pr_ref_release(commandBuffer);
+
+        PR_FREE(commandBuffer->commands);
+        PR_FREE(commandBuffer);
+    }
+}
+
+void _pr_command_buffer_begin(pr_command_buffer* commandBuffer)
+{
+    commandBuffer->numCommands  = 0;
+    commandBuffer->recording    = PR_TRUE;
+}
+
+void _pr_command_buffer_end(pr_command_buffer* commandBuffer)
+{
+    _command_buffer_optimize(commandBuffer);
+    commandBuffer->recording = PR_FALSE;
+}
+
+pr_command* _pr_command_buffer_append(pr_command_buffer* commandBuffer, PRenum opcode)
+{
+    if (commandBuffer->numCommands == commandBuffer->capacity)
+    {
+        // Grow command array
+        commandBuffer->capacity = (commandBuffer->capacity < 16 ? 16 : commandBuffer->capacity * 2);
+        commandBuffer->commands = (pr_command*)realloc(commandBuffer->commands, sizeof(pr_command)*commandBuffer->capacity);
+    }
+
+    // Clear all arguments, so that commands can be compared bitwise
+    pr_command* command = &(commandBuffer->commands[commandBuffer->numCommands++]);
+    memset(command, 0, sizeof(pr_command));
+    command->opcode = opcode;
+
+    return command;
+}
+
+void _pr_command_buffer_submit(const pr_command_buffer* commandBuffer)
+{
+    if (commandBuffer->recording)
+    {
+        PR_ERROR(PR_ERROR_INVALID_STATE);
+        return;
+    }
+
+    /*
+    Keep the binned polygons of all consecutive draw calls, so that the tile binner
+    can rasterize them with a single dispatch to the worker threads
+    */
+    PR_STATE_MACHINE.batchDrawCalls = PR_TRUE;
+
+    for (PRuint i = 0; i < commandBuffer->numCommands; ++i)
+    {
+        const pr_command* command = &(commandBuffer->commands[i]);
+
+        if (!_is_command_batchable(command))
+            _pr_render_flush();
+
+        _command_execute(command);
+    }
+
+    _pr_render_flush();
+
+    PR_STATE_MACHINE.batchDrawCalls = PR_FALSE;
+}
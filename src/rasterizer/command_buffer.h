@@ -0,0 +1,126 @@
+/*
+ * command_buffer.h
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#ifndef PR_COMMAND_BUFFER_H
+#define PR_COMMAND_BUFFER_H
+
+
+#include "types.h"
+#include "matrix4.h"
+#include "color.h"
+
+
+// Command opcodes
+#define PR_COMMAND_BIND_FRAMEBUFFER     0
+#define PR_COMMAND_BIND_VERTEXBUFFER    1
+#define PR_COMMAND_BIND_INDEXBUFFER     2
+#define PR_COMMAND_BIND_TEXTURE         3
+#define PR_COMMAND_CLEAR_FRAMEBUFFER    4
+#define PR_COMMAND_PROJECTION_MATRIX    5
+#define PR_COMMAND_VIEW_MATRIX          6
+#define PR_COMMAND_WORLD_MATRIX         7
+#define PR_COMMAND_SET_STATE            8
+#define PR_COMMAND_TEXENVI              9
+#define PR_COMMAND_VIEWPORT             10
+#define PR_COMMAND_SCISSOR              11
+#define PR_COMMAND_DEPTH_RANGE          12
+#define PR_COMMAND_CULL_MODE            13
+#define PR_COMMAND_POLYGON_MODE         14
+#define PR_COMMAND_CLEAR_COLOR          15
+#define PR_COMMAND_COLOR                16
+#define PR_COMMAND_SCREEN_POINT         17
+#define PR_COMMAND_SCREEN_LINE          18
+#define PR_COMMAND_SCREEN_IMAGE         19
+#define PR_COMMAND_DRAW                 20
+#define PR_COMMAND_DRAW_INDEXED         21
+#define PR_COMMAND_TEXTURE_REGION       22
+
+#define PR_NUM_COMMANDS                 23
+
+
+//! Single recorded command. Only the arguments which belong to the opcode are valid.
+typedef struct pr_command
+{
+    PRenum opcode;
+
+    union
+    {
+        PRobject        object;         //!< Bound object (PR_COMMAND_BIND_...).
+        pr_matrix4      matrix;         //!< PR_COMMAND_..._MATRIX.
+        PRcolorindex    colorIndex;     //!< PR_COMMAND_CLEAR_COLOR, PR_COMMAND_COLOR.
+        PRenum          mode;           //!< PR_COMMAND_CULL_MODE, PR_COMMAND_POLYGON_MODE.
+
+        struct
+        {
+            PRenum  param;
+            PRint   value;
+        }
+        param;                          //!< PR_COMMAND_SET_STATE, PR_COMMAND_TEXENVI.
+
+        struct
+        {
+            PRint x1, y1, x2, y2;
+        }
+        rect;                           //!< PR_COMMAND_VIEWPORT, PR_COMMAND_SCISSOR, PR_COMMAND_TEXTURE_REGION (x, y, width, height), PR_COMMAND_SCREEN_...
+
+        struct
+        {
+            PRfloat minDepth;
+            PRfloat maxDepth;
+        }
+        depthRange;                     //!< PR_COMMAND_DEPTH_RANGE.
+
+        struct
+        {
+            PRobject    frameBuffer;
+            PRfloat     depth;
+            PRbitfield  flags;
+        }
+        clear;                          //!< PR_COMMAND_CLEAR_FRAMEBUFFER.
+
+        struct
+        {
+            PRenum  primitives;
+            PRsizei numVertices;
+            PRsizei firstVertex;
+        }
+        draw;                           //!< PR_COMMAND_DRAW, PR_COMMAND_DRAW_INDEXED.
+    }
+    args;
+}
+pr_command;
+
+/**
+Command buffer with recorded state changes and draw calls. A command buffer is recorded once
+and can then be submitted any number of times, also from another thread than the recording thread.
+*/
+typedef struct pr_command_buffer
+{
+    pr_command* commands;
+    PRuint      numCommands;
+    PRuint      capacity;
+    PRboolean   recording;      //!< Specifies whether this command buffer is currently being recorded.
+}
+pr_command_buffer;
+
+
+pr_command_buffer* _pr_command_buffer_create();
+void _pr_command_buffer_delete(pr_command_buffer* commandBuffer);
+
+//! Discards all previous commands and starts recording into the specified command buffer.
+void _pr_command_buffer_begin(pr_command_buffer* commandBuffer);
+//! Finishes recording and removes redundant commands.
+void _pr_command_buffer_end(pr_command_buffer* commandBuffer);
+
+//! Appends a new command to the command buffer and returns it. The command must then be filled by the caller.
+pr_command* _pr_command_buffer_append(pr_command_buffer* commandBuffer, PRenum opcode);
+
+//! Executes all commands of the specified command buffer on the current state machine.
+void _pr_command_buffer_submit(const pr_command_buffer* commandBuffer);
+
+
+#endif
@@ -7,10 +7,11 @@
 
 #include "error.h"
 #include "error_ids.h"
+#include "static_config.h"
 
 
-static PRenum _error = PR_ERROR_NONE;
-static PR_ERROR_HANDLER_PROC _errorHandler = NULL;
+static PR_THREAD_LOCAL PRenum _error = PR_ERROR_NONE;
+static PR_THREAD_LOCAL PR_ERROR_HANDLER_PROC _errorHandler = NULL;
 
 void _pr_error_set(PRenum errorID, const char* info)
 {
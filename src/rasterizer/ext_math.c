@@ -9,6 +9,7 @@
 
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <string.h>
 
 
 // Fast inverse square root from "Quake III Arena"
@@ -89,9 +90,10 @@ PRfloat _aprx_log(PRfloat x)
 PRint _int_log2(PRfloat x)
 {
     #ifdef PR_FAST_MATH
-    unsigned long* ix = (unsigned long*)(&x);
-    unsigned long exp = ((*ix) >> 23) & 0xff;
-    return (PRint)exp - 127;
+    // Read the exponent bits (memcpy avoids aliasing the float through an integer pointer)
+    PRuint ix;
+    memcpy(&ix, &x, sizeof(PRuint));
+    return (PRint)((ix >> 23) & 0xff) - 127;
     #else
     int y;
     frexpf(x, &y);
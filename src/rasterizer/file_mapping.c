@@ -0,0 +1,144 @@
+/*
+ * file_mapping.c
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#include "file_mapping.h"
+#include "helper.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef _WIN32
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+
+PRboolean _pr_file_mapping_open(pr_file_mapping* mapping, const char* filename)
+{
+    mapping->data = NULL;
+    mapping->size = 0;
+
+    #ifdef _WIN32
+
+    mapping->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (mapping->file == INVALID_HANDLE_VALUE)
+        return PR_FALSE;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(mapping->file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(mapping->file);
+        return PR_FALSE;
+    }
+
+    mapping->mapping = CreateFileMappingA(mapping->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping->mapping == NULL)
+    {
+        CloseHandle(mapping->file);
+        return PR_FALSE;
+    }
+
+    mapping->data = (const PRubyte*)MapViewOfFile(mapping->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (mapping->data == NULL)
+    {
+        CloseHandle(mapping->mapping);
+        CloseHandle(mapping->file);
+        return PR_FALSE;
+    }
+
+    mapping->size = (size_t)fileSize.QuadPart;
+
+    #else
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return PR_FALSE;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        close(fd);
+        return PR_FALSE;
+    }
+
+    void* data = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping stays valid after the file descriptor has been closed
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return PR_FALSE;
+
+    // The file is read once from front to back
+    madvise(data, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+
+    mapping->data = (const PRubyte*)data;
+    mapping->size = (size_t)fileStat.st_size;
+
+    #endif
+
+    return PR_TRUE;
+}
+
+void _pr_file_mapping_close(pr_file_mapping* mapping)
+{
+    if (mapping->data == NULL)
+        return;
+
+    #ifdef _WIN32
+    UnmapViewOfFile(mapping->data);
+    CloseHandle(mapping->mapping);
+    CloseHandle(mapping->file);
+    #else
+    munmap((void*)mapping->data, mapping->size);
+    #endif
+
+    mapping->data = NULL;
+    mapping->size = 0;
+}
+
+size_t _pr_file_remaining_size(FILE* file)
+{
+    const long pos = ftell(file);
+    if (pos < 0 || fseek(file, 0, SEEK_END) != 0)
+        return SIZE_MAX;
+
+    const long end = ftell(file);
+    fseek(file, pos, SEEK_SET);
+
+    if (end < 0)
+        return SIZE_MAX;
+
+    return (end > pos ? (size_t)(end - pos) : 0);
+}
+
+PRboolean _pr_file_has_extended_magic(const PRubyte* data, size_t size)
+{
+    PRuint magic = 0;
+
+    if (size < sizeof(PRuint))
+        return PR_FALSE;
+
+    memcpy(&magic, data, sizeof(PRuint));
+
+    return (magic == PR_FILE_EXTENDED_MAGIC);
+}
+
+PRboolean _pr_file_read_extended_magic(FILE* file)
+{
+    PRubyte data[sizeof(PRuint)];
+    const size_t size = fread(data, 1, sizeof(PRuint), file);
+
+    if (_pr_file_has_extended_magic(data, size))
+        return PR_TRUE;
+
+    fseek(file, -(long)size, SEEK_CUR);
+
+    return PR_FALSE;
+}
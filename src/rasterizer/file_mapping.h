@@ -0,0 +1,52 @@
+/*
+ * file_mapping.h
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#ifndef PR_FILE_MAPPING_H
+#define PR_FILE_MAPPING_H
+
+
+#include "types.h"
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#   include <Windows.h>
+#endif
+
+
+//! Read-only memory mapping of an entire file.
+typedef struct pr_file_mapping
+{
+    const PRubyte*  data;   //!< Pointer to the mapped file content.
+    size_t          size;   //!< File size (in bytes).
+    #ifdef _WIN32
+    HANDLE          file;
+    HANDLE          mapping;
+    #endif
+}
+pr_file_mapping;
+
+
+//! Maps the specified file into memory. Returns PR_FALSE if the file could not be opened or is empty.
+PRboolean _pr_file_mapping_open(pr_file_mapping* mapping, const char* filename);
+//! Unmaps the specified file. The mapped data must no longer be used.
+void _pr_file_mapping_close(pr_file_mapping* mapping);
+
+//! Returns the number of bytes from the current position to the end of the file, or SIZE_MAX if the file is not seekable.
+size_t _pr_file_remaining_size(FILE* file);
+
+//! Returns PR_TRUE if the data starts with PR_FILE_EXTENDED_MAGIC (see PR_FILE_EXTENDED_HEADER).
+PRboolean _pr_file_has_extended_magic(const PRubyte* data, size_t size);
+/**
+Reads PR_FILE_EXTENDED_MAGIC from the file and returns PR_TRUE (see PR_FILE_EXTENDED_HEADER).
+Otherwise, the file position is restored (the bytes belong to the data of a file without extended header) and PR_FALSE is returned.
+*/
+PRboolean _pr_file_read_extended_magic(FILE* file);
+
+
+#endif
@@ -10,6 +10,7 @@
 #include "helper.h"
 #include "state_machine.h"
 #include "color_palette.h"
+#include "ext_math.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -28,12 +29,25 @@ pr_framebuffer* _pr_framebuffer_create(PRuint width, PRuint height)
 
     frameBuffer->width = width;
     frameBuffer->height = height;
+    #ifdef PR_MERGE_COLOR_AND_DEPTH_BUFFERS
     frameBuffer->pixels = PR_CALLOC(pr_pixel, width*height);
+    #else
+    frameBuffer->colors = PR_CALLOC(PRcolorindex, width*height);
+    frameBuffer->depths = PR_CALLOC(PRdepthtype, width*height);
+    #endif
     frameBuffer->scanlinesStart = PR_CALLOC(pr_scaline_side, height);
     frameBuffer->scanlinesEnd = PR_CALLOC(pr_scaline_side, height);
 
-    // Initialize framebuffer
-    memset(frameBuffer->pixels, 0, width*height*sizeof(pr_pixel));
+    frameBuffer->numBlocksX = (width + PR_BLOCK_SIZE - 1) / PR_BLOCK_SIZE;
+    frameBuffer->numBlocksY = (height + PR_BLOCK_SIZE - 1) / PR_BLOCK_SIZE;
+    frameBuffer->depthBlocks = PR_CALLOC(pr_depth_block, frameBuffer->numBlocksX * frameBuffer->numBlocksY);
+
+    frameBuffer->numTilesX = (width + PR_TILE_SIZE - 1) / PR_TILE_SIZE;
+    frameBuffer->numTilesY = (height + PR_TILE_SIZE - 1) / PR_TILE_SIZE;
+    frameBuffer->clearTiles = PR_CALLOC(PRubyte, frameBuffer->numTilesX * frameBuffer->numTilesY);
+    frameBuffer->clearPending = PR_FALSE;
+    memset(&(frameBuffer->clearColor), 0, sizeof(PRcolorindex));
+    frameBuffer->clearDepth = 0;
 
     _pr_ref_add(frameBuffer);
 
@@ -46,16 +60,87 @@ void _pr_framebuffer_delete(pr_framebuffer* frameBuffer)
     {
         _pr_ref_release(frameBuffer);
 
+        #ifdef PR_MERGE_COLOR_AND_DEPTH_BUFFERS
         PR_FREE(frameBuffer->pixels);
+        #else
+        PR_FREE(frameBuffer->colors);
+        PR_FREE(frameBuffer->depths);
+        #endif
         PR_FREE(frameBuffer->scanlinesStart);
         PR_FREE(frameBuffer->scanlinesEnd);
+        PR_FREE(frameBuffer->depthBlocks);
+        PR_FREE(frameBuffer->clearTiles);
         PR_FREE(frameBuffer);
     }
 }
 
+// Resets the depth blocks inside the specified block range to the specified depth.
+static void _reset_depth_blocks(pr_framebuffer* frameBuffer, PRuint bxMin, PRuint byMin, PRuint bxMax, PRuint byMax, PRdepthtype depth)
+{
+    for (PRuint by = byMin; by < byMax; ++by)
+    {
+        pr_depth_block* block = &(frameBuffer->depthBlocks[by * frameBuffer->numBlocksX + bxMin]);
+        pr_depth_block* blockEnd = block + (bxMax - bxMin);
+
+        for (; block != blockEnd; ++block)
+        {
+            block->zMin     = depth;
+            block->zMax     = depth;
+            block->dirty    = PR_FALSE;
+        }
+    }
+}
+
+// Executes the pending clears of the specified screen tile.
+static void _materialize_tile(pr_framebuffer* frameBuffer, PRuint tx, PRuint ty)
+{
+    PRubyte* flags = &(frameBuffer->clearTiles[ty * frameBuffer->numTilesX + tx]);
+
+    const PRuint left = tx * PR_TILE_SIZE;
+    const PRuint top = ty * PR_TILE_SIZE;
+    const PRuint right = PR_MIN(left + PR_TILE_SIZE, frameBuffer->width);
+    const PRuint bottom = PR_MIN(top + PR_TILE_SIZE, frameBuffer->height);
+
+    for (PRuint y = top; y < bottom; ++y)
+    {
+        const PRuint offset = y * frameBuffer->width + left;
+
+        if ((*flags & PR_COLOR_BUFFER_BIT) != 0)
+        {
+            PRcolorindex* dst = PR_FRAMEBUFFER_COLOR_PTR(frameBuffer, offset);
+            PRcolorindex* dstEnd = dst + (right - left) * PR_FRAMEBUFFER_COLOR_STRIDE;
+
+            for (; dst != dstEnd; dst += PR_FRAMEBUFFER_COLOR_STRIDE)
+                *dst = frameBuffer->clearColor;
+        }
+
+        if ((*flags & PR_DEPTH_BUFFER_BIT) != 0)
+        {
+            PRdepthtype* dst = PR_FRAMEBUFFER_DEPTH_PTR(frameBuffer, offset);
+            PRdepthtype* dstEnd = dst + (right - left) * PR_FRAMEBUFFER_DEPTH_STRIDE;
+
+            for (; dst != dstEnd; dst += PR_FRAMEBUFFER_DEPTH_STRIDE)
+                *dst = frameBuffer->clearDepth;
+        }
+    }
+
+    // Depth blocks are aligned to the screen tiles
+    if ((*flags & PR_DEPTH_BUFFER_BIT) != 0)
+    {
+        _reset_depth_blocks(
+            frameBuffer,
+            left / PR_BLOCK_SIZE, top / PR_BLOCK_SIZE,
+            (right + PR_BLOCK_SIZE - 1) / PR_BLOCK_SIZE, (bottom + PR_BLOCK_SIZE - 1) / PR_BLOCK_SIZE,
+            frameBuffer->clearDepth
+        );
+    }
+
+    *flags = 0;
+}
+
 void _pr_framebuffer_clear(pr_framebuffer* frameBuffer, PRfloat clearDepth, PRbitfield clearFlags)
 {
-    if (frameBuffer != NULL && frameBuffer->pixels != NULL)
+    if (frameBuffer != NULL)
     {
         // Convert depth (32-bit) into pixel depth (16-bit or 8-bit)
         PRdepthtype depth = _pr_pixel_write_depth(clearDepth);
@@ -63,9 +148,40 @@ void _pr_framebuffer_clear(pr_framebuffer* frameBuffer, PRfloat clearDepth, PRbi
         // Get clear color from state machine (and optionally its color index)
         PRcolorindex clearColor = PR_STATE_MACHINE.clearColor;
 
+        clearFlags &= (PR_COLOR_BUFFER_BIT | PR_DEPTH_BUFFER_BIT);
+
+        PRubyte* tile = frameBuffer->clearTiles;
+        PRubyte* tileEnd = tile + (frameBuffer->numTilesX * frameBuffer->numTilesY);
+
+        if (PR_STATE_MACHINE.states[PR_FAST_CLEAR] != PR_FALSE)
+        {
+            // Only store clear flags for each tile
+            if ((clearFlags & PR_COLOR_BUFFER_BIT) != 0)
+                frameBuffer->clearColor = clearColor;
+            if ((clearFlags & PR_DEPTH_BUFFER_BIT) != 0)
+                frameBuffer->clearDepth = depth;
+
+            for (; tile != tileEnd; ++tile)
+                *tile |= (PRubyte)clearFlags;
+
+            frameBuffer->clearPending = PR_TRUE;
+            return;
+        }
+
+        // Discard pending clears which are overwritten now
+        if (frameBuffer->clearPending)
+        {
+            for (; tile != tileEnd; ++tile)
+                *tile &= (PRubyte)(~clearFlags);
+        }
+
+        const PRuint numPixels = frameBuffer->width * frameBuffer->height;
+
+        #ifdef PR_MERGE_COLOR_AND_DEPTH_BUFFERS
+
         // Iterate over the entire framebuffer
         pr_pixel* dst = frameBuffer->pixels;
-        pr_pixel* dstEnd = dst + (frameBuffer->width * frameBuffer->height);
+        pr_pixel* dstEnd = dst + numPixels;
 
         if ((clearFlags & PR_COLOR_BUFFER_BIT) != 0 && (clearFlags & PR_DEPTH_BUFFER_BIT) != 0)
         {
@@ -92,48 +208,215 @@ void _pr_framebuffer_clear(pr_framebuffer* frameBuffer, PRfloat clearDepth, PRbi
                 ++dst;
             }
         }
+
+        #else
+
+        // Clear color and depth planes separately
+        if ((clearFlags & PR_COLOR_BUFFER_BIT) != 0)
+        {
+            #ifdef PR_COLOR_BUFFER_24BIT
+            PRcolorindex* dst = frameBuffer->colors;
+            PRcolorindex* dstEnd = dst + numPixels;
+
+            while (dst != dstEnd)
+                *dst++ = clearColor;
+            #else
+            memset(frameBuffer->colors, clearColor, numPixels);
+            #endif
+        }
+
+        if ((clearFlags & PR_DEPTH_BUFFER_BIT) != 0)
+        {
+            PRdepthtype* dst = frameBuffer->depths;
+            PRdepthtype* dstEnd = dst + numPixels;
+
+            while (dst != dstEnd)
+                *dst++ = depth;
+        }
+
+        #endif
+
+        // Reset depth blocks
+        if ((clearFlags & PR_DEPTH_BUFFER_BIT) != 0)
+            _reset_depth_blocks(frameBuffer, 0, 0, frameBuffer->numBlocksX, frameBuffer->numBlocksY, depth);
     }
     else
         _pr_error_set(PR_ERROR_NULL_POINTER, __FUNCTION__);
 }
 
-void _pr_framebuffer_setup_scanlines(
-    pr_framebuffer* frameBuffer, pr_scaline_side* sides, pr_raster_vertex start, pr_raster_vertex end)
+void _pr_framebuffer_materialize_tiles(pr_framebuffer* frameBuffer, PRint left, PRint top, PRint right, PRint bottom)
 {
-    PRint pitch = (PRint)frameBuffer->width;
-    PRint len = end.y - start.y;
+    const PRint txMin = PR_MAX(left, 0) / PR_TILE_SIZE;
+    const PRint tyMin = PR_MAX(top, 0) / PR_TILE_SIZE;
+    const PRint txMax = PR_MIN(right / PR_TILE_SIZE, (PRint)frameBuffer->numTilesX - 1);
+    const PRint tyMax = PR_MIN(bottom / PR_TILE_SIZE, (PRint)frameBuffer->numTilesY - 1);
 
-    if (len <= 0)
+    for (PRint ty = tyMin; ty <= tyMax; ++ty)
     {
-        sides[start.y].offset = start.y * pitch + start.x;
-        return;
+        for (PRint tx = txMin; tx <= txMax; ++tx)
+        {
+            if (frameBuffer->clearTiles[ty * frameBuffer->numTilesX + tx] != 0)
+                _materialize_tile(frameBuffer, (PRuint)tx, (PRuint)ty);
+        }
     }
+}
+
+// Returns the output color of the specified color index.
+PR_INLINE pr_color _expand_color(const pr_color* palette, PRcolorindex colorIndex)
+{
+    #ifdef PR_COLOR_BUFFER_24BIT
+    return colorIndex;
+    #else
+    return palette[colorIndex];
+    #endif
+}
+
+void _pr_framebuffer_expand_colors(const pr_framebuffer* frameBuffer, const pr_color* palette, pr_color* dst)
+{
+    const pr_color clearColor = _expand_color(palette, frameBuffer->clearColor);
 
-    // Compute offsets (need doubles for offset for better precision, because the range is larger)
-    PRdouble offsetStart = (PRdouble)(start.y * pitch + start.x);
-    PRdouble offsetEnd   = (PRdouble)(end.y * pitch + end.x);
-    PRdouble offsetStep  = (offsetEnd - offsetStart) / len;
+    for (PRuint y = 0; y < frameBuffer->height; ++y)
+    {
+        const PRubyte* flags = &(frameBuffer->clearTiles[(y / PR_TILE_SIZE) * frameBuffer->numTilesX]);
+        const PRcolorindex* colors = PR_FRAMEBUFFER_COLOR_PTR(frameBuffer, y * frameBuffer->width);
 
-    PRinterp zStep       = (end.z - start.z) / len;
-    PRinterp uStep       = (end.u - start.u) / len;
-    PRinterp vStep       = (end.v - start.v) / len;
+        for (PRuint left = 0; left < frameBuffer->width; left += PR_TILE_SIZE, ++flags)
+        {
+            const PRuint num = PR_MIN(PR_TILE_SIZE, frameBuffer->width - left);
+            pr_color* dstEnd = dst + num;
+
+            if (frameBuffer->clearPending && (*flags & PR_COLOR_BUFFER_BIT) != 0)
+            {
+                // Expand tile directly from the clear color
+                while (dst != dstEnd)
+                    *dst++ = clearColor;
+            }
+            else
+            {
+                const PRcolorindex* src = colors;
+
+                while (dst != dstEnd)
+                {
+                    *dst++ = _expand_color(palette, *src);
+                    src += PR_FRAMEBUFFER_COLOR_STRIDE;
+                }
+            }
+
+            colors += num * PR_FRAMEBUFFER_COLOR_STRIDE;
+        }
+    }
+}
+
+// Computes the minimal depth of all pixels inside the specified block.
+static void _depth_block_update(pr_framebuffer* frameBuffer, pr_depth_block* block, PRint bx, PRint by)
+{
+    const PRint left = bx * PR_BLOCK_SIZE;
+    const PRint top = by * PR_BLOCK_SIZE;
+    const PRint right = PR_MIN(left + PR_BLOCK_SIZE, (PRint)frameBuffer->width);
+    const PRint bottom = PR_MIN(top + PR_BLOCK_SIZE, (PRint)frameBuffer->height);
+
+    PRdepthtype zMin = block->zMax;
+
+    for (PRint y = top; y < bottom; ++y)
+    {
+        const PRdepthtype* depth = PR_FRAMEBUFFER_DEPTH_PTR(frameBuffer, y * frameBuffer->width + left);
+
+        for (PRint x = left; x < right; ++x, depth += PR_FRAMEBUFFER_DEPTH_STRIDE)
+            PR_CLAMP_SMALLEST(zMin, *depth);
+    }
+
+    block->zMin = zMin;
+    block->dirty = PR_FALSE;
+}
+
+PRboolean _pr_framebuffer_is_occluded(
+    pr_framebuffer* frameBuffer, PRint left, PRint top, PRint right, PRint bottom, PRdepthtype depth)
+{
+    const PRint bxMin = left / PR_BLOCK_SIZE;
+    const PRint bxMax = right / PR_BLOCK_SIZE;
+    const PRint byMin = top / PR_BLOCK_SIZE;
+    const PRint byMax = bottom / PR_BLOCK_SIZE;
+
+    for (PRint by = byMin; by <= byMax; ++by)
+    {
+        pr_depth_block* block = &(frameBuffer->depthBlocks[by * frameBuffer->numBlocksX + bxMin]);
+
+        for (PRint bx = bxMin; bx <= bxMax; ++bx, ++block)
+        {
+            if (depth < block->zMin)
+                continue;
+
+            // Update out of date block and test again
+            if (!block->dirty)
+                return PR_FALSE;
+
+            _depth_block_update(frameBuffer, block, bx, by);
+
+            if (depth >= block->zMin)
+                return PR_FALSE;
+        }
+    }
+
+    return PR_TRUE;
+}
+
+// Returns the largest integer which is less than or equal to a/b (b must be positive).
+static PRlong _floor_div(PRlong a, PRlong b)
+{
+    PRlong q = a / b;
+    if (a % b < 0)
+        --q;
+    return q;
+}
+
+void _pr_framebuffer_setup_scanlines(
+    pr_framebuffer* frameBuffer, pr_scaline_side* sides, pr_raster_vertex start, pr_raster_vertex end, PRint yMin, PRint yMax)
+{
+    // Get scanlines whose pixel centers are inside the range [start.y, end.y)
+    PRint yFirst = PR_SUBPIXEL_CEIL(start.y);
+    PRint yLast = PR_SUBPIXEL_CEIL(end.y) - 1;
+
+    PR_CLAMP_LARGEST(yFirst, yMin);
+    PR_CLAMP_SMALLEST(yLast, yMax);
+
+    if (yFirst > yLast)
+        return;
+
+    /*
+    The edge intersects the pixel center of scanline y at x(y) = start.x + (y*S - start.y) * dx/dy,
+    where S is the sub-pixel scale. The first pixel on or right of the edge is ceil(x(y)/S) = ceil(num/den)
+    with num = start.x*dy + (y*S - start.y)*dx and den = dy*S. This is stepped with an integer DDA.
+    */
+    const PRlong dx = (PRlong)(end.x - start.x);
+    const PRlong dy = (PRlong)(end.y - start.y);
+
+    const PRlong den = dy * PR_SUBPIXEL_SCALE;
+    const PRlong num = (PRlong)start.x * dy + ((PRlong)yFirst * PR_SUBPIXEL_SCALE - start.y) * dx;
+
+    const PRlong numStep = dx * PR_SUBPIXEL_SCALE;
+    const PRlong xStep = _floor_div(numStep, den);
+    const PRlong errStep = numStep - xStep * den;
+
+    PRlong x = -_floor_div(-num, den);
+    PRlong err = x * den - num;
 
     // Fill scanline sides
-    pr_scaline_side* sidesEnd = &(sides[end.y]);
+    const PRint pitch = (PRint)frameBuffer->width;
 
-    for (sides += start.y; sides <= sidesEnd; ++sides)
+    for (PRint y = yFirst; y <= yLast; ++y)
     {
         // Setup scanline side
-        sides->offset = (PRint)(offsetStart + 0.5);
-        sides->z = start.z;
-        sides->u = start.u;
-        sides->v = start.v;
+        sides[y].offset = y * pitch + (PRint)x;
 
         // Next step
-        offsetStart += offsetStep;
-        start.z += zStep;
-        start.u += uStep;
-        start.v += vStep;
+        x += xStep;
+        err -= errStep;
+
+        if (err < 0)
+        {
+            ++x;
+            err += den;
+        }
     }
 }
 
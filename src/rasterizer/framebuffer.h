@@ -12,18 +12,29 @@
 #include "pixel.h"
 #include "enums.h"
 #include "raster_vertex.h"
+#include "static_config.h"
+#include "color.h"
 
 
 //! Raster scanline side structure
 typedef struct pr_scaline_side
 {
     PRint       offset; //!< Pixel offset in framebuffer
-    PRinterp    z;
-    PRinterp    u;
-    PRinterp    v;
 }
 pr_scaline_side;
 
+/**
+Depth range of a block of PR_BLOCK_SIZE x PR_BLOCK_SIZE pixels (hierarchical z-buffer).
+Depth values only increase between two clears, so 'zMin' stays a valid lower bound even when it is out of date.
+*/
+typedef struct pr_depth_block
+{
+    PRdepthtype zMin;   //!< Lower bound of all depth values in this block.
+    PRdepthtype zMax;   //!< Upper bound of all depth values in this block.
+    PRboolean   dirty;  //!< Specifies whether depth values have been written since 'zMin' was computed.
+}
+pr_depth_block;
+
 //! Framebuffer structure
 typedef struct pr_framebuffer
 {
@@ -32,32 +43,103 @@ typedef struct pr_framebuffer
     #ifdef PR_MERGE_COLOR_AND_DEPTH_BUFFERS
     pr_pixel*           pixels;
     #else
-    PRubyte*            colors;
-    PRdepthtype         depths;
+    PRcolorindex*       colors;         //!< Color plane
+    PRdepthtype*        depths;         //!< Depth plane
     #endif
     pr_scaline_side*    scanlinesStart; //!< Start offsets to scanlines
     pr_scaline_side*    scanlinesEnd;   //!< End offsets to scanlines
+    pr_depth_block*     depthBlocks;    //!< Depth ranges of all pixel blocks
+    PRuint              numBlocksX;     //!< Number of pixel blocks in horizontal direction
+    PRuint              numBlocksY;     //!< Number of pixel blocks in vertical direction
+    PRubyte*            clearTiles;     //!< Pending clear flags of all screen tiles (see PR_FAST_CLEAR)
+    PRuint              numTilesX;      //!< Number of screen tiles in horizontal direction
+    PRuint              numTilesY;      //!< Number of screen tiles in vertical direction
+    PRboolean           clearPending;   //!< Specifies whether any screen tile may have pending clear flags
+    PRcolorindex        clearColor;     //!< Color index for pending color clears
+    PRdepthtype         clearDepth;     //!< Depth value for pending depth clears
 }
 pr_framebuffer;
 
 
+/*
+Pointers to the color and depth values of the pixel at the specified offset,
+and the strides to move such pointers to the next pixel (independent of the buffer layout).
+*/
+#ifdef PR_MERGE_COLOR_AND_DEPTH_BUFFERS
+#   define PR_FRAMEBUFFER_COLOR_PTR(f, offset)  (&((f)->pixels[offset].colorIndex))
+#   define PR_FRAMEBUFFER_DEPTH_PTR(f, offset)  (&((f)->pixels[offset].depth))
+#   define PR_FRAMEBUFFER_COLOR_STRIDE          (sizeof(pr_pixel)/sizeof(PRcolorindex))
+#   define PR_FRAMEBUFFER_DEPTH_STRIDE          (sizeof(pr_pixel)/sizeof(PRdepthtype))
+#else
+#   define PR_FRAMEBUFFER_COLOR_PTR(f, offset)  ((f)->colors + (offset))
+#   define PR_FRAMEBUFFER_DEPTH_PTR(f, offset)  ((f)->depths + (offset))
+#   define PR_FRAMEBUFFER_COLOR_STRIDE          1
+#   define PR_FRAMEBUFFER_DEPTH_STRIDE          1
+#endif
+
+
 pr_framebuffer* _pr_framebuffer_create(PRuint width, PRuint height);
 void _pr_framebuffer_delete(pr_framebuffer* frameBuffer);
 
+/**
+Clears the specified framebuffer. If the PR_FAST_CLEAR state is enabled, only the clear flags
+of each screen tile are set, and the pixels of a tile are cleared before they are written the first time.
+*/
 void _pr_framebuffer_clear(pr_framebuffer* frameBuffer, PRfloat clearDepth, PRbitfield clearFlags);
 
-//! Sets the start and end offsets of the specified scanlines.
+//! Executes all pending clears of the screen tiles which overlap the specified pixel rectangle.
+void _pr_framebuffer_materialize_tiles(pr_framebuffer* frameBuffer, PRint left, PRint top, PRint right, PRint bottom);
+
+/**
+Converts the color plane into RGB colors with the specified palette (used by the platform contexts).
+Screen tiles with a pending color clear are directly expanded from the clear color.
+\param[out] dst Pointer to the output colors. This must have (width * height) entries.
+*/
+void _pr_framebuffer_expand_colors(const pr_framebuffer* frameBuffer, const pr_color* palette, pr_color* dst);
+
+/**
+Sets the start and end offsets of the specified scanlines for the polygon edge from 'start' to 'end' (with start.y <= end.y).
+The offset of each scanline points to the first pixel whose center is on or right of the edge.
+Scanlines are covered from the top vertex (inclusive) to the bottom vertex (exclusive) due to the top-left fill rule.
+Only the scanlines inside the range [yMin, yMax] are written.
+*/
 void _pr_framebuffer_setup_scanlines(
-    pr_framebuffer* frameBuffer, pr_scaline_side* sides, pr_raster_vertex start, pr_raster_vertex end
+    pr_framebuffer* frameBuffer, pr_scaline_side* sides, pr_raster_vertex start, pr_raster_vertex end, PRint yMin, PRint yMax
 );
 
+/**
+Returns PR_TRUE if a primitive whose depth values are all less than 'depth' is completely hidden
+inside the specified pixel rectangle. Out of date blocks are updated on demand.
+*/
+PRboolean _pr_framebuffer_is_occluded(
+    pr_framebuffer* frameBuffer, PRint left, PRint top, PRint right, PRint bottom, PRdepthtype depth
+);
+
+//! Returns the depth block which contains the specified pixel.
+PR_INLINE pr_depth_block* _pr_framebuffer_depth_block(pr_framebuffer* frameBuffer, PRint x, PRint y)
+{
+    return &(frameBuffer->depthBlocks[(y / PR_BLOCK_SIZE) * frameBuffer->numBlocksX + (x / PR_BLOCK_SIZE)]);
+}
+
+//! Marks the specified depth block as modified with depth values up to 'depthMax'.
+PR_INLINE void _pr_depth_block_write(pr_depth_block* block, PRdepthtype depthMax)
+{
+    if (block->zMax < depthMax)
+        block->zMax = depthMax;
+    block->dirty = PR_TRUE;
+}
+
+//! Must be called before the pixels inside the specified rectangle are accessed (see PR_FAST_CLEAR).
+PR_INLINE void _pr_framebuffer_prepare_rect(pr_framebuffer* frameBuffer, PRint left, PRint top, PRint right, PRint bottom)
+{
+    if (frameBuffer->clearPending)
+        _pr_framebuffer_materialize_tiles(frameBuffer, left, top, right, bottom);
+}
+
 PR_INLINE void _pr_framebuffer_plot(pr_framebuffer* frameBuffer, PRuint x, PRuint y, PRcolorindex colorIndex)
 {
-    #ifdef PR_MERGE_COLOR_AND_DEPTH_BUFFERS
-    frameBuffer->pixels[y * frameBuffer->width + x].colorIndex = colorIndex;
-    #else
-    frameBuffer->colors[y * frameBuffer->width + x] = colorIndex;
-    #endif
+    _pr_framebuffer_prepare_rect(frameBuffer, (PRint)x, (PRint)y, (PRint)x, (PRint)y);
+    *PR_FRAMEBUFFER_COLOR_PTR(frameBuffer, y * frameBuffer->width + x) = colorIndex;
 }
 
 
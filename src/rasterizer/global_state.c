@@ -6,78 +6,118 @@
  */
 
 #include "global_state.h"
+#include "state_machine.h"
 #include "static_config.h"
 #include "error.h"
 #include "render.h"
+#include "ext_math.h"
 
 
 pr_global_state _globalState;
 
-#define _IMM_VERTICES   _globalState.immModeVertexBuffer.vertices
-#define _IMM_CUR_VERTEX _IMM_VERTICES[_globalState.immModeVertCounter]
+#define _IMM_VERTICES   PR_STATE_MACHINE.immModeVertexBuffer.vertices
+#define _IMM_CUR_VERTEX _IMM_VERTICES[PR_STATE_MACHINE.immModeVertCounter]
 
 
 void _pr_global_state_init()
 {
-    _pr_texture_singular_init(&(_globalState.singularTexture));
+    // Initialize worker threads (the calling thread is also used as worker)
+    PRuint numWorkers = 0;
 
-    // Initialize immediate mode
-    _pr_vertexbuffer_singular_init(&(_globalState.immModeVertexBuffer), PR_NUM_IMMEDIATE_VERTICES);
-    _globalState.immModeActive      = PR_FALSE;
-    _globalState.immModeVertCounter = 0;
-    _globalState.immModePrimitives  = PR_POINTS;
+    #ifdef PR_MULTI_THREADING
+    numWorkers = PR_MIN(_pr_thread_num_processors() - 1, PR_MAX_NUM_WORKER_THREADS);
+    #endif
+
+    _pr_thread_pool_init(&(_globalState.threadPool), numWorkers);
+
+    _pr_texture_loader_init(&(_globalState.textureLoader));
 }
 
 void _pr_global_state_release()
 {
-    _pr_texture_singular_clear(&(_globalState.singularTexture));
-    _pr_vertexbuffer_singular_clear(&(_globalState.immModeVertexBuffer));
+    // Terminate the texture loader first, its current load might use the thread pool
+    _pr_texture_loader_release(&(_globalState.textureLoader));
+    _pr_thread_pool_release(&(_globalState.threadPool));
 }
 
 static void _immediate_mode_flush()
 {
-    if (_globalState.immModeVertCounter == 0)
+    if (PR_STATE_MACHINE.immModeVertCounter == 0)
         return;
 
-    // Draw current vertex buffer
-    switch (_globalState.immModePrimitives)
+    if (PR_STATE_MACHINE.immModePrimitives == PR_LINE_LOOP && PR_STATE_MACHINE.immModeLoopSplit)
     {
-        case PR_POINTS:
-            _pr_render_points(_globalState.immModeVertCounter, 0, &(_globalState.immModeVertexBuffer));
-            break;
+        // Close the line loop with its first vertex (see '_immediate_mode_flush_and_continue')
+        _IMM_CUR_VERTEX = _IMM_VERTICES[0];
+
+        _pr_render_primitives(
+            PR_LINE_STRIP,
+            PR_STATE_MACHINE.immModeVertCounter,
+            1,
+            &(PR_STATE_MACHINE.immModeVertexBuffer)
+        );
+    }
+    else
+    {
+        // Draw current vertex buffer
+        _pr_render_primitives(
+            PR_STATE_MACHINE.immModePrimitives,
+            PR_STATE_MACHINE.immModeVertCounter,
+            0,
+            &(PR_STATE_MACHINE.immModeVertexBuffer)
+        );
+    }
 
-        case PR_LINES:
-            _pr_render_lines(_globalState.immModeVertCounter, 0, &(_globalState.immModeVertexBuffer));
-            break;
-        case PR_LINE_STRIP:
-            _pr_render_line_strip(_globalState.immModeVertCounter, 0, &(_globalState.immModeVertexBuffer));
-            break;
-        case PR_LINE_LOOP:
-            _pr_render_line_loop(_globalState.immModeVertCounter, 0, &(_globalState.immModeVertexBuffer));
-            break;
+    // Reset vertex counter
+    PR_STATE_MACHINE.immModeVertCounter = 0;
+}
 
-        case PR_TRIANGLES:
-            _pr_render_triangles(_globalState.immModeVertCounter, 0, &(_globalState.immModeVertexBuffer));
-            break;
+// Draws the current vertices and keeps the vertices which are shared with the next primitives of a strip or fan
+static void _immediate_mode_flush_and_continue()
+{
+    const PRsizei numVertices = PR_STATE_MACHINE.immModeVertCounter;
+
+    if (PR_STATE_MACHINE.immModePrimitives == PR_LINE_LOOP)
+    {
+        // Draw the vertices as line strip, but keep the first vertex of the loop to close it at the end
+        const PRsizei first = (PR_STATE_MACHINE.immModeLoopSplit ? 1 : 0);
+
+        _pr_render_primitives(PR_LINE_STRIP, numVertices - first, first, &(PR_STATE_MACHINE.immModeVertexBuffer));
+
+        _IMM_VERTICES[1] = _IMM_VERTICES[numVertices - 1];
+        PR_STATE_MACHINE.immModeVertCounter = 2;
+        PR_STATE_MACHINE.immModeLoopSplit   = PR_TRUE;
+        return;
+    }
+
+    _immediate_mode_flush();
+
+    switch (PR_STATE_MACHINE.immModePrimitives)
+    {
         case PR_TRIANGLE_STRIP:
-            _pr_render_triangle_strip(_globalState.immModeVertCounter, 0, &(_globalState.immModeVertexBuffer));
+            // Keep last edge (the buffer is flushed with an even number of vertices, so the winding order is preserved)
+            _IMM_VERTICES[0] = _IMM_VERTICES[numVertices - 2];
+            _IMM_VERTICES[1] = _IMM_VERTICES[numVertices - 1];
+            PR_STATE_MACHINE.immModeVertCounter = 2;
             break;
+
         case PR_TRIANGLE_FAN:
-            _pr_render_triangle_fan(_globalState.immModeVertCounter, 0, &(_globalState.immModeVertexBuffer));
+            // Keep center and last vertex
+            _IMM_VERTICES[1] = _IMM_VERTICES[numVertices - 1];
+            PR_STATE_MACHINE.immModeVertCounter = 2;
             break;
 
-        default:
-            PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
+        case PR_LINE_STRIP:
+            // Keep last vertex
+            _IMM_VERTICES[0] = _IMM_VERTICES[numVertices - 1];
+            PR_STATE_MACHINE.immModeVertCounter = 1;
             break;
     }
-
-    // Reset vertex counter
-    _globalState.immModeVertCounter = 0;
 }
 
 void _pr_immediate_mode_begin(PRenum primitives)
 {
-    if (_globalState.immModeActive)
+    if (PR_STATE_MACHINE.immModeActive)
     {
         PR_ERROR(PR_ERROR_INVALID_STATE);
         return;
@@ -89,14 +129,15 @@ void _pr_immediate_mode_begin(PRenum primitives)
     }
 
     // Store primitive type and reset vertex counter
-    _globalState.immModeActive      = PR_TRUE;
-    _globalState.immModePrimitives  = primitives;
-    _globalState.immModeVertCounter = 0;
+    PR_STATE_MACHINE.immModeActive      = PR_TRUE;
+    PR_STATE_MACHINE.immModePrimitives  = primitives;
+    PR_STATE_MACHINE.immModeVertCounter = 0;
+    PR_STATE_MACHINE.immModeLoopSplit   = PR_FALSE;
 }
 
 void _pr_immediate_mode_end()
 {
-    if (!_globalState.immModeActive)
+    if (!PR_STATE_MACHINE.immModeActive)
     {
         PR_ERROR(PR_ERROR_INVALID_STATE);
         return;
@@ -105,36 +146,32 @@ void _pr_immediate_mode_end()
     // Draw vertex buffer with current previously selected primitive
     _immediate_mode_flush();
 
-    _globalState.immModeActive = PR_FALSE;
+    PR_STATE_MACHINE.immModeActive = PR_FALSE;
 }
 
 void _pr_immediate_mode_texcoord(PRfloat u, PRfloat v)
 {
     // Store texture coordinate for current vertex
-    _IMM_CUR_VERTEX.texCoord.x = u;
-    _IMM_CUR_VERTEX.texCoord.y = v;
+    _pr_vertex_set_texcoord(&(_IMM_CUR_VERTEX), u, v);
 }
 
 void _pr_immediate_mode_vertex(PRfloat x, PRfloat y, PRfloat z, PRfloat w)
 {
     // Store vertex coordinate for current vertex
-    _IMM_CUR_VERTEX.coord.x = x;
-    _IMM_CUR_VERTEX.coord.y = y;
-    _IMM_CUR_VERTEX.coord.z = z;
-    _IMM_CUR_VERTEX.coord.w = w;
+    _pr_vertex_set_coord(&(_IMM_CUR_VERTEX), x, y, z, w);
 
     // Count to next vertex
-    ++_globalState.immModeVertCounter;
+    ++PR_STATE_MACHINE.immModeVertCounter;
 
     // Check if limit is exceeded
-    if (_globalState.immModeVertCounter >= PR_NUM_IMMEDIATE_VERTICES)
-        _immediate_mode_flush();
+    if (PR_STATE_MACHINE.immModeVertCounter >= PR_NUM_IMMEDIATE_VERTICES)
+        _immediate_mode_flush_and_continue();
 
-    switch (_globalState.immModePrimitives)
+    switch (PR_STATE_MACHINE.immModePrimitives)
     {
         case PR_TRIANGLES:
-            if ( _globalState.immModeVertCounter + 3 >= PR_NUM_IMMEDIATE_VERTICES &&
-                 _globalState.immModeVertCounter % 3 == 0 )
+            if ( PR_STATE_MACHINE.immModeVertCounter + 3 >= PR_NUM_IMMEDIATE_VERTICES &&
+                 PR_STATE_MACHINE.immModeVertCounter % 3 == 0 )
             {
                 _immediate_mode_flush();
             }
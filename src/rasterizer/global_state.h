@@ -9,26 +9,21 @@
 #define PR_GLOBAL_STATE_H
 
 
-#include "texture.h"
 #include "vertexbuffer.h"
+#include "thread_pool.h"
+#include "texture_loader.h"
 
 
-#define PR_SINGULAR_TEXTURE         _globalState.singularTexture
 #define PR_SINGULAR_VERTEXBUFFER    _globalState.singularVertexBuffer
 
-// Number of vertices for the vertex buffer of the immediate draw mode (prBegin/prEnd)
-#define PR_NUM_IMMEDIATE_VERTICES   32
-
 
 typedef struct pr_global_state
 {
-    pr_texture      singularTexture;        // Texture with single color
+    // Multi-threaded rasterization (shared by all contexts)
+    pr_thread_pool      threadPool;
 
-    // Immediate mode
-    pr_vertexbuffer immModeVertexBuffer;
-    PRboolean       immModeActive;
-    PRsizei         immModeVertCounter;
-    PRenum          immModePrimitives;
+    // Asynchronous texture image loads (shared by all contexts)
+    pr_texture_loader   textureLoader;
 }
 pr_global_state;
 
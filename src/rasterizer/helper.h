@@ -21,5 +21,15 @@
 
 #define PR_ZERO_MEMORY(m)   memset(&m, 0, sizeof(m))
 
+// Marks a parameter which is required by a callback signature but not used by this callback
+#define PR_UNUSED(x)        (void)(x)
+
+// 16-bit element count in .pico files, which announces an extended header with a 32-bit element count
+// if it is followed by the 32-bit magic number (otherwise it is the element count of a file with exactly 65535 elements).
+// The magic number can not be the start of valid 16-bit data: it would be a NaN vertex coordinate, or two indices
+// of 65535, which are out of range for vertex buffers with 16-bit counts.
+#define PR_FILE_EXTENDED_HEADER 0xffff
+#define PR_FILE_EXTENDED_MAGIC  0xffffffff
+
 
 #endif
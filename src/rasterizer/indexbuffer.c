@@ -9,8 +9,12 @@
 #include "helper.h"
 #include "error.h"
 #include "state_machine.h"
+#include "enums.h"
+#include "file_mapping.h"
 
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 pr_indexbuffer* _pr_indexbuffer_create()
@@ -18,6 +22,7 @@ pr_indexbuffer* _pr_indexbuffer_create()
     pr_indexbuffer* indexBuffer = PR_MALLOC(pr_indexbuffer);
 
     indexBuffer->numIndices = 0;
+    indexBuffer->format     = PR_USHORT;
     indexBuffer->indices    = NULL;
 
     _pr_ref_add(indexBuffer);
@@ -36,32 +41,66 @@ void _pr_indexbuffer_delete(pr_indexbuffer* indexBuffer)
     }
 }
 
-static void _indexbuffer_resize(pr_indexbuffer* indexBuffer, PRushort numIndices)
+PRsizei _pr_indexbuffer_format_size(PRenum format)
+{
+    switch (format)
+    {
+        case PR_UBYTE:
+            return sizeof(PRubyte);
+        case PR_USHORT:
+            return sizeof(PRushort);
+        case PR_UINT:
+            return sizeof(PRuint);
+    }
+    return 0;
+}
+
+static void _indexbuffer_resize(pr_indexbuffer* indexBuffer, PRsizei numIndices, PRenum format)
 {
     // Check if index buffer must be reallocated
-    if (indexBuffer->indices == NULL || indexBuffer->numIndices != numIndices)
+    if (indexBuffer->indices == NULL || indexBuffer->numIndices != numIndices || indexBuffer->format != format)
     {
         // Create new index buffer data
         PR_FREE(indexBuffer->indices);
 
         indexBuffer->numIndices = numIndices;
-        indexBuffer->indices    = PR_CALLOC(PRushort, numIndices);
+        indexBuffer->format     = format;
+        indexBuffer->indices    = PR_CALLOC(PRubyte, numIndices * _pr_indexbuffer_format_size(format));
     }
 }
 
-void _pr_indexbuffer_data(pr_indexbuffer* indexBuffer, const PRushort* indices, PRushort numIndices)
+void _pr_indexbuffer_data(pr_indexbuffer* indexBuffer, const PRvoid* indices, PRsizei numIndices, PRenum format)
 {
     if (indexBuffer == NULL || indices == NULL)
     {
         PR_ERROR(PR_ERROR_NULL_POINTER);
         return;
     }
+    if (numIndices < 0 || _pr_indexbuffer_format_size(format) == 0)
+    {
+        PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
+        return;
+    }
 
-    _indexbuffer_resize(indexBuffer, numIndices);
+    _indexbuffer_resize(indexBuffer, numIndices, format);
 
     // Fill index buffer
-    while (numIndices-- > 0)
-        indexBuffer->indices[numIndices] = indices[numIndices];
+    memcpy(indexBuffer->indices, indices, numIndices * _pr_indexbuffer_format_size(format));
+}
+
+// Returns the index format for the specified index size (in bytes) of the extended .pico file header, or 0 if the size is invalid.
+static PRenum _index_format_from_size(PRubyte indexSize)
+{
+    switch (indexSize)
+    {
+        case 1:
+            return PR_UBYTE;
+        case 2:
+            return PR_USHORT;
+        case 4:
+            return PR_UINT;
+    }
+    return 0;
 }
 
 void _pr_indexbuffer_data_from_file(pr_indexbuffer* indexBuffer, PRsizei* numIndices, FILE* file)
@@ -75,11 +114,131 @@ void _pr_indexbuffer_data_from_file(pr_indexbuffer* indexBuffer, PRsizei* numInd
     // Read number of indices
     PRushort numInd = 0;
     fread(&numInd, sizeof(PRushort), 1, file);
-    *numIndices = (PRsizei)numInd;
 
-    _indexbuffer_resize(indexBuffer, *numIndices);
+    PRenum format = PR_USHORT;
+    PRuint numInd32 = numInd;
+
+    *numIndices = 0;
+
+    if (numInd == PR_FILE_EXTENDED_HEADER && _pr_file_read_extended_magic(file))
+    {
+        // Read index size and 32-bit number of indices
+        PRubyte indexSize = 0;
+
+        numInd32 = 0;
+
+        fread(&indexSize, sizeof(PRubyte), 1, file);
+        fread(&numInd32, sizeof(PRuint), 1, file);
+
+        format = _index_format_from_size(indexSize);
+        if (format == 0)
+        {
+            PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
+            return;
+        }
+    }
+
+    // Check that all indices are inside the file before allocating them
+    if (numInd32 > INT_MAX || _pr_file_remaining_size(file) / (size_t)_pr_indexbuffer_format_size(format) < numInd32)
+    {
+        PR_ERROR(PR_ERROR_UNEXPECTED_EOF);
+        return;
+    }
+
+    *numIndices = (PRsizei)numInd32;
+
+    _indexbuffer_resize(indexBuffer, *numIndices, format);
 
     // Read all indices
-    fread(indexBuffer->indices, sizeof(PRushort), *numIndices, file);
+    if (fread(indexBuffer->indices, _pr_indexbuffer_format_size(format), *numIndices, file) != (size_t)*numIndices)
+        PR_ERROR(PR_ERROR_UNEXPECTED_EOF);
 }
 
+size_t _pr_indexbuffer_data_from_memory(pr_indexbuffer* indexBuffer, PRsizei* numIndices, const PRubyte* data, size_t size)
+{
+    if (indexBuffer == NULL || numIndices == NULL || data == NULL)
+    {
+        PR_ERROR(PR_ERROR_NULL_POINTER);
+        return 0;
+    }
+
+    // Read number of indices
+    size_t offset = sizeof(PRushort);
+    PRushort numInd = 0;
+    PRuint numInd32 = 0;
+    PRenum format = PR_USHORT;
+
+    if (size < offset)
+    {
+        PR_ERROR(PR_ERROR_UNEXPECTED_EOF);
+        return 0;
+    }
+
+    memcpy(&numInd, data, sizeof(PRushort));
+    numInd32 = numInd;
+
+    if (numInd == PR_FILE_EXTENDED_HEADER && _pr_file_has_extended_magic(data + offset, size - offset))
+    {
+        // Read index size and 32-bit number of indices
+        offset += sizeof(PRuint);
+
+        if (size < offset + sizeof(PRubyte) + sizeof(PRuint))
+        {
+            PR_ERROR(PR_ERROR_UNEXPECTED_EOF);
+            return 0;
+        }
+
+        format = _index_format_from_size(data[offset]);
+        if (format == 0)
+        {
+            PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
+            return 0;
+        }
+
+        memcpy(&numInd32, data + offset + sizeof(PRubyte), sizeof(PRuint));
+        offset += sizeof(PRubyte) + sizeof(PRuint);
+    }
+
+    // Check that all indices are inside the memory block
+    const size_t indexSize = (size_t)_pr_indexbuffer_format_size(format);
+
+    if (numInd32 > INT_MAX || (size - offset) / indexSize < numInd32)
+    {
+        PR_ERROR(PR_ERROR_UNEXPECTED_EOF);
+        return 0;
+    }
+
+    *numIndices = (PRsizei)numInd32;
+
+    // Copy all indices at once (the memory block does not need to be aligned)
+    _indexbuffer_resize(indexBuffer, *numIndices, format);
+    memcpy(indexBuffer->indices, data + offset, indexSize * numInd32);
+
+    return offset + indexSize * numInd32;
+}
+
+void _pr_indexbuffer_unpack(const pr_indexbuffer* indexBuffer, PRsizei firstIndex, PRsizei numIndices, PRuint* dst)
+{
+    switch (indexBuffer->format)
+    {
+        case PR_UBYTE:
+        {
+            const PRubyte* src = (const PRubyte*)indexBuffer->indices + firstIndex;
+            for (PRsizei i = 0; i < numIndices; ++i)
+                dst[i] = src[i];
+        }
+        break;
+
+        case PR_USHORT:
+        {
+            const PRushort* src = (const PRushort*)indexBuffer->indices + firstIndex;
+            for (PRsizei i = 0; i < numIndices; ++i)
+                dst[i] = src[i];
+        }
+        break;
+
+        case PR_UINT:
+            memcpy(dst, (const PRuint*)indexBuffer->indices + firstIndex, sizeof(PRuint)*numIndices);
+            break;
+    }
+}
@@ -16,8 +16,9 @@
 
 typedef struct pr_indexbuffer
 {
-    PRushort    numIndices;
-    PRushort*   indices;
+    PRsizei     numIndices;
+    PRenum      format;     //!< Index format: PR_UBYTE, PR_USHORT or PR_UINT.
+    PRvoid*     indices;    //!< Raw index data in the index format.
 }
 pr_indexbuffer;
 
@@ -25,8 +26,23 @@ pr_indexbuffer;
 pr_indexbuffer* _pr_indexbuffer_create();
 void _pr_indexbuffer_delete(pr_indexbuffer* indexBuffer);
 
-void _pr_indexbuffer_data(pr_indexbuffer* indexBuffer, const PRushort* indices, PRushort numIndices);
+//! Returns the size (in bytes) of a single index of the specified format, or 0 if the format is invalid.
+PRsizei _pr_indexbuffer_format_size(PRenum format);
+
+void _pr_indexbuffer_data(pr_indexbuffer* indexBuffer, const PRvoid* indices, PRsizei numIndices, PRenum format);
 void _pr_indexbuffer_data_from_file(pr_indexbuffer* indexBuffer, PRsizei* numIndices, FILE* file);
 
+/**
+Sets the index buffer data from the specified memory block, which has the same format as a file for '_pr_indexbuffer_data_from_file'.
+\return Number of bytes which have been read from the memory block, or 0 on failure.
+*/
+size_t _pr_indexbuffer_data_from_memory(pr_indexbuffer* indexBuffer, PRsizei* numIndices, const PRubyte* data, size_t size);
+
+/**
+Converts the indices in the range [firstIndex, firstIndex + numIndices) into 32-bit indices.
+\param[out] dst Pointer to the output indices. This must have 'numIndices' entries.
+*/
+void _pr_indexbuffer_unpack(const pr_indexbuffer* indexBuffer, PRsizei firstIndex, PRsizei numIndices, PRuint* dst);
+
 
 #endif
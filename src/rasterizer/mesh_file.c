@@ -0,0 +1,36 @@
+/*
+ * mesh_file.c
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#include "mesh_file.h"
+#include "file_mapping.h"
+#include "error.h"
+
+
+void _pr_mesh_data_from_file(
+    pr_vertexbuffer* vertexBuffer, pr_indexbuffer* indexBuffer, PRsizei* numVertices, PRsizei* numIndices, const char* filename)
+{
+    if (vertexBuffer == NULL || numVertices == NULL || filename == NULL || ( indexBuffer != NULL && numIndices == NULL ))
+    {
+        PR_ERROR(PR_ERROR_NULL_POINTER);
+        return;
+    }
+
+    pr_file_mapping mapping;
+    if (!_pr_file_mapping_open(&mapping, filename))
+    {
+        PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
+        return;
+    }
+
+    // Read vertex block and index block directly from the mapped file
+    const size_t offset = _pr_vertexbuffer_data_from_memory(vertexBuffer, numVertices, mapping.data, mapping.size);
+
+    if (offset > 0 && indexBuffer != NULL)
+        _pr_indexbuffer_data_from_memory(indexBuffer, numIndices, mapping.data + offset, mapping.size - offset);
+
+    _pr_file_mapping_close(&mapping);
+}
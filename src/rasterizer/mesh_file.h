@@ -0,0 +1,25 @@
+/*
+ * mesh_file.h
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#ifndef PR_MESH_FILE_H
+#define PR_MESH_FILE_H
+
+
+#include "vertexbuffer.h"
+#include "indexbuffer.h"
+
+
+/**
+Loads the vertex data and (optionally) the index data of a .pico file, which is mapped into memory.
+\param[in] indexBuffer Optional index buffer. If this is null, only the vertex data is loaded.
+*/
+void _pr_mesh_data_from_file(
+    pr_vertexbuffer* vertexBuffer, pr_indexbuffer* indexBuffer, PRsizei* numVertices, PRsizei* numIndices, const char* filename
+);
+
+
+#endif
@@ -0,0 +1,21 @@
+/*
+ * raster_context.c
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#include "raster_context.h"
+
+
+void _pr_raster_context_init(pr_raster_context* context)
+{
+    context->numPolyVerts = 0;
+    _pr_vertex_cache_init(&(context->vertexCache));
+}
+
+void _pr_raster_context_release(pr_raster_context* context)
+{
+    _pr_vertex_cache_release(&(context->vertexCache));
+    context->numPolyVerts = 0;
+}
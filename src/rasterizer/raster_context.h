@@ -0,0 +1,41 @@
+/*
+ * raster_context.h
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#ifndef PR_RASTER_CONTEXT_H
+#define PR_RASTER_CONTEXT_H
+
+
+#include "raster_vertex.h"
+#include "vertex_cache.h"
+
+
+//! Maximal number of vertices of a polygon during clipping.
+#define PR_MAX_NUM_POLYGON_VERTS 32
+
+
+/**
+Scratch state of the geometry pipeline (vertex cache, polygon clipping and setup).
+The render functions only work on an explicit raster context, so each thread or draw call can own one.
+*/
+typedef struct pr_raster_context
+{
+    pr_clip_vertex      clipVertices[PR_MAX_NUM_POLYGON_VERTS];         //!< Active polygon before projection.
+    pr_clip_vertex      clipVerticesTmp[PR_MAX_NUM_POLYGON_VERTS];
+    pr_raster_vertex    rasterVertices[PR_MAX_NUM_POLYGON_VERTS];       //!< Active polygon after projection.
+    pr_raster_vertex    rasterVerticesTmp[PR_MAX_NUM_POLYGON_VERTS];
+    PRint               numPolyVerts;                                   //!< Number of vertices of the active polygon.
+
+    pr_vertex_cache     vertexCache;                                    //!< Post-transform vertex cache of the current draw call.
+}
+pr_raster_context;
+
+
+void _pr_raster_context_init(pr_raster_context* context);
+void _pr_raster_context_release(pr_raster_context* context);
+
+
+#endif
@@ -10,6 +10,20 @@
 
 
 #include "types.h"
+#include "static_config.h"
+
+
+//! Number of fractional bits for sub-pixel precise raster coordinates (28.4 fixed-point).
+#define PR_SUBPIXEL_BITS            4
+//! Number of sub-pixel steps per pixel.
+#define PR_SUBPIXEL_SCALE           (1 << PR_SUBPIXEL_BITS)
+
+//! Returns the smallest pixel coordinate which is greater than or equal to the specified sub-pixel coordinate.
+#define PR_SUBPIXEL_CEIL(x)         (((x) + PR_SUBPIXEL_SCALE - 1) >> PR_SUBPIXEL_BITS)
+//! Returns the largest pixel coordinate which is less than or equal to the specified sub-pixel coordinate.
+#define PR_SUBPIXEL_FLOOR(x)        ((x) >> PR_SUBPIXEL_BITS)
+//! Returns the pixel coordinate which is nearest to the specified sub-pixel coordinate.
+#define PR_SUBPIXEL_ROUND(x)        (((x) + (PR_SUBPIXEL_SCALE >> 1)) >> PR_SUBPIXEL_BITS)
 
 
 //! Raster vertex structure before projection (for clipping)
@@ -24,11 +38,24 @@ typedef struct pr_clip_vertex
 }
 pr_clip_vertex;
 
+/**
+Affine transformation of texture coordinates, which maps the texture coordinates of a draw call
+into a texture region or into the layers of a texture array (see pr_texture_region).
+*/
+typedef struct pr_texcoord_transform
+{
+    PRfloat scaleU;
+    PRfloat scaleV;
+    PRfloat offsetU;
+    PRfloat offsetV;
+}
+pr_texcoord_transform;
+
 //! Raster vertex structure after projection
 typedef struct pr_raster_vertex
 {
-    PRint       x; //!< Screen coordinate X.
-    PRint       y; //!< Screen coordinate Y.
+    PRint       x; //!< Screen coordinate X (in 28.4 fixed-point format, pixel centers are at integral coordinates).
+    PRint       y; //!< Screen coordinate Y (in 28.4 fixed-point format, pixel centers are at integral coordinates).
     PRinterp    z; //!< Normalized device coordinate Z.
     PRinterp    u; //!< Inverse texture coordinate U.
     PRinterp    v; //!< Inverse texture coordinate V.
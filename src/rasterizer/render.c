@@ -12,48 +12,21 @@
 #include "ext_math.h"
 #include "matrix4.h"
 #include "error.h"
+#include "helper.h"
 #include "static_config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 
 // --- internals ---
 
-#define MAX_NUM_POLYGON_VERTS 32
+// Z clipping planes (in clip space)
+#define Z_CLIP_NEAR 1.0f
+#define Z_CLIP_FAR  100.0f
 
-static pr_clip_vertex _clipVertices[MAX_NUM_POLYGON_VERTS], _clipVerticesTmp[MAX_NUM_POLYGON_VERTS];
-static pr_raster_vertex _rasterVertices[MAX_NUM_POLYGON_VERTS], _rasterVerticesTmp[MAX_NUM_POLYGON_VERTS];
-static PRint _numPolyVerts = 0;
-
-#define _CVERT_VEC2(v) (*(pr_vector2*)(&((_clipVertices[v]).x)))
-
-static void _vertexbuffer_transform(PRsizei numVertices, PRsizei firstVertex, pr_vertexbuffer* vertexBuffer)
-{
-    _pr_vertexbuffer_transform(
-        numVertices,
-        firstVertex,
-        vertexBuffer,
-        &(PR_STATE_MACHINE.worldViewProjectionMatrix),
-        &(PR_STATE_MACHINE.viewport)
-    );
-}
-
-static void _vertexbuffer_transform_all(pr_vertexbuffer* vertexBuffer)
-{
-    _pr_vertexbuffer_transform_all(
-        vertexBuffer,
-        &(PR_STATE_MACHINE.worldViewProjectionMatrix),
-        &(PR_STATE_MACHINE.viewport)
-    );
-}
-
-static void _transform_vertex(pr_clip_vertex* clipVert, const pr_vertex* vert)
-{
-    _pr_matrix_mul_float4(&(clipVert->x), &(PR_STATE_MACHINE.worldViewProjectionMatrix), &(vert->coord.x));
-    clipVert->u = vert->texCoord.x;
-    clipVert->v = vert->texCoord.y;
-}
+#define _CVERT_VEC2(c, v) (*(pr_vector2*)(&(((c)->clipVertices[v]).x)))
 
 static void _project_vertex(pr_clip_vertex* vertex, const pr_viewport* viewport)
 {
@@ -66,9 +39,9 @@ static void _project_vertex(pr_clip_vertex* vertex, const pr_viewport* viewport)
     //vertex->z *= rhw;
     vertex->z = rhw;
 
-    // Transform vertex to screen coordiante (+0.5 is for rounding adjustment)
-    vertex->x = viewport->x + (vertex->x + 1.0f) * viewport->halfWidth + 0.5f;
-    vertex->y = viewport->y + (vertex->y + 1.0f) * viewport->halfHeight + 0.5f;
+    // Transform vertex to screen coordiante (-0.5 moves the pixel centers to integral coordinates)
+    vertex->x = viewport->x + (vertex->x + 1.0f) * viewport->halfWidth - 0.5f;
+    vertex->y = viewport->y + (vertex->y + 1.0f) * viewport->halfHeight - 0.5f;
     //vertex->z = viewport->minDepth + vertex->z * viewport->depthSize;
 
     #ifdef PR_PERSPECTIVE_CORRECTED
@@ -80,13 +53,83 @@ static void _project_vertex(pr_clip_vertex* vertex, const pr_viewport* viewport)
 
 static void _setup_raster_vertex(pr_raster_vertex* rasterVert, const pr_clip_vertex* clipVert)
 {
-    rasterVert->x = (PRint)(clipVert->x);
-    rasterVert->y = (PRint)(clipVert->y);
+    // Round screen coordinates to the sub-pixel grid
+    rasterVert->x = (PRint)floorf(clipVert->x * PR_SUBPIXEL_SCALE + 0.5f);
+    rasterVert->y = (PRint)floorf(clipVert->y * PR_SUBPIXEL_SCALE + 0.5f);
     rasterVert->z = clipVert->z;
     rasterVert->u = clipVert->u;
     rasterVert->v = clipVert->v;
 }
 
+// Computes the vertex 'c' which is cliped between the vertices 'a' and 'b' and the plane 'z'
+static pr_clip_vertex _get_zplane_vertex(pr_clip_vertex a, pr_clip_vertex b, PRfloat z)
+{
+    PRinterp m = ((PRinterp)(z - b.z)) / (a.z - b.z);
+    pr_clip_vertex c;
+
+    c.x = (PRfloat)(m * (a.x - b.x) + b.x);
+    c.y = (PRfloat)(m * (a.y - b.y) + b.y);
+    c.z = z;
+    c.w = (PRfloat)(m * (a.w - b.w) + b.w);
+
+    c.u = (PRfloat)(m * (a.u - b.u) + b.u);
+    c.v = (PRfloat)(m * (a.v - b.v) + b.v);
+
+    return c;
+}
+
+/*
+Sets up the transformation of the texture coordinates into the current texture region of the specified texture (see prTexRegion).
+Texture coordinates are not transformed for untextured drawing (if the texture is null or the singular texture).
+*/
+static void _setup_texcoord_transform(const pr_texture* texture, pr_texcoord_transform* transform)
+{
+    if (texture != NULL && texture != &PR_SINGULAR_TEXTURE)
+        _pr_texture_texcoord_transform(texture, &(PR_STATE_MACHINE.textureRegion), transform);
+    else
+    {
+        transform->scaleU   = 1.0f;
+        transform->scaleV   = 1.0f;
+        transform->offsetU  = 0.0f;
+        transform->offsetV  = 0.0f;
+    }
+}
+
+/*
+Returns the bound texture, or null if no texture is bound or the texture has no texels (i.e. it is drawn with the singular color).
+The pending image load of the texture is finished here as soon as the loader thread is done (see prTexImage2DFromFileAsync).
+*/
+static pr_texture* _bound_texture()
+{
+    pr_texture* texture = PR_STATE_MACHINE.boundTexture;
+
+    if (texture != NULL && texture->pendingLoad != NULL)
+        _pr_texture_finish_load(texture, PR_FALSE);
+
+    return (texture != NULL && texture->texels != NULL) ? texture : NULL;
+}
+
+static PRubyte _compute_polygon_miplevel(const pr_raster_context* context, const pr_texture* texture)
+{
+    if (PR_STATE_MACHINE.states[PR_MIP_MAPPING] != PR_FALSE && texture->mips > 0)
+    {
+        // Find closest vertex
+        PRinterp zMin = context->rasterVertices[0].z;
+        for (PRint i = 1; i < context->numPolyVerts; ++i)
+        {
+            if (zMin > context->rasterVertices[i].z)
+                zMin = context->rasterVertices[i].z;
+        }
+
+        // Derive mip level from z value
+        zMin = 0.25f / zMin;
+        PRint zLog = _int_log2((PRfloat)zMin);
+
+        return PR_CLAMP(zLog, 0, texture->mips - 1);
+    }
+    return 0;
+}
+
 // Returns PR_TRUE if the specified triangle vertices are culled.
 static PRboolean _is_triangle_culled(const pr_vector2 a, const pr_vector2 b, const pr_vector2 c)
 {
@@ -136,7 +179,25 @@ void _pr_render_screenspace_point(PRint x, PRint y)
     _pr_framebuffer_plot(frameBuffer, x, y, PR_STATE_MACHINE.color0);
 }
 
-void _pr_render_points(PRsizei numVertices, PRsizei firstVertex, /*const */pr_vertexbuffer* vertexBuffer)
+// Plots the cached vertex with the specified index, if it is inside the z clipping range and the clipping rectangle.
+static void _plot_cached_point(pr_framebuffer* frameBuffer, const pr_vertex_cache* vertexCache, PRuint index, const pr_rect* clipRect)
+{
+    const PRfloat z = _pr_vertex_cache_fetch(vertexCache, index)->z;
+
+    if (z < Z_CLIP_NEAR || z > Z_CLIP_FAR)
+        return;
+
+    // Round screen coordinate to the nearest pixel
+    const pr_clip_vertex* vertex = _pr_vertex_cache_fetch_screen(vertexCache, index);
+
+    const PRint x = (PRint)floorf(vertex->x + 0.5f);
+    const PRint y = (PRint)floorf(vertex->y + 0.5f);
+
+    if (x >= clipRect->left && x <= clipRect->right && y >= clipRect->top && y <= clipRect->bottom)
+        _pr_framebuffer_plot(frameBuffer, (PRuint)x, (PRuint)y, PR_STATE_MACHINE.color0);
+}
+
+void _pr_render_points(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
 {
     // Validate bound frame buffer
     pr_framebuffer* frameBuffer = PR_STATE_MACHINE.boundFrameBuffer;
@@ -154,290 +215,595 @@ void _pr_render_points(PRsizei numVertices, PRsizei firstVertex, /*const */pr_ve
         return;
     }
 
-    if (firstVertex + numVertices >= vertexBuffer->numVertices)
+    if (firstVertex + numVertices > vertexBuffer->numVertices)
     {
         PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
         return;
     }
 
-    // Transform vertices
-    _vertexbuffer_transform(numVertices, firstVertex, vertexBuffer);
+    // Transform vertices into the vertex cache (the vertex buffer itself is never written)
+    pr_vertex_cache* vertexCache = &(PR_RASTER_CONTEXT.vertexCache);
+
+    pr_texcoord_transform texCoordTransform;
+    _setup_texcoord_transform(NULL, &texCoordTransform);
+
+    _pr_vertex_cache_transform_range(
+        vertexCache, vertexBuffer, firstVertex, numVertices,
+        &(PR_STATE_MACHINE.worldViewProjectionMatrix), &(PR_STATE_MACHINE.viewport), &texCoordTransform
+    );
 
     // Render points
-    pr_vertex* vert;
+    const PRuint lastVertex = (PRuint)(firstVertex + numVertices);
+
+    for (PRuint i = (PRuint)firstVertex; i < lastVertex; ++i)
+        _plot_cached_point(frameBuffer, vertexCache, i, &(PR_STATE_MACHINE.clipRect));
+}
+
+void _pr_render_indexed_points(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
+{
+    // Validate bound frame buffer
+    pr_framebuffer* frameBuffer = PR_STATE_MACHINE.boundFrameBuffer;
+
+    if (frameBuffer == NULL)
+    {
+        PR_ERROR(PR_ERROR_INVALID_STATE);
+        return;
+    }
 
-    PRuint x, y;
-    PRuint width = frameBuffer->width, height = frameBuffer->height;
+    // Validate vertex- and index buffer
+    if (vertexBuffer == NULL || indexBuffer == NULL)
+    {
+        PR_ERROR(PR_ERROR_NULL_POINTER);
+        return;
+    }
 
-    for (; firstVertex < numVertices; ++firstVertex)
+    if (firstVertex + numVertices > indexBuffer->numIndices)
     {
-        vert = (vertexBuffer->vertices + firstVertex);
+        PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
+        return;
+    }
 
-        x = (PRuint)(vert->ndc.x);
-        #ifdef PR_ORIGIN_LEFT_TOP
-        y = frameBuffer->height - (PRuint)(vert->ndc.y) - 1;
-        #else
-        y = (PRuint)(vert->ndc.y);
-        #endif
+    // Transform all referenced vertices once
+    pr_vertex_cache* vertexCache = &(PR_RASTER_CONTEXT.vertexCache);
 
-        if (x < width && y < height)
-            _pr_framebuffer_plot(frameBuffer, x, y, PR_STATE_MACHINE.color0);
+    pr_texcoord_transform texCoordTransform;
+    _setup_texcoord_transform(NULL, &texCoordTransform);
+
+    if ( !_pr_vertex_cache_transform(
+            vertexCache, vertexBuffer, indexBuffer, firstVertex, numVertices,
+            &(PR_STATE_MACHINE.worldViewProjectionMatrix), &(PR_STATE_MACHINE.viewport), &texCoordTransform ) )
+    {
+        PR_SET_ERROR_FATAL("element in index buffer out of bounds");
+        return;
     }
+
+    // Render points
+    const PRuint* indices = vertexCache->indices;
+
+    for (PRsizei i = 0; i < numVertices; ++i)
+        _plot_cached_point(frameBuffer, vertexCache, indices[i], &(PR_STATE_MACHINE.clipRect));
 }
 
-void _pr_render_indexed_points(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
+// --- lines --- //
+
+//! Line in pixel coordinates, which has been clipped with the "Bresenham" algorithm.
+typedef struct pr_line_setup
 {
-    //...
+    PRint       x, y;       //!< First visible pixel.
+    PRint       first;      //!< Index of the first visible pixel on the unclipped line.
+    PRint       numPixels;  //!< Number of visible pixels.
+    PRint       err;        //!< Error term at the first visible pixel.
+    PRint       es, el;     //!< Distances along the short and long axis.
+    PRint       incx, incy;
+    PRboolean   xMajor;     //!< Specifies whether the x axis is the long axis.
 }
+pr_line_setup;
 
-// --- lines --- //
+// Restricts the pixel indices [tMin, tMax] of a line to the pixels whose long axis coordinate is inside [lo, hi].
+static void _clip_line_major_axis(PRint* tMin, PRint* tMax, PRint p, PRint inc, PRint lo, PRint hi)
+{
+    if (inc > 0)
+    {
+        PR_CLAMP_LARGEST(*tMin, lo - p);
+        PR_CLAMP_SMALLEST(*tMax, hi - p);
+    }
+    else
+    {
+        PR_CLAMP_LARGEST(*tMin, p - hi);
+        PR_CLAMP_SMALLEST(*tMax, p - lo);
+    }
+}
 
-// This function implements the line "bresenham" algorithm.
-static void _render_screenspace_line_colored(PRint x1, PRint y1, PRint x2, PRint y2)
+/*
+Restricts the pixel indices [tMin, tMax] of a line to the pixels whose short axis coordinate is inside [lo, hi].
+The short axis coordinate of pixel t is moved by m(t) = ceil((t*es - el/2) / el) steps, so the range of steps
+is converted into a range of pixel indices. Returns PR_FALSE if the line is outside this range.
+*/
+static PRboolean _clip_line_minor_axis(PRint* tMin, PRint* tMax, PRint p, PRint inc, PRint lo, PRint hi, PRint es, PRint el)
 {
-    // Get bound frame buffer
-    pr_framebuffer* frameBuffer = PR_STATE_MACHINE.boundFrameBuffer;
+    if (inc == 0)
+        return (p >= lo && p <= hi);
+
+    const PRint kMin = (inc > 0 ? lo - p : p - hi);
+    const PRint kMax = (inc > 0 ? hi - p : p - lo);
+
+    if (kMax < 0)
+        return PR_FALSE;
+
+    const PRlong h = el/2;
 
-    if ( x1 < 0 || x1 >= (PRint)frameBuffer->width ||
-         x2 < 0 || x2 >= (PRint)frameBuffer->width ||
-         y1 < 0 || y1 >= (PRint)frameBuffer->height ||
-         y2 < 0 || y2 >= (PRint)frameBuffer->height )
+    // m(t) >= kMin  <=>  t >= ceil(((kMin - 1)*el + h + 1) / es)
+    if (kMin > 0)
     {
-        PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
-        return;
+        const PRlong t = ((PRlong)(kMin - 1)*el + h + es) / es;
+        if (t > *tMin)
+            *tMin = (PRint)PR_MIN(t, (PRlong)el);
     }
 
+    // m(t) <= kMax  <=>  t <= floor((kMax*el + h) / es)
+    const PRlong t = ((PRlong)kMax*el + h) / es;
+    if (t < *tMax)
+        *tMax = (PRint)t;
+
+    return PR_TRUE;
+}
+
+/*
+Sets up the line from (x1, y1) to (x2, y2) with the "Bresenham" algorithm (the end point is excluded), clipped against
+the specified rectangle (Liang-Barsky like, but in the parameter space of the pixels). The error term is advanced to
+the first visible pixel, so a clipped line covers exactly the same pixels as the unclipped line.
+Returns PR_FALSE if the line is empty or completely outside the rectangle.
+*/
+static PRboolean _setup_clipped_line(pr_line_setup* line, PRint x1, PRint y1, PRint x2, PRint y2, const pr_rect* clipRect)
+{
     // Pre-compuations
-    int dx = x2 - x1;
-    int dy = y2 - y1;
+    PRint dx = x2 - x1;
+    PRint dy = y2 - y1;
 
-    int incx = PR_SIGN(dx);
-    int incy = PR_SIGN(dy);
+    line->incx = PR_SIGN(dx);
+    line->incy = PR_SIGN(dy);
 
     if (dx < 0)
         dx = -dx;
     if (dy < 0)
         dy = -dy;
 
-    int pdx, pdy, ddx, ddy, es, el;
+    line->xMajor    = (dx > dy);
+    line->es        = (line->xMajor ? dy : dx);
+    line->el        = (line->xMajor ? dx : dy);
 
-    if (dx > dy)
+    if (line->el == 0)
+        return PR_FALSE;
+
+    // Clip pixel index range
+    PRint tMin = 0, tMax = line->el - 1;
+
+    if (line->xMajor)
     {
-        pdx = incx;
-        pdy = 0;
-        ddx = incx;
-        ddy = incy;
-        es  = dy;
-        el  = dx;
+        _clip_line_major_axis(&tMin, &tMax, x1, line->incx, clipRect->left, clipRect->right);
+        if (!_clip_line_minor_axis(&tMin, &tMax, y1, line->incy, clipRect->top, clipRect->bottom, line->es, line->el))
+            return PR_FALSE;
     }
     else
     {
-        pdx = 0;
-        pdy = incy;
-        ddx = incx;
-        ddy = incy;
-        es  = dx;
-        el  = dy;
+        _clip_line_major_axis(&tMin, &tMax, y1, line->incy, clipRect->top, clipRect->bottom);
+        if (!_clip_line_minor_axis(&tMin, &tMax, x1, line->incx, clipRect->left, clipRect->right, line->es, line->el))
+            return PR_FALSE;
     }
 
-    if (el == 0)
-        return;
+    if (tMin > tMax)
+        return PR_FALSE;
 
-    int x   = x1;
-    int y   = y1;
-    int err = el/2;
+    // Advance to first visible pixel
+    const PRlong h = line->el/2;
+    const PRint k = (PRint)(((PRlong)tMin*line->es - h + line->el - 1) / line->el);
 
-    // Render each pixel of the line
-    for (int t = 0; t < el; ++t)
+    line->first     = tMin;
+    line->numPixels = tMax - tMin + 1;
+    line->err       = (PRint)(h - (PRlong)tMin*line->es + (PRlong)k*line->el);
+
+    if (line->xMajor)
+    {
+        line->x = x1 + line->incx * tMin;
+        line->y = y1 + line->incy * k;
+    }
+    else
     {
-        // Render pixel
-        _pr_framebuffer_plot(PR_STATE_MACHINE.boundFrameBuffer, (PRuint)x, (PRuint)y, PR_STATE_MACHINE.color0);
+        line->x = x1 + line->incx * k;
+        line->y = y1 + line->incy * tMin;
+    }
 
-        // Move to next pixel
-        err -= es;
-        if (err < 0)
-        {
-            err += el;
-            x += ddx;
-            y += ddy;
-        }
-        else
-        {
-            x += pdx;
-            y += pdy;
-        }
+    return PR_TRUE;
+}
+
+// Fills a horizontal run of pixels, starting at the left most pixel.
+PR_INLINE void _fill_line_span(PRcolorindex* dst, PRint count, PRcolorindex colorIndex)
+{
+    #if !defined(PR_MERGE_COLOR_AND_DEPTH_BUFFERS) && !defined(PR_COLOR_BUFFER_24BIT)
+    // Short runs of steep lines are faster without the call
+    if (count >= 16)
+    {
+        memset(dst, colorIndex, (size_t)count);
+        return;
     }
+    #endif
+    for (; count > 0; --count, dst += PR_FRAMEBUFFER_COLOR_STRIDE)
+        *dst = colorIndex;
 }
 
-// Rasterizes a textured line using the "Bresenham" algorithm
-static void _rasterize_line(pr_framebuffer* frameBuffer, const pr_texture* texture, PRubyte mipLevel, PRuint indexA, PRuint indexB)
+/*
+Prepares the bounding box of the visible pixels of the specified line, and returns the color pointer to its first pixel.
+The pointer offsets to move along the long and short axis are stored in 'majorStep' and 'minorStep'.
+*/
+static PRcolorindex* _prepare_line_pixels(pr_framebuffer* frameBuffer, const pr_line_setup* line, PRint* majorStep, PRint* minorStep)
 {
-    const pr_raster_vertex* vertexA = &(_rasterVertices[indexA]);
-    const pr_raster_vertex* vertexB = &(_rasterVertices[indexB]);
+    const PRint pitch = (PRint)(frameBuffer->width * PR_FRAMEBUFFER_COLOR_STRIDE);
 
-    // Select MIP level
-    PRtexsize mipWidth = 0, mipHeight = 0;
-    const PRcolorindex* texels = _pr_texture_select_miplevel(texture, mipLevel, &mipWidth, &mipHeight);
+    // Get pointer offsets for the long and short axis
+    const PRint stepX = line->incx * PR_FRAMEBUFFER_COLOR_STRIDE;
+    const PRint stepY = line->incy * pitch;
 
-    // Pre-compuations
-    int dx = vertexB->x - vertexA->x;
-    int dy = vertexB->y - vertexA->y;
+    *majorStep = (line->xMajor ? stepX : stepY);
+    *minorStep = (line->xMajor ? stepY : stepX);
 
-    int incx = PR_SIGN(dx);
-    int incy = PR_SIGN(dy);
+    // Get last visible pixel (number of short axis steps after the first pixel)
+    const PRint numMajor = line->numPixels - 1;
+    const PRint numMinor = (PRint)(((PRlong)numMajor*line->es + line->el - 1 - line->err) / line->el);
 
-    if (dx < 0)
-        dx = -dx;
-    if (dy < 0)
-        dy = -dy;
+    const PRint x2 = line->x + line->incx * (line->xMajor ? numMajor : numMinor);
+    const PRint y2 = line->y + line->incy * (line->xMajor ? numMinor : numMajor);
 
-    int pdx, pdy, ddx, ddy, es, el;
+    _pr_framebuffer_prepare_rect(frameBuffer, PR_MIN(line->x, x2), PR_MIN(line->y, y2), PR_MAX(line->x, x2), PR_MAX(line->y, y2));
 
-    if (dx > dy)
-    {
-        pdx = incx;
-        pdy = 0;
-        ddx = incx;
-        ddy = incy;
-        es  = dy;
-        el  = dx;
-    }
-    else
+    return PR_FRAMEBUFFER_COLOR_PTR(frameBuffer, line->y * (PRint)frameBuffer->width + line->x);
+}
+
+/*
+Rasterizes a clipped line with a single color. The pixels are written in runs along the long axis
+(run-slice "Bresenham"), so the horizontal runs of flat lines are filled like spans. All runs have
+a length of either (el/es) or (el/es + 1) pixels, so the run lengths are stepped without divisions.
+*/
+static void _rasterize_line_colored(pr_framebuffer* frameBuffer, const pr_line_setup* line, PRcolorindex colorIndex)
+{
+    if (line->es > 0 && line->el < line->es * 2)
     {
-        pdx = 0;
-        pdy = incy;
-        ddx = incx;
-        ddy = incy;
-        es  = dx;
-        el  = dy;
-    }
+        // Lines close to the diagonal have runs of only one or two pixels, so they are stepped pixel by pixel
+        PRint majorStep, minorStep, err = line->err;
+        PRcolorindex* dst = _prepare_line_pixels(frameBuffer, line, &majorStep, &minorStep);
+
+        for (PRint t = 0; t < line->numPixels; ++t)
+        {
+            *dst = colorIndex;
+
+            err -= line->es;
+            if (err < 0)
+            {
+                err += line->el;
+                dst += minorStep;
+            }
+            dst += majorStep;
+        }
 
-    if (el == 0)
         return;
+    }
 
-    int x = vertexA->x;
-    int y = vertexA->y;
-    PRinterp u = vertexA->u;
-    PRinterp v = vertexA->v;
+    const PRint pitch = (PRint)(frameBuffer->width * PR_FRAMEBUFFER_COLOR_STRIDE);
 
-    PRinterp uStep = PR_FLOAT(0.0), vStep = PR_FLOAT(0.0);
+    PRint x = line->x, y = line->y;
+    PRint numPixels = line->numPixels;
 
-    if (el > 1)
+    // The first run ends when the error term wraps around, following runs depend on the remainder
+    PRint run = numPixels, rem = 0, runMin = 0, runRem = 0;
+
+    if (line->es > 0)
     {
-        uStep = (vertexB->u - vertexA->u) / (el - 1);
-        vStep = (vertexB->v - vertexA->v) / (el - 1);
+        run     = line->err / line->es + 1;
+        rem     = line->err % line->es;
+        runMin  = line->el / line->es;
+        runRem  = line->el % line->es;
     }
 
-    int err = el/2;
-
-    PRcolorindex colorIndex;
+    PRcolorindex* dst = PR_FRAMEBUFFER_COLOR_PTR(frameBuffer, y * (PRint)frameBuffer->width + x);
 
-    // Render each pixel of the line
-    for (PRint t = 0; t < el; ++t)
+    for (;;)
     {
-        // Render pixel
-        colorIndex = _pr_texture_sample_nearest_from_mipmap(texels, mipWidth, mipHeight, (PRfloat)u, (PRfloat)v);
+        PR_CLAMP_SMALLEST(run, numPixels);
 
-        _pr_framebuffer_plot(frameBuffer, (PRuint)x, (PRuint)y, colorIndex);
+        if (line->xMajor)
+        {
+            // Fill horizontal run
+            const PRint left = (line->incx > 0 ? x : x - run + 1);
 
-        // Increase tex-coords
-        u += uStep;
-        v += vStep;
+            _pr_framebuffer_prepare_rect(frameBuffer, left, y, left + run - 1, y);
+            _fill_line_span(dst - (x - left) * PR_FRAMEBUFFER_COLOR_STRIDE, run, colorIndex);
 
-        // Move to next pixel
-        err -= es;
-        if (err < 0)
+            x += line->incx * run;
+            dst += line->incx * run * PR_FRAMEBUFFER_COLOR_STRIDE;
+        }
+        else
+        {
+            // Fill vertical run
+            const PRint top = (line->incy > 0 ? y : y - run + 1);
+            const PRint step = line->incy * pitch;
+
+            _pr_framebuffer_prepare_rect(frameBuffer, x, top, x, top + run - 1);
+
+            for (PRint i = 0; i < run; ++i, dst += step)
+                *dst = colorIndex;
+
+            y += line->incy * run;
+        }
+
+        numPixels -= run;
+        if (numPixels == 0)
+            break;
+
+        // Move to next run
+        if (line->xMajor)
         {
-            err += el;
-            x += ddx;
-            y += ddy;
+            y += line->incy;
+            dst += line->incy * pitch;
         }
         else
         {
-            x += pdx;
-            y += pdy;
+            x += line->incx;
+            dst += line->incx * PR_FRAMEBUFFER_COLOR_STRIDE;
+        }
+
+        run = runMin;
+        rem += runRem;
+
+        if (rem >= line->es)
+        {
+            rem -= line->es;
+            ++run;
         }
     }
 }
 
-static void _render_indexed_lines_textured(
-    const pr_texture* texture, PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
+// Rasterizes a clipped line with texture coordinates, which are interpolated from (u, v) at the first pixel of the unclipped line.
+static void _rasterize_line_textured(
+    pr_framebuffer* frameBuffer, const pr_line_setup* line, const pr_texture_level* level,
+    PRinterp u, PRinterp v, PRinterp uStep, PRinterp vStep)
 {
-    //...
-}
+    PRint majorStep, minorStep, err = line->err;
+    PRcolorindex* dst = _prepare_line_pixels(frameBuffer, line, &majorStep, &minorStep);
 
-static void _render_indexed_lines_colored(
-    PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
-{
-    //pr_framebuffer* frameBuffer = PR_STATE_MACHINE.boundFrameBuffer;
+    // Move tex-coords to first visible pixel
+    u += uStep * line->first;
+    v += vStep * line->first;
+
+    // Render each pixel of the line
+    const pr_texture_level mip = *level;
 
-    // Iterate over the index buffer
-    for (PRsizei i = firstVertex, n = numVertices + firstVertex; i + 1 < n; i += 2)
+    for (PRint t = 0; t < line->numPixels; ++t)
     {
-        // Fetch indices
-        PRushort indexA = indexBuffer->indices[i];
-        PRushort indexB = indexBuffer->indices[i + 1];
+        // Render pixel (power-of-two MIP levels are sampled with fixed-point texture coordinates)
+        if (mip.pot != PR_FALSE)
+            *dst = _pr_texture_sample_nearest_pot(&mip, PR_TEXCOORD_FIXED(u), PR_TEXCOORD_FIXED(v));
+        else
+            *dst = _pr_texture_sample_nearest_from_mipmap(&mip, (PRfloat)u, (PRfloat)v);
+
+        // Increase tex-coords
+        u += uStep;
+        v += vStep;
 
-        #ifdef PR_DEBUG
-        if (indexA >= vertexBuffer->numVertices || indexB >= vertexBuffer->numVertices)
+        // Move to next pixel
+        err -= line->es;
+        if (err < 0)
         {
-            PR_SET_ERROR_FATAL("element in index buffer out of bounds");
-            return;
+            err += line->el;
+            dst += minorStep;
         }
-        #endif
+        dst += majorStep;
+    }
+}
+
+// Rasterizes a textured line between two raster vertices. Textures with a single texel are rasterized with the fast colored path.
+static void _rasterize_line(pr_raster_context* context, pr_framebuffer* frameBuffer, const pr_texture* texture, PRubyte mipLevel, PRuint indexA, PRuint indexB)
+{
+    const pr_raster_vertex* vertexA = &(context->rasterVertices[indexA]);
+    const pr_raster_vertex* vertexB = &(context->rasterVertices[indexB]);
 
-        // Fetch vertices
-        const pr_vertex* vertexA = (vertexBuffer->vertices + indexA);
-        const pr_vertex* vertexB = (vertexBuffer->vertices + indexB);
+    // Get line end points in pixel coordinates
+    const PRint x1 = PR_SUBPIXEL_ROUND(vertexA->x);
+    const PRint y1 = PR_SUBPIXEL_ROUND(vertexA->y);
+    const PRint x2 = PR_SUBPIXEL_ROUND(vertexB->x);
+    const PRint y2 = PR_SUBPIXEL_ROUND(vertexB->y);
 
-        // Raster line
-        PRint x1 = (PRint)vertexA->ndc.x;
-        PRint y1 = (PRint)vertexA->ndc.y;
+    pr_line_setup line;
+    if (!_setup_clipped_line(&line, x1, y1, x2, y2, &(PR_STATE_MACHINE.clipRect)))
+        return;
+
+    // Select MIP level
+    pr_texture_level level;
+    _pr_texture_select_miplevel(texture, mipLevel, &level);
+
+    if (level.width == 1 && level.height == 1)
+    {
+        _rasterize_line_colored(frameBuffer, &line, _pr_texture_fetch(&level, 0, 0));
+        return;
+    }
 
-        PRint x2 = (PRint)vertexB->ndc.x;
-        PRint y2 = (PRint)vertexB->ndc.y;
+    PRinterp uStep = PR_FLOAT(0.0), vStep = PR_FLOAT(0.0);
 
-        _render_screenspace_line_colored(x1, y1, x2, y2);
+    if (line.el > 1)
+    {
+        uStep = (vertexB->u - vertexA->u) / (line.el - 1);
+        vStep = (vertexB->v - vertexA->v) / (line.el - 1);
     }
+
+    _rasterize_line_textured(frameBuffer, &line, &level, vertexA->u, vertexA->v, uStep, vStep);
 }
 
-void _pr_render_screenspace_line(PRint x1, PRint y1, PRint x2, PRint y2)
+/*
+Sets up the line with the specified vertices of the vertex cache as the first two raster vertices.
+If no z clipping is required, the vertices, which have already been projected by the vertex cache, are used directly.
+*/
+static PRboolean _setup_cached_line(pr_raster_context* context, PRuint indexA, PRuint indexB)
 {
-    // Get bound frame buffer
-    pr_framebuffer* frameBuffer = PR_STATE_MACHINE.boundFrameBuffer;
+    const pr_vertex_cache* vertexCache = &(context->vertexCache);
 
-    if (frameBuffer == NULL)
+    pr_clip_vertex a = *_pr_vertex_cache_fetch(vertexCache, indexA);
+    pr_clip_vertex b = *_pr_vertex_cache_fetch(vertexCache, indexB);
+
+    if ( ( a.z < Z_CLIP_NEAR && b.z < Z_CLIP_NEAR ) || ( a.z > Z_CLIP_FAR && b.z > Z_CLIP_FAR ) )
+        return PR_FALSE;
+
+    if (a.z < Z_CLIP_NEAR || a.z > Z_CLIP_FAR || b.z < Z_CLIP_NEAR || b.z > Z_CLIP_FAR)
     {
-        PR_ERROR(PR_ERROR_INVALID_STATE);
-        return;
+        // Clip line at the near and far clipping planes
+        if (a.z < Z_CLIP_NEAR)
+            a = _get_zplane_vertex(a, b, Z_CLIP_NEAR);
+        else if (a.z > Z_CLIP_FAR)
+            a = _get_zplane_vertex(a, b, Z_CLIP_FAR);
+
+        if (b.z < Z_CLIP_NEAR)
+            b = _get_zplane_vertex(a, b, Z_CLIP_NEAR);
+        else if (b.z > Z_CLIP_FAR)
+            b = _get_zplane_vertex(a, b, Z_CLIP_FAR);
+
+        _project_vertex(&a, &(PR_STATE_MACHINE.viewport));
+        _project_vertex(&b, &(PR_STATE_MACHINE.viewport));
+
+        context->clipVertices[0] = a;
+        context->clipVertices[1] = b;
+    }
+    else
+    {
+        context->clipVertices[0] = *_pr_vertex_cache_fetch_screen(vertexCache, indexA);
+        context->clipVertices[1] = *_pr_vertex_cache_fetch_screen(vertexCache, indexB);
     }
 
-    #ifdef PR_ORIGIN_LEFT_TOP
-    y1 = frameBuffer->height - y1 - 1;
-    y2 = frameBuffer->height - y2 - 1;
-    #endif
+    _setup_raster_vertex(&(context->rasterVertices[0]), &(context->clipVertices[0]));
+    _setup_raster_vertex(&(context->rasterVertices[1]), &(context->clipVertices[1]));
 
-    _render_screenspace_line_colored(x1, y1, x2, y2);
-}
+    context->numPolyVerts = 2;
 
-void _pr_render_lines(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
-{
-    //...
+    return PR_TRUE;
 }
 
-void _pr_render_line_strip(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
+// Returns the number of line segments of the specified line primitives (PR_LINES, PR_LINE_STRIP or PR_LINE_LOOP).
+static PRsizei _num_lines(PRenum primitives, PRsizei numVertices)
 {
-    //...
+    if (primitives == PR_LINES)
+        return numVertices / 2;
+    if (numVertices < 2)
+        return 0;
+    return (primitives == PR_LINE_LOOP ? numVertices : numVertices - 1);
 }
 
-void _pr_render_line_loop(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
+// Returns the vertex offsets (relative to the first vertex) of the specified line segment.
+PR_INLINE void _line_vertex_offsets(PRenum primitives, PRsizei line, PRsizei numVertices, PRsizei* offsets)
 {
-    //...
+    if (primitives == PR_LINES)
+    {
+        offsets[0] = line*2;
+        offsets[1] = line*2 + 1;
+    }
+    else
+    {
+        // The last segment of a line loop goes back to the first vertex
+        offsets[0] = line;
+        offsets[1] = (line + 1 < numVertices ? line + 1 : 0);
+    }
 }
 
-void _pr_render_indexed_lines(PRsizei numVertices, PRsizei firstVertex, /*const */pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
+static void _render_lines(
+    pr_raster_context* context, const pr_texture* texture, PRenum primitives,
+    PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
 {
-    if (PR_STATE_MACHINE.boundFrameBuffer == NULL)
+    pr_framebuffer* frameBuffer = PR_STATE_MACHINE.boundFrameBuffer;
+    pr_vertex_cache* vertexCache = &(context->vertexCache);
+
+    // Transform all vertices in a single batch, so that shared vertices of strips and loops are only transformed once
+    pr_texcoord_transform texCoordTransform;
+    _setup_texcoord_transform(texture, &texCoordTransform);
+
+    _pr_vertex_cache_transform_range(
+        vertexCache, vertexBuffer, firstVertex, numVertices,
+        &(PR_STATE_MACHINE.worldViewProjectionMatrix), &(PR_STATE_MACHINE.viewport), &texCoordTransform
+    );
+
+    // Iterate over all lines
+    const PRsizei numLines = _num_lines(primitives, numVertices);
+    PRsizei offsets[2];
+
+    for (PRsizei i = 0; i < numLines; ++i)
+    {
+        _line_vertex_offsets(primitives, i, numVertices, offsets);
+
+        if (_setup_cached_line(context, firstVertex + offsets[0], firstVertex + offsets[1]) != PR_FALSE)
+            _rasterize_line(context, frameBuffer, texture, _compute_polygon_miplevel(context, texture), 0, 1);
+    }
+}
+
+static void _draw_lines(PRenum primitives, PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
+{
+    if (PR_STATE_MACHINE.boundFrameBuffer == NULL)
+    {
+        PR_ERROR(PR_ERROR_INVALID_STATE);
+        return;
+    }
+    if (vertexBuffer == NULL)
+    {
+        PR_ERROR(PR_ERROR_NULL_POINTER);
+        return;
+    }
+    if (firstVertex + numVertices > vertexBuffer->numVertices)
+    {
+        PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
+        return;
+    }
+
+    pr_texture* texture = _bound_texture();
+    if (texture == NULL)
+    {
+        _pr_texture_singular_color(&PR_SINGULAR_TEXTURE, PR_STATE_MACHINE.color0);
+        _render_lines(&(PR_RASTER_CONTEXT), &PR_SINGULAR_TEXTURE, primitives, numVertices, firstVertex, vertexBuffer);
+    }
+    else
+        _render_lines(&(PR_RASTER_CONTEXT), texture, primitives, numVertices, firstVertex, vertexBuffer);
+}
+
+static void _render_indexed_lines(
+    pr_raster_context* context, const pr_texture* texture, PRenum primitives,
+    PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
+{
+    pr_framebuffer* frameBuffer = PR_STATE_MACHINE.boundFrameBuffer;
+    pr_vertex_cache* vertexCache = &(context->vertexCache);
+
+    // Transform all referenced vertices once
+    pr_texcoord_transform texCoordTransform;
+    _setup_texcoord_transform(texture, &texCoordTransform);
+
+    if ( !_pr_vertex_cache_transform(
+            vertexCache, vertexBuffer, indexBuffer, firstVertex, numVertices,
+            &(PR_STATE_MACHINE.worldViewProjectionMatrix), &(PR_STATE_MACHINE.viewport), &texCoordTransform ) )
+    {
+        PR_SET_ERROR_FATAL("element in index buffer out of bounds");
+        return;
+    }
+
+    const PRuint* indices = vertexCache->indices;
+
+    // Iterate over all lines with the transformed vertices
+    const PRsizei numLines = _num_lines(primitives, numVertices);
+    PRsizei offsets[2];
+
+    for (PRsizei i = 0; i < numLines; ++i)
+    {
+        _line_vertex_offsets(primitives, i, numVertices, offsets);
+
+        if (_setup_cached_line(context, indices[offsets[0]], indices[offsets[1]]) != PR_FALSE)
+            _rasterize_line(context, frameBuffer, texture, _compute_polygon_miplevel(context, texture), 0, 1);
+    }
+}
+
+static void _draw_indexed_lines(
+    PRenum primitives, PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
+{
+    if (PR_STATE_MACHINE.boundFrameBuffer == NULL)
     {
         PR_ERROR(PR_ERROR_INVALID_STATE);
         return;
@@ -453,22 +819,72 @@ void _pr_render_indexed_lines(PRsizei numVertices, PRsizei firstVertex, /*const
         return;
     }
 
-    _vertexbuffer_transform_all(vertexBuffer);
-
-    if (PR_STATE_MACHINE.boundTexture != NULL)
-        _render_indexed_lines_textured(PR_STATE_MACHINE.boundTexture, numVertices, firstVertex, vertexBuffer, indexBuffer);
+    pr_texture* texture = _bound_texture();
+    if (texture == NULL)
+    {
+        _pr_texture_singular_color(&PR_SINGULAR_TEXTURE, PR_STATE_MACHINE.color0);
+        _render_indexed_lines(&(PR_RASTER_CONTEXT), &PR_SINGULAR_TEXTURE, primitives, numVertices, firstVertex, vertexBuffer, indexBuffer);
+    }
     else
-        _render_indexed_lines_colored(numVertices, firstVertex, vertexBuffer, indexBuffer);
+        _render_indexed_lines(&(PR_RASTER_CONTEXT), texture, primitives, numVertices, firstVertex, vertexBuffer, indexBuffer);
+}
+
+void _pr_render_screenspace_line(PRint x1, PRint y1, PRint x2, PRint y2)
+{
+    // Get bound frame buffer
+    pr_framebuffer* frameBuffer = PR_STATE_MACHINE.boundFrameBuffer;
+
+    if (frameBuffer == NULL)
+    {
+        PR_ERROR(PR_ERROR_INVALID_STATE);
+        return;
+    }
+
+    #ifdef PR_ORIGIN_LEFT_TOP
+    y1 = frameBuffer->height - y1 - 1;
+    y2 = frameBuffer->height - y2 - 1;
+    #endif
+
+    // Clip line against the frame buffer
+    pr_rect clipRect;
+    clipRect.left   = 0;
+    clipRect.top    = 0;
+    clipRect.right  = (PRint)frameBuffer->width - 1;
+    clipRect.bottom = (PRint)frameBuffer->height - 1;
+
+    pr_line_setup line;
+    if (_setup_clipped_line(&line, x1, y1, x2, y2, &clipRect))
+        _rasterize_line_colored(frameBuffer, &line, PR_STATE_MACHINE.color0);
+}
+
+void _pr_render_lines(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
+{
+    _draw_lines(PR_LINES, numVertices, firstVertex, vertexBuffer);
+}
+
+void _pr_render_line_strip(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
+{
+    _draw_lines(PR_LINE_STRIP, numVertices, firstVertex, vertexBuffer);
+}
+
+void _pr_render_line_loop(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
+{
+    _draw_lines(PR_LINE_LOOP, numVertices, firstVertex, vertexBuffer);
+}
+
+void _pr_render_indexed_lines(PRsizei numVertices, PRsizei firstVertex, /*const */pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
+{
+    _draw_indexed_lines(PR_LINES, numVertices, firstVertex, vertexBuffer, indexBuffer);
 }
 
 void _pr_render_indexed_line_strip(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
 {
-    //...
+    _draw_indexed_lines(PR_LINE_STRIP, numVertices, firstVertex, vertexBuffer, indexBuffer);
 }
 
 void _pr_render_indexed_line_loop(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
 {
-    //...
+    _draw_indexed_lines(PR_LINE_LOOP, numVertices, firstVertex, vertexBuffer, indexBuffer);
 }
 
 // --- images --- //
@@ -494,35 +910,41 @@ static void _render_screenspace_image_textured(const pr_texture* texture, PRint
     if (left > right)
         PR_SWAP(PRint, left, right);
 
+    _pr_framebuffer_prepare_rect(frameBuffer, left, top, right, bottom);
+
     // Select MIP level
-    PRtexsize width = 0, height = 0;
+    pr_texture_level level;
     PRubyte mipLevel = 0;//_pr_texture_compute_miplevel(texture, 1.0f / (PRfloat)(right - left), 0.0f, 0.0f, 1.0f / (PRfloat)(bottom - top));
-    const PRcolorindex* texels = _pr_texture_select_miplevel(texture, mipLevel, &width, &height);
+    _pr_texture_select_miplevel(texture, mipLevel, &level);
 
     // Rasterize rectangle
-    pr_pixel* pixels = frameBuffer->pixels;
     const PRuint pitch = frameBuffer->width;
-    pr_pixel* scanline;
+    PRcolorindex* scanline;
+
+    // Map the image into the current texture region and sample at the pixel centers, so that no texels outside the region are sampled
+    pr_texcoord_transform texCoordTransform;
+    _setup_texcoord_transform(texture, &texCoordTransform);
 
-    PRfloat u = 0.0f;
+    const PRfloat uStep = texCoordTransform.scaleU / ((PRfloat)(right - left + 1));
+    const PRfloat vStep = texCoordTransform.scaleV / ((PRfloat)(bottom - top + 1));
+
+    const PRfloat uStart = texCoordTransform.offsetU + uStep * 0.5f;
+    PRfloat u = uStart;
     #ifdef PR_ORIGIN_LEFT_TOP
-    PRfloat v = 1.0f;
+    PRfloat v = texCoordTransform.offsetV + texCoordTransform.scaleV - vStep * 0.5f;
     #else
-    PRfloat v = 0.0f;
+    PRfloat v = texCoordTransform.offsetV + vStep * 0.5f;
     #endif
 
-    const PRfloat uStep = 1.0f / ((PRfloat)(right - left));
-    const PRfloat vStep = 1.0f / ((PRfloat)(bottom - top));
-
     for (PRint y = top; y <= bottom; ++y)
     {
-        scanline = pixels + (y * pitch + left);
+        scanline = PR_FRAMEBUFFER_COLOR_PTR(frameBuffer, y * pitch + left);
 
-        u = 0.0f;
+        u = uStart;
 
         for (PRint x = left; x <= right; ++x)
         {
-            PRcolorindex color = _pr_texture_sample_nearest_from_mipmap(texels, width, height, u, v);
+            PRcolorindex color = _pr_texture_sample_nearest_from_mipmap(&level, u, v);
 
             #ifdef PR_BLACK_IS_ALPHA
             #   ifdef PR_COLOR_BUFFER_24BIT
@@ -534,13 +956,13 @@ static void _render_screenspace_image_textured(const pr_texture* texture, PRint
             #   endif
             #endif
 
-            scanline->colorIndex = color;
+            *scanline = color;
 
             #ifdef PR_BLACK_IS_ALPHA
             }
             #endif
 
-            ++scanline;
+            scanline += PR_FRAMEBUFFER_COLOR_STRIDE;
             u += uStep;
         }
 
@@ -573,18 +995,19 @@ static void _render_screenspace_image_colored(PRcolorindex colorIndex, PRint lef
     if (left > right)
         PR_SWAP(PRint, left, right);
 
+    _pr_framebuffer_prepare_rect(frameBuffer, left, top, right, bottom);
+
     // Rasterize rectangle
-    pr_pixel* pixels = frameBuffer->pixels;
     const PRuint pitch = frameBuffer->width;
-    pr_pixel* scanline;
+    PRcolorindex* scanline;
 
     for (PRint y = top; y <= bottom; ++y)
     {
-        scanline = pixels + (y * pitch + left);
+        scanline = PR_FRAMEBUFFER_COLOR_PTR(frameBuffer, y * pitch + left);
         for (PRint x = left; x <= right; ++x)
         {
-            scanline->colorIndex = colorIndex;
-            ++scanline;
+            *scanline = colorIndex;
+            scanline += PR_FRAMEBUFFER_COLOR_STRIDE;
         }
     }
 }
@@ -593,8 +1016,9 @@ void _pr_render_screenspace_image(PRint left, PRint top, PRint right, PRint bott
 {
     if (PR_STATE_MACHINE.boundFrameBuffer != NULL)
     {
-        if (PR_STATE_MACHINE.boundTexture != NULL)
-            _render_screenspace_image_textured(PR_STATE_MACHINE.boundTexture, left, top, right, bottom);
+        pr_texture* texture = _bound_texture();
+        if (texture != NULL)
+            _render_screenspace_image_textured(texture, left, top, right, bottom);
         else
             _render_screenspace_image_colored(PR_STATE_MACHINE.color0, left, top, right, bottom);
     }
@@ -604,67 +1028,50 @@ void _pr_render_screenspace_image(PRint left, PRint top, PRint right, PRint bott
 
 // --- triangles --- //
 
-// Computes the vertex 'c' which is cliped between the vertices 'a' and 'b' and the plane 'z'
-static pr_clip_vertex _get_zplane_vertex(pr_clip_vertex a, pr_clip_vertex b, PRfloat z)
-{
-    PRinterp m = ((PRinterp)(z - b.z)) / (a.z - b.z);
-    pr_clip_vertex c;
-
-    c.x = (PRfloat)(m * (a.x - b.x) + b.x);
-    c.y = (PRfloat)(m * (a.y - b.y) + b.y);
-    c.z = z;
-    c.w = (PRfloat)(m * (a.w - b.w) + b.w);
-
-    c.u = (PRfloat)(m * (a.u - b.u) + b.u);
-    c.v = (PRfloat)(m * (a.v - b.v) + b.v);
-
-    return c;
-}
-
 // Clips the polygon at the z planes
-static void _polygon_z_clipping(PRfloat zMin, PRfloat zMax)
+static void _polygon_z_clipping(pr_raster_context* context, PRfloat zMin, PRfloat zMax)
 {
     PRint x, y;
 
     // Clip at near clipping plane (zMin)
     PRint localNumVerts = 0;
 
-    for (x = _numPolyVerts - 1, y = 0; y < _numPolyVerts; x = y, ++y)
+    for (x = context->numPolyVerts - 1, y = 0; y < context->numPolyVerts; x = y, ++y)
     {
         // Inside
-        if (_clipVertices[x].z >= zMin && _clipVertices[y].z >= zMin)
-            _clipVerticesTmp[localNumVerts++] = _clipVertices[y];
+        if (context->clipVertices[x].z >= zMin && context->clipVertices[y].z >= zMin)
+            context->clipVerticesTmp[localNumVerts++] = context->clipVertices[y];
 
         // Leaving
-        if (_clipVertices[x].z >= zMin && _clipVertices[y].z < zMin)
-            _clipVerticesTmp[localNumVerts++] = _get_zplane_vertex(_clipVertices[x], _clipVertices[y], zMin);
+        if (context->clipVertices[x].z >= zMin && context->clipVertices[y].z < zMin)
+            context->clipVerticesTmp[localNumVerts++] = _get_zplane_vertex(context->clipVertices[x], context->clipVertices[y], zMin);
 
         // Entering
-        if (_clipVertices[x].z < zMin && _clipVertices[y].z >= zMin)
+        if (context->clipVertices[x].z < zMin && context->clipVertices[y].z >= zMin)
         {
-            _clipVerticesTmp[localNumVerts++] = _get_zplane_vertex(_clipVertices[x], _clipVertices[y], zMin);
-            _clipVerticesTmp[localNumVerts++] = _clipVertices[y];
+            context->clipVerticesTmp[localNumVerts++] = _get_zplane_vertex(context->clipVertices[x], context->clipVertices[y], zMin);
+            context->clipVerticesTmp[localNumVerts++] = context->clipVertices[y];
         }
     }
 
     // Clip at far clipping plane (zMax)
-    _numPolyVerts = 0;
+    context->numPolyVerts = 0;
 
     for (x = localNumVerts - 1, y = 0; y < localNumVerts; x = y, ++y)
     {
         // Inside
-        if (_clipVerticesTmp[x].z <= zMax && _clipVerticesTmp[y].z <= zMax)
-            _clipVertices[_numPolyVerts++] = _clipVerticesTmp[y];
+        if (context->clipVerticesTmp[x].z <= zMax && context->clipVerticesTmp[y].z <= zMax)
+            context->clipVertices[context->numPolyVerts++] = context->clipVerticesTmp[y];
 
         // Leaving
-        if (_clipVerticesTmp[x].z <= zMax && _clipVerticesTmp[y].z > zMax)
-            _clipVertices[_numPolyVerts++] = _get_zplane_vertex(_clipVerticesTmp[x], _clipVerticesTmp[y], zMax);
+        if (context->clipVerticesTmp[x].z <= zMax && context->clipVerticesTmp[y].z > zMax)
+            context->clipVertices[context->numPolyVerts++] = _get_zplane_vertex(context->clipVerticesTmp[x], context->clipVerticesTmp[y], zMax);
 
         // Entering
-        if (_clipVerticesTmp[x].z > zMax && _clipVerticesTmp[y].z <= zMax)
+        if (context->clipVerticesTmp[x].z > zMax && context->clipVerticesTmp[y].z <= zMax)
         {
-            _clipVertices[_numPolyVerts++] = _get_zplane_vertex(_clipVerticesTmp[x], _clipVerticesTmp[y], zMax);
-            _clipVertices[_numPolyVerts++] = _clipVerticesTmp[y];
+            context->clipVertices[context->numPolyVerts++] = _get_zplane_vertex(context->clipVerticesTmp[x], context->clipVerticesTmp[y], zMax);
+            context->clipVertices[context->numPolyVerts++] = context->clipVerticesTmp[y];
         }
     }
 }
@@ -702,91 +1109,91 @@ static pr_raster_vertex _get_yplane_vertex(pr_raster_vertex a, pr_raster_vertex
 }
 
 // Clips the polygon at the x and y planes
-static void _polygon_xy_clipping(PRint xMin, PRint xMax, PRint yMin, PRint yMax)
+static void _polygon_xy_clipping(pr_raster_context* context, PRint xMin, PRint xMax, PRint yMin, PRint yMax)
 {
     PRint x, y;
 
     // Clip at left clipping plane (xMin)
     PRint localNumVerts = 0;
 
-    for (x = _numPolyVerts - 1, y = 0; y < _numPolyVerts; x = y, ++y)
+    for (x = context->numPolyVerts - 1, y = 0; y < context->numPolyVerts; x = y, ++y)
     {
         // Inside
-        if (_rasterVertices[x].x >= xMin && _rasterVertices[y].x >= xMin)
-            _rasterVerticesTmp[localNumVerts++] = _rasterVertices[y];
+        if (context->rasterVertices[x].x >= xMin && context->rasterVertices[y].x >= xMin)
+            context->rasterVerticesTmp[localNumVerts++] = context->rasterVertices[y];
 
         // Leaving
-        if (_rasterVertices[x].x >= xMin && _rasterVertices[y].x < xMin)
-            _rasterVerticesTmp[localNumVerts++] = _get_xplane_vertex(_rasterVertices[x], _rasterVertices[y], xMin);
+        if (context->rasterVertices[x].x >= xMin && context->rasterVertices[y].x < xMin)
+            context->rasterVerticesTmp[localNumVerts++] = _get_xplane_vertex(context->rasterVertices[x], context->rasterVertices[y], xMin);
 
         // Entering
-        if (_rasterVertices[x].x < xMin && _rasterVertices[y].x >= xMin)
+        if (context->rasterVertices[x].x < xMin && context->rasterVertices[y].x >= xMin)
         {
-            _rasterVerticesTmp[localNumVerts++] = _get_xplane_vertex(_rasterVertices[x], _rasterVertices[y], xMin);
-            _rasterVerticesTmp[localNumVerts++] = _rasterVertices[y];
+            context->rasterVerticesTmp[localNumVerts++] = _get_xplane_vertex(context->rasterVertices[x], context->rasterVertices[y], xMin);
+            context->rasterVerticesTmp[localNumVerts++] = context->rasterVertices[y];
         }
     }
 
     // Clip at right clipping plane (xMax)
-    _numPolyVerts = 0;
+    context->numPolyVerts = 0;
 
     for (x = localNumVerts - 1, y = 0; y < localNumVerts; x = y, ++y)
     {
         // Inside
-        if (_rasterVerticesTmp[x].x <= xMax && _rasterVerticesTmp[y].x <= xMax)
-            _rasterVertices[_numPolyVerts++] = _rasterVerticesTmp[y];
+        if (context->rasterVerticesTmp[x].x <= xMax && context->rasterVerticesTmp[y].x <= xMax)
+            context->rasterVertices[context->numPolyVerts++] = context->rasterVerticesTmp[y];
 
         // Leaving
-        if (_rasterVerticesTmp[x].x <= xMax && _rasterVerticesTmp[y].x > xMax)
-            _rasterVertices[_numPolyVerts++] = _get_xplane_vertex(_rasterVerticesTmp[x], _rasterVerticesTmp[y], xMax);
+        if (context->rasterVerticesTmp[x].x <= xMax && context->rasterVerticesTmp[y].x > xMax)
+            context->rasterVertices[context->numPolyVerts++] = _get_xplane_vertex(context->rasterVerticesTmp[x], context->rasterVerticesTmp[y], xMax);
 
         // Entering
-        if (_rasterVerticesTmp[x].x > xMax && _rasterVerticesTmp[y].x <= xMax)
+        if (context->rasterVerticesTmp[x].x > xMax && context->rasterVerticesTmp[y].x <= xMax)
         {
-            _rasterVertices[_numPolyVerts++] = _get_xplane_vertex(_rasterVerticesTmp[x], _rasterVerticesTmp[y], xMax);
-            _rasterVertices[_numPolyVerts++] = _rasterVerticesTmp[y];
+            context->rasterVertices[context->numPolyVerts++] = _get_xplane_vertex(context->rasterVerticesTmp[x], context->rasterVerticesTmp[y], xMax);
+            context->rasterVertices[context->numPolyVerts++] = context->rasterVerticesTmp[y];
         }
     }
 
     // Clip at top clipping plane (yMin)
     localNumVerts = 0;
 
-    for (x = _numPolyVerts - 1, y = 0; y < _numPolyVerts; x = y, ++y)
+    for (x = context->numPolyVerts - 1, y = 0; y < context->numPolyVerts; x = y, ++y)
     {
         // Inside
-        if (_rasterVertices[x].y >= yMin && _rasterVertices[y].y >= yMin)
-            _rasterVerticesTmp[localNumVerts++] = _rasterVertices[y];
+        if (context->rasterVertices[x].y >= yMin && context->rasterVertices[y].y >= yMin)
+            context->rasterVerticesTmp[localNumVerts++] = context->rasterVertices[y];
 
         // Leaving
-        if (_rasterVertices[x].y >= yMin && _rasterVertices[y].y < yMin)
-            _rasterVerticesTmp[localNumVerts++] = _get_yplane_vertex(_rasterVertices[x], _rasterVertices[y], yMin);
+        if (context->rasterVertices[x].y >= yMin && context->rasterVertices[y].y < yMin)
+            context->rasterVerticesTmp[localNumVerts++] = _get_yplane_vertex(context->rasterVertices[x], context->rasterVertices[y], yMin);
 
         // Entering
-        if (_rasterVertices[x].y < yMin && _rasterVertices[y].y >= yMin)
+        if (context->rasterVertices[x].y < yMin && context->rasterVertices[y].y >= yMin)
         {
-            _rasterVerticesTmp[localNumVerts++] = _get_yplane_vertex(_rasterVertices[x], _rasterVertices[y], yMin);
-            _rasterVerticesTmp[localNumVerts++] = _rasterVertices[y];
+            context->rasterVerticesTmp[localNumVerts++] = _get_yplane_vertex(context->rasterVertices[x], context->rasterVertices[y], yMin);
+            context->rasterVerticesTmp[localNumVerts++] = context->rasterVertices[y];
         }
     }
 
     // Clip at bottom clipping plane (yMax)
-    _numPolyVerts = 0;
+    context->numPolyVerts = 0;
 
     for (x = localNumVerts - 1, y = 0; y < localNumVerts; x = y, ++y)
     {
         // Inside
-        if (_rasterVerticesTmp[x].y <= yMax && _rasterVerticesTmp[y].y <= yMax)
-            _rasterVertices[_numPolyVerts++] = _rasterVerticesTmp[y];
+        if (context->rasterVerticesTmp[x].y <= yMax && context->rasterVerticesTmp[y].y <= yMax)
+            context->rasterVertices[context->numPolyVerts++] = context->rasterVerticesTmp[y];
 
         // Leaving
-        if (_rasterVerticesTmp[x].y <= yMax && _rasterVerticesTmp[y].y > yMax)
-            _rasterVertices[_numPolyVerts++] = _get_yplane_vertex(_rasterVerticesTmp[x], _rasterVerticesTmp[y], yMax);
+        if (context->rasterVerticesTmp[x].y <= yMax && context->rasterVerticesTmp[y].y > yMax)
+            context->rasterVertices[context->numPolyVerts++] = _get_yplane_vertex(context->rasterVerticesTmp[x], context->rasterVerticesTmp[y], yMax);
 
         // Entering
-        if (_rasterVerticesTmp[x].y > yMax && _rasterVerticesTmp[y].y <= yMax)
+        if (context->rasterVerticesTmp[x].y > yMax && context->rasterVerticesTmp[y].y <= yMax)
         {
-            _rasterVertices[_numPolyVerts++] = _get_yplane_vertex(_rasterVerticesTmp[x], _rasterVerticesTmp[y], yMax);
-            _rasterVertices[_numPolyVerts++] = _rasterVerticesTmp[y];
+            context->rasterVertices[context->numPolyVerts++] = _get_yplane_vertex(context->rasterVerticesTmp[x], context->rasterVerticesTmp[y], yMax);
+            context->rasterVertices[context->numPolyVerts++] = context->rasterVerticesTmp[y];
         }
     }
 }
@@ -805,233 +1212,932 @@ static void _index_dec(PRint* x, PRint numVertices)
         *x = numVertices - 1;
 }
 
-// Rasterizes convex polygon filled
-static void _rasterize_polygon_fill(pr_framebuffer* frameBuffer, const pr_texture* texture, PRubyte mipLevel)
+// Returns twice the signed area of the specified polygon (negative for counter-clockwise polygons in raster space).
+static PRlong _polygon_signed_area(const pr_raster_vertex* vertices, PRint numVertices)
 {
-    // Select MIP level
-    PRtexsize mipWidth = 0, mipHeight = 0;
-    const PRcolorindex* texels = _pr_texture_select_miplevel(texture, mipLevel, &mipWidth, &mipHeight);
+    PRlong area = 0;
+
+    for (PRint x = numVertices - 1, y = 0; y < numVertices; x = y, ++y)
+        area += (PRlong)vertices[x].x * vertices[y].y - (PRlong)vertices[y].x * vertices[x].y;
+
+    return area;
+}
+
+// Plane equation of a vertex attribute which is linear in screen space: A(x, y) = value + dx*x + dy*y (in pixels).
+typedef struct pr_plane_equation
+{
+    PRinterp value;
+    PRinterp dx;
+    PRinterp dy;
+}
+pr_plane_equation;
+
+static void _setup_plane_equation(
+    pr_plane_equation* plane, const pr_raster_vertex* a, const pr_raster_vertex* b, const pr_raster_vertex* c,
+    PRinterp attrA, PRinterp attrB, PRinterp attrC)
+{
+    const PRinterp scale = PR_FLOAT(1.0) / PR_SUBPIXEL_SCALE;
+
+    const PRinterp x0 = a->x * scale, y0 = a->y * scale;
+    const PRinterp x1 = b->x * scale - x0, y1 = b->y * scale - y0;
+    const PRinterp x2 = c->x * scale - x0, y2 = c->y * scale - y0;
+    const PRinterp det = x1*y2 - x2*y1;
+
+    plane->dx       = ((attrB - attrA)*y2 - (attrC - attrA)*y1) / det;
+    plane->dy       = ((attrC - attrA)*x1 - (attrB - attrA)*x2) / det;
+    plane->value    = attrA - plane->dx*x0 - plane->dy*y0;
+}
+
+// Sets up the plane equations for depth and texture coordinates with the largest triangle of the polygon (for best precision).
+static void _setup_polygon_planes(
+    const pr_raster_vertex* vertices, PRint numVertices,
+    pr_plane_equation* zPlane, pr_plane_equation* uPlane, pr_plane_equation* vPlane)
+{
+    PRint largest = 1;
+    PRlong largestArea = 0;
+
+    for (PRint i = 1; i + 1 < numVertices; ++i)
+    {
+        PRlong triArea =
+            (PRlong)(vertices[i].x - vertices[0].x)*(vertices[i + 1].y - vertices[0].y) -
+            (PRlong)(vertices[i + 1].x - vertices[0].x)*(vertices[i].y - vertices[0].y);
+
+        if (triArea < 0)
+            triArea = -triArea;
+
+        if (largestArea < triArea)
+        {
+            largestArea = triArea;
+            largest = i;
+        }
+    }
+
+    const pr_raster_vertex* a = &(vertices[0]);
+    const pr_raster_vertex* b = &(vertices[largest]);
+    const pr_raster_vertex* c = &(vertices[largest + 1]);
+
+    _setup_plane_equation(zPlane, a, b, c, a->z, b->z, c->z);
+    _setup_plane_equation(uPlane, a, b, c, a->u, b->u, c->u);
+    _setup_plane_equation(vPlane, a, b, c, a->v, b->v, c->v);
+}
+
+// Converts the specified z value into a pixel depth, clamped to the valid range (for extrapolated values).
+static PRdepthtype _clamped_pixel_depth(PRinterp z)
+{
+    return _pr_pixel_write_depth(PR_CLAMP(z, PR_FLOAT(0.0), PR_FLOAT(1.0)));
+}
+
+// Returns the maximal pixel depth of the specified polygon.
+static PRdepthtype _polygon_max_depth(const pr_raster_vertex* vertices, PRint numVertices)
+{
+    PRinterp zMax = vertices[0].z;
+
+    for (PRint i = 1; i < numVertices; ++i)
+        PR_CLAMP_LARGEST(zMax, vertices[i].z);
+
+    return _clamped_pixel_depth(zMax);
+}
+
+/*
+Rasterizes a span of pixels with or without depth test. This is used with constant arguments for 'depthTest' and 'pot',
+so that each combination is compiled into its own loop. With 'pot', the texture coordinates are converted to fixed-point
+and wrapped with bit masks (see _pr_texture_sample_nearest_pot).
+*/
+PR_INLINE void _rasterize_span_with_sampler(
+    PRcolorindex* color, PRdepthtype* depth, PRint count, PRinterp zAct, PRinterp uAct, PRinterp vAct,
+    PRinterp zStep, PRinterp uStep, PRinterp vStep, const pr_texture_level* level, PRboolean depthTest, PRboolean pot)
+{
+    for (; count > 0; --count)
+    {
+        const PRdepthtype pixelDepth = _pr_pixel_write_depth(zAct);
+
+        if (!depthTest || pixelDepth > *depth)
+        {
+            *depth = pixelDepth;
+
+            #ifdef PR_PERSPECTIVE_CORRECTED
+            // Compute perspective corrected texture coordinates
+            PRinterp z = PR_FLOAT(1.0) / zAct;
+            PRinterp u = uAct * z;
+            PRinterp v = vAct * z;
+            #else
+            PRinterp u = uAct;
+            PRinterp v = vAct;
+            #endif
+
+            // Sample texture
+            if (pot)
+                *color = _pr_texture_sample_nearest_pot(level, PR_TEXCOORD_FIXED(u), PR_TEXCOORD_FIXED(v));
+            else
+                *color = _pr_texture_sample_nearest_from_mipmap(level, (PRfloat)u, (PRfloat)v);
+        }
+
+        // Next pixel
+        color += PR_FRAMEBUFFER_COLOR_STRIDE;
+        depth += PR_FRAMEBUFFER_DEPTH_STRIDE;
+        zAct += zStep;
+        uAct += uStep;
+        vAct += vStep;
+    }
+}
+
+/*
+Selects the MIP level for a span from the screen space derivatives of the texture coordinates at the span center.
+The level of detail is log2 of the largest texel footprint (in x or y direction), rounded to the nearest level.
+*/
+static void _select_span_miplevel(
+    const pr_texture_sampler* sampler, PRint count, PRinterp zAct, PRinterp uAct, PRinterp vAct,
+    const pr_plane_equation* zPlane, const pr_plane_equation* uPlane, const pr_plane_equation* vPlane,
+    pr_texture_level* level)
+{
+    const pr_texture* texture = sampler->texture;
+
+    #ifdef PR_PERSPECTIVE_CORRECTED
+    // Derive u = uAct/zAct and v = vAct/zAct at the span center with the quotient rule
+    const PRinterp center = (PRinterp)(count - 1) * PR_FLOAT(0.5);
+    const PRinterp w = PR_FLOAT(1.0) / (zAct + zPlane->dx * center);
+    const PRinterp u = (uAct + uPlane->dx * center) * w;
+    const PRinterp v = (vAct + vPlane->dx * center) * w;
+
+    const PRinterp dudx = (uPlane->dx - u * zPlane->dx) * w * texture->width;
+    const PRinterp dudy = (uPlane->dy - u * zPlane->dy) * w * texture->width;
+    const PRinterp dvdx = (vPlane->dx - v * zPlane->dx) * w * texture->height;
+    const PRinterp dvdy = (vPlane->dy - v * zPlane->dy) * w * texture->height;
+    #else
+    const PRinterp dudx = uPlane->dx * texture->width;
+    const PRinterp dudy = uPlane->dy * texture->width;
+    const PRinterp dvdx = vPlane->dx * texture->height;
+    const PRinterp dvdy = vPlane->dy * texture->height;
+    #endif
+
+    const PRfloat rhoSq = (PRfloat)PR_MAX(dudx*dudx + dvdx*dvdx, dudy*dudy + dvdy*dvdy);
+
+    // Round log2(rho) to the nearest integer, which is floor(log2(2 * rho^2) / 2)
+    PRint lod = _int_log2(rhoSq * 2.0f);
+    lod = (lod < 0 ? 0 : lod / 2) + sampler->lodBias;
 
+    *level = texture->levels[PR_MIN(lod, texture->mips - 1)];
+}
+
+/*
+Rasterizes a span of 'count' pixels, which starts with the interpolated values (zAct, uAct, vAct).
+The MIP level and the texture sampler are selected once for the whole span: power-of-two MIP levels use the fixed-point sampler.
+*/
+static void _rasterize_span(
+    PRcolorindex* color, PRdepthtype* depth, PRint count, PRinterp zAct, PRinterp uAct, PRinterp vAct,
+    const pr_plane_equation* zPlane, const pr_plane_equation* uPlane, const pr_plane_equation* vPlane,
+    const pr_texture_sampler* sampler, PRboolean depthTest)
+{
+    // Select MIP level (as local copy, so that its fields are not reloaded after each pixel write)
+    pr_texture_level mip;
+
+    if (sampler->texture != NULL)
+        _select_span_miplevel(sampler, count, zAct, uAct, vAct, zPlane, uPlane, vPlane, &mip);
+    else
+        mip = sampler->level;
+
+    const PRinterp zStep = zPlane->dx, uStep = uPlane->dx, vStep = vPlane->dx;
+
+    if (mip.pot != PR_FALSE)
+    {
+        if (depthTest)
+            _rasterize_span_with_sampler(color, depth, count, zAct, uAct, vAct, zStep, uStep, vStep, &mip, PR_TRUE, PR_TRUE);
+        else
+            _rasterize_span_with_sampler(color, depth, count, zAct, uAct, vAct, zStep, uStep, vStep, &mip, PR_FALSE, PR_TRUE);
+    }
+    else
+    {
+        if (depthTest)
+            _rasterize_span_with_sampler(color, depth, count, zAct, uAct, vAct, zStep, uStep, vStep, &mip, PR_TRUE, PR_FALSE);
+        else
+            _rasterize_span_with_sampler(color, depth, count, zAct, uAct, vAct, zStep, uStep, vStep, &mip, PR_FALSE, PR_FALSE);
+    }
+}
+
+/*
+Rasterizes convex polygon filled. Only the pixels inside the specified rectangle are written,
+which is either the clipping rectangle or the rectangle of a single screen tile.
+A pixel is covered when its center is inside the polygon, or on a top or left edge (top-left fill rule).
+*/
+static void _rasterize_polygon_fill(
+    pr_framebuffer* frameBuffer, pr_scaline_side* leftSide, pr_scaline_side* rightSide,
+    const pr_raster_vertex* vertices, PRint numVertices,
+    const pr_texture_sampler* sampler, const pr_rect* rect)
+{
     // Find left- and right sided polygon edges
-    PRint x, y, top = 0, bottom = 0;
+    PRint x, y, top = 0, bottom = 0, left = 0, right = 0;
 
-    for (x = 1; x < _numPolyVerts; ++x)
+    for (x = 1; x < numVertices; ++x)
     {
-        if (_rasterVertices[top].y > _rasterVertices[x].y)
+        if (vertices[top].y > vertices[x].y)
             top = x;
-        if (_rasterVertices[bottom].y < _rasterVertices[x].y)
+        if (vertices[bottom].y < vertices[x].y)
             bottom = x;
+        if (vertices[left].x > vertices[x].x)
+            left = x;
+        if (vertices[right].x < vertices[x].x)
+            right = x;
     }
 
-    // Setup raster scanline sides
-    pr_scaline_side* leftSide = frameBuffer->scanlinesStart;
-    pr_scaline_side* rightSide = frameBuffer->scanlinesEnd;
+    PRint yStart = PR_MAX(PR_SUBPIXEL_CEIL(vertices[top].y), rect->top);
+    PRint yEnd = PR_MIN(PR_SUBPIXEL_CEIL(vertices[bottom].y) - 1, rect->bottom);
+
+    if (yStart > yEnd)
+        return;
+
+    const PRint xMin = PR_MAX(PR_SUBPIXEL_CEIL(vertices[left].x), rect->left);
+    const PRint xMax = PR_MIN(PR_SUBPIXEL_FLOOR(vertices[right].x), rect->right);
 
+    _pr_framebuffer_prepare_rect(frameBuffer, xMin, yStart, xMax, yEnd);
+
+    // Reject polygon if it is completely hidden
+    if (_pr_framebuffer_is_occluded(frameBuffer, xMin, yStart, xMax, yEnd, _polygon_max_depth(vertices, numVertices)))
+        return;
+
+    const PRlong area = _polygon_signed_area(vertices, numVertices);
+
+    if (area == 0)
+        return;
+
+    // Setup raster scanline sides
     x = y = top;
-    for (_index_dec(&y, _numPolyVerts); x != bottom; x = y, _index_dec(&y, _numPolyVerts))
-        _pr_framebuffer_setup_scanlines(frameBuffer, leftSide, _rasterVertices[x], _rasterVertices[y]);
+    for (_index_dec(&y, numVertices); x != bottom; x = y, _index_dec(&y, numVertices))
+        _pr_framebuffer_setup_scanlines(frameBuffer, leftSide, vertices[x], vertices[y], yStart, yEnd);
 
     x = y = top;
-    for (_index_inc(&y, _numPolyVerts); x != bottom; x = y, _index_inc(&y, _numPolyVerts))
-        _pr_framebuffer_setup_scanlines(frameBuffer, rightSide, _rasterVertices[x], _rasterVertices[y]);
+    for (_index_inc(&y, numVertices); x != bottom; x = y, _index_inc(&y, numVertices))
+        _pr_framebuffer_setup_scanlines(frameBuffer, rightSide, vertices[x], vertices[y], yStart, yEnd);
 
-    // Check if sides must be swaped
-    long midIndex = (_rasterVertices[bottom].y + _rasterVertices[top].y) / 2;
-    if (frameBuffer->scanlinesStart[midIndex].offset > frameBuffer->scanlinesEnd[midIndex].offset)
+    // Check if sides must be swaped (vertices in counter-clockwise order)
+    if (area < 0)
         PR_SWAP(pr_scaline_side*, leftSide, rightSide);
 
+    // Setup plane equations for interpolation
+    pr_plane_equation zPlane, uPlane, vPlane;
+    _setup_polygon_planes(vertices, numVertices, &zPlane, &uPlane, &vPlane);
+
     // Start rasterizing the polygon
-    PRint len, offset;
-    PRinterp z, zAct, zStep;
-    PRinterp u, uAct, uStep;
-    PRinterp v, vAct, vStep;
+    const PRint pitch = (PRint)frameBuffer->width;
 
-    PRint yStart = _rasterVertices[top].y;
-    PRint yEnd = _rasterVertices[bottom].y;
+    PRint xStart, xEnd, xChunkEnd;
+    PRinterp zAct, uAct, vAct;
+    PRdepthtype chunkDepth;
 
-    pr_pixel* pixel;
+    pr_depth_block* block;
+    PRcolorindex* color;
+    PRdepthtype* depth;
 
     // Rasterize each scanline
     for (y = yStart; y <= yEnd; ++y)
     {
-        len = rightSide[y].offset - leftSide[y].offset;
-        if (len <= 0)
+        // Get scanline range [xStart, xEnd) and clip it against the rectangle
+        xStart = PR_MAX(leftSide[y].offset - y * pitch, rect->left);
+        xEnd = PR_MIN(rightSide[y].offset - y * pitch, rect->right + 1);
+
+        if (xStart >= xEnd)
             continue;
 
-        zStep = (rightSide[y].z - leftSide[y].z) / len;
-        uStep = (rightSide[y].u - leftSide[y].u) / len;
-        vStep = (rightSide[y].v - leftSide[y].v) / len;
+        color = PR_FRAMEBUFFER_COLOR_PTR(frameBuffer, y * pitch + xStart);
+        depth = PR_FRAMEBUFFER_DEPTH_PTR(frameBuffer, y * pitch + xStart);
 
-        offset = leftSide[y].offset;
-        zAct = leftSide[y].z;
-        uAct = leftSide[y].u;
-        vAct = leftSide[y].v;
+        zAct = zPlane.value + zPlane.dx * xStart + zPlane.dy * y;
+        uAct = uPlane.value + uPlane.dx * xStart + uPlane.dy * y;
+        vAct = vPlane.value + vPlane.dx * xStart + vPlane.dy * y;
 
-        // Rasterize current scanline
-        while (len-- >= 0)
+        // Rasterize current scanline in chunks of pixel blocks
+        block = _pr_framebuffer_depth_block(frameBuffer, xStart, y);
+
+        for (x = xStart; x < xEnd; ++block)
         {
-            // Fetch pixel from framebuffer
-            pixel = &(frameBuffer->pixels[offset]);
+            xChunkEnd = PR_MIN((x / PR_BLOCK_SIZE + 1) * PR_BLOCK_SIZE, xEnd);
 
-            // Make depth test
-            PRdepthtype depth = _pr_pixel_write_depth(zAct);
+            // Skip chunk if it is completely hidden
+            chunkDepth = _clamped_pixel_depth(PR_MAX(zAct, zAct + zPlane.dx * (xChunkEnd - 1 - x)));
 
-            if (depth > pixel->depth)
+            if (chunkDepth < block->zMin)
             {
-                pixel->depth = depth;
-
-                #ifdef PR_PERSPECTIVE_CORRECTED
-                // Compute perspective corrected texture coordinates
-                z = PR_FLOAT(1.0) / zAct;
-                u = uAct * z;
-                v = vAct * z;
-                #else
-                z = zAct;
-                u = uAct;
-                v = vAct;
-                #endif
-
-                // Sample texture
-                pixel->colorIndex = _pr_texture_sample_nearest_from_mipmap(texels, mipWidth, mipHeight, (PRfloat)u, (PRfloat)v);
-                //pixel->colorIndex = _pr_texture_sample_nearest(texture, u, v, uStep*z, vStep*z);
-                //pixel->colorIndex = (PRubyte)(zAct * (PRfloat)UCHAR_MAX);
+                color += (xChunkEnd - x) * PR_FRAMEBUFFER_COLOR_STRIDE;
+                depth += (xChunkEnd - x) * PR_FRAMEBUFFER_DEPTH_STRIDE;
+                zAct += zPlane.dx * (xChunkEnd - x);
+                uAct += uPlane.dx * (xChunkEnd - x);
+                vAct += vPlane.dx * (xChunkEnd - x);
+                x = xChunkEnd;
+                continue;
             }
 
-            // Next pixel
-            ++offset;
-            zAct += zStep;
-            uAct += uStep;
-            vAct += vStep;
+            _pr_depth_block_write(block, chunkDepth);
+
+            // Rasterize pixels of this chunk with depth test
+            _rasterize_span(color, depth, xChunkEnd - x, zAct, uAct, vAct, &zPlane, &uPlane, &vPlane, sampler, PR_TRUE);
+
+            color += (xChunkEnd - x) * PR_FRAMEBUFFER_COLOR_STRIDE;
+            depth += (xChunkEnd - x) * PR_FRAMEBUFFER_DEPTH_STRIDE;
+            zAct += zPlane.dx * (xChunkEnd - x);
+            uAct += uPlane.dx * (xChunkEnd - x);
+            vAct += vPlane.dx * (xChunkEnd - x);
+            x = xChunkEnd;
         }
     }
 }
 
+// Edge equation E(x, y) = a*x + b*y + c of a polygon edge (in pixels). Pixels with E(x, y) >= 0 are inside.
+typedef struct pr_edge_equation
+{
+    PRlong a;
+    PRlong b;
+    PRlong c;
+}
+pr_edge_equation;
+
+/*
+Rasterizes convex polygon filled with the half-space algorithm. The bounding box of the polygon is
+traversed in blocks of PR_BLOCK_SIZE x PR_BLOCK_SIZE pixels. Blocks which are completely outside of one edge
+are rejected, and blocks which are completely inside of all edges are filled without any edge tests.
+For partially covered blocks, the pixel span of each row is derived from the edge equations.
+The edge equations are evaluated exactly on the sub-pixel grid, so shared edges of adjacent polygons
+are rasterized without gaps and without overlap (top-left fill rule).
+*/
+static void _rasterize_polygon_halfspace(
+    pr_framebuffer* frameBuffer, const pr_raster_vertex* vertices, PRint numVertices,
+    const pr_texture_sampler* sampler, const pr_rect* rect)
+{
+    // Find bounding box
+    PRint i, xMin = vertices[0].x, xMax = vertices[0].x, yMin = vertices[0].y, yMax = vertices[0].y;
+
+    for (i = 1; i < numVertices; ++i)
+    {
+        PR_CLAMP_SMALLEST(xMin, vertices[i].x);
+        PR_CLAMP_LARGEST(xMax, vertices[i].x);
+        PR_CLAMP_SMALLEST(yMin, vertices[i].y);
+        PR_CLAMP_LARGEST(yMax, vertices[i].y);
+    }
+
+    xMin = PR_MAX(PR_SUBPIXEL_CEIL(xMin), rect->left);
+    xMax = PR_MIN(PR_SUBPIXEL_FLOOR(xMax), rect->right);
+    yMin = PR_MAX(PR_SUBPIXEL_CEIL(yMin), rect->top);
+    yMax = PR_MIN(PR_SUBPIXEL_FLOOR(yMax), rect->bottom);
+
+    if (xMin > xMax || yMin > yMax)
+        return;
+
+    _pr_framebuffer_prepare_rect(frameBuffer, xMin, yMin, xMax, yMax);
+
+    // Reject polygon if it is completely hidden
+    if (_pr_framebuffer_is_occluded(frameBuffer, xMin, yMin, xMax, yMax, _polygon_max_depth(vertices, numVertices)))
+        return;
+
+    // Setup edge equations (flip them for counter-clockwise polygons, so that the inside is always positive)
+    const PRlong area = _polygon_signed_area(vertices, numVertices);
+
+    if (area == 0)
+        return;
+
+    pr_edge_equation edges[PR_MAX_NUM_POLYGON_VERTS];
+
+    for (PRint x = numVertices - 1, y = 0; y < numVertices; x = y, ++y)
+    {
+        pr_edge_equation* edge = &(edges[y]);
+
+        PRlong a = (PRlong)(vertices[x].y - vertices[y].y);
+        PRlong b = (PRlong)(vertices[y].x - vertices[x].x);
+
+        if (area < 0)
+        {
+            a = -a;
+            b = -b;
+        }
+
+        // Exclude pixel centers exactly on right and bottom edges (top-left fill rule)
+        edge->c = -(a * vertices[x].x + b * vertices[x].y);
+
+        if (a < 0 || (a == 0 && b < 0))
+            --edge->c;
+
+        // Scale coefficients from sub-pixels to pixels
+        edge->a = a * PR_SUBPIXEL_SCALE;
+        edge->b = b * PR_SUBPIXEL_SCALE;
+    }
+
+    // Setup plane equations for interpolation
+    pr_plane_equation zPlane, uPlane, vPlane;
+    _setup_polygon_planes(vertices, numVertices, &zPlane, &uPlane, &vPlane);
+
+    // Traverse all blocks of the bounding box
+    const PRint pitch = (PRint)frameBuffer->width;
+
+    PRlong edgeRow[PR_MAX_NUM_POLYGON_VERTS];
+    PRint bx, by, y, x0, y0, x1, y1;
+    PRinterp zRow, uRow, vRow, zAct, uAct, vAct, zBlockMin, zBlockMax;
+    PRdepthtype blockDepthMax;
+    PRboolean inside, depthTest;
+    pr_depth_block* block;
+    PRcolorindex* color;
+    PRdepthtype* depth;
+
+    for (by = yMin - (yMin % PR_BLOCK_SIZE); by <= yMax; by += PR_BLOCK_SIZE)
+    {
+        y0 = PR_MAX(by, yMin);
+        y1 = PR_MIN(by + PR_BLOCK_SIZE - 1, yMax);
+
+        for (bx = xMin - (xMin % PR_BLOCK_SIZE); bx <= xMax; bx += PR_BLOCK_SIZE)
+        {
+            x0 = PR_MAX(bx, xMin);
+            x1 = PR_MIN(bx + PR_BLOCK_SIZE - 1, xMax);
+
+            // Classify block against all edges with its corners
+            inside = PR_TRUE;
+
+            for (i = 0; i < numVertices; ++i)
+            {
+                const pr_edge_equation* edge = &(edges[i]);
+                const PRlong e = edge->a * x0 + edge->b * y0 + edge->c;
+                const PRlong ex = edge->a * (x1 - x0);
+                const PRlong ey = edge->b * (y1 - y0);
+
+                if (e + PR_MAX(ex, 0) + PR_MAX(ey, 0) < 0)
+                    break;
+                if (e + PR_MIN(ex, 0) + PR_MIN(ey, 0) < 0)
+                    inside = PR_FALSE;
+
+                edgeRow[i] = e;
+            }
+
+            if (i < numVertices)
+                continue;
+
+            // Get depth range of the polygon inside this block
+            zRow = zPlane.value + zPlane.dx * x0 + zPlane.dy * y0;
+
+            zBlockMin = zRow + PR_MIN(zPlane.dx * (x1 - x0), 0) + PR_MIN(zPlane.dy * (y1 - y0), 0);
+            zBlockMax = zRow + PR_MAX(zPlane.dx * (x1 - x0), 0) + PR_MAX(zPlane.dy * (y1 - y0), 0);
+
+            blockDepthMax = _clamped_pixel_depth(zBlockMax);
+
+            // Reject block if it is completely hidden
+            block = _pr_framebuffer_depth_block(frameBuffer, x0, y0);
+
+            if (blockDepthMax < block->zMin)
+                continue;
+
+            // Skip depth test if the polygon is completely in front of this block (with a margin for rounding errors)
+            depthTest = (!inside || (PRint)_clamped_pixel_depth(zBlockMin) <= (PRint)block->zMax + 1);
+
+            _pr_depth_block_write(block, blockDepthMax);
+
+            // Rasterize block
+            uRow = uPlane.value + uPlane.dx * x0 + uPlane.dy * y0;
+            vRow = vPlane.value + vPlane.dx * x0 + vPlane.dy * y0;
+
+            for (y = y0; y <= y1; ++y)
+            {
+                color = PR_FRAMEBUFFER_COLOR_PTR(frameBuffer, y * pitch + x0);
+                depth = PR_FRAMEBUFFER_DEPTH_PTR(frameBuffer, y * pitch + x0);
+
+                zAct = zRow;
+                uAct = uRow;
+                vAct = vRow;
+
+                if (inside)
+                    _rasterize_span(color, depth, x1 - x0 + 1, zAct, uAct, vAct, &zPlane, &uPlane, &vPlane, sampler, depthTest);
+                else
+                {
+                    // Find pixel span of this row inside all edges
+                    PRint xStart = x0, xEnd = x1;
+
+                    for (i = 0; i < numVertices; ++i)
+                    {
+                        const PRlong a = edges[i].a, e = edgeRow[i];
+
+                        if (a > 0)
+                        {
+                            if (e < 0)
+                                PR_CLAMP_LARGEST(xStart, x0 + (PRint)((a - 1 - e) / a));
+                        }
+                        else if (a < 0)
+                        {
+                            if (e < 0)
+                                xEnd = x0 - 1;
+                            else
+                                PR_CLAMP_SMALLEST(xEnd, x0 + (PRint)(e / (-a)));
+                        }
+                        else if (e < 0)
+                            xEnd = x0 - 1;
+
+                        edgeRow[i] += edges[i].b;
+                    }
+
+                    // Rasterize span
+                    if (xStart <= xEnd)
+                    {
+                        color += (xStart - x0) * PR_FRAMEBUFFER_COLOR_STRIDE;
+                        depth += (xStart - x0) * PR_FRAMEBUFFER_DEPTH_STRIDE;
+                        zAct += zPlane.dx * (xStart - x0);
+                        uAct += uPlane.dx * (xStart - x0);
+                        vAct += vPlane.dx * (xStart - x0);
+
+                        _rasterize_span(color, depth, xEnd - xStart + 1, zAct, uAct, vAct, &zPlane, &uPlane, &vPlane, sampler, PR_TRUE);
+                    }
+                }
+
+                // Next row
+                zRow += zPlane.dy;
+                uRow += uPlane.dy;
+                vRow += vPlane.dy;
+            }
+        }
+    }
+}
+
+// Rasterizes a polygon from the tile binner into a single screen tile (called from worker threads)
+static void _rasterize_binned_polygon(
+    pr_framebuffer* frameBuffer, pr_tile_worker* worker,
+    const pr_raster_vertex* vertices, const pr_binned_polygon* polygon, const pr_rect* tileRect)
+{
+    _rasterize_polygon_fill(
+        frameBuffer,
+        worker->scanlinesStart,
+        worker->scanlinesEnd,
+        vertices + polygon->firstVertex,
+        (PRint)polygon->numVertices,
+        &(polygon->sampler),
+        tileRect
+    );
+}
+
+// Rasterizes a polygon from the tile binner into a single screen tile with the half-space algorithm
+static void _rasterize_binned_polygon_halfspace(
+    pr_framebuffer* frameBuffer, pr_tile_worker* worker,
+    const pr_raster_vertex* vertices, const pr_binned_polygon* polygon, const pr_rect* tileRect)
+{
+    // The half-space rasterizer needs no scanline scratch buffers
+    PR_UNUSED(worker);
+
+    _rasterize_polygon_halfspace(
+        frameBuffer,
+        vertices + polygon->firstVertex,
+        (PRint)polygon->numVertices,
+        &(polygon->sampler),
+        tileRect
+    );
+}
+
+// Rasterizes all polygons which have been binned since the last flush
+static void _flush_binned_polygons()
+{
+    _pr_tile_binner_flush(
+        &(PR_STATE_MACHINE.tileBinner),
+        &(_globalState.threadPool),
+        PR_STATE_MACHINE.states[PR_HALF_SPACE_RASTERIZER] != PR_FALSE ? _rasterize_binned_polygon_halfspace : _rasterize_binned_polygon
+    );
+}
+
+// Finishes a draw call; binned polygons are kept while a command buffer batches several draw calls
+static void _end_draw_call()
+{
+    if (PR_STATE_MACHINE.batchDrawCalls == PR_FALSE)
+        _flush_binned_polygons();
+}
+
 // Rasterizes convex polygon outlines
-static void _rasterize_polygon_line(pr_framebuffer* frameBuffer, const pr_texture* texture, PRubyte mipLevel)
+static void _rasterize_polygon_line(pr_raster_context* context, pr_framebuffer* frameBuffer, const pr_texture* texture, PRubyte mipLevel)
 {
-    for (PRint i = 0; i + 1 < _numPolyVerts; ++i)
-        _rasterize_line(frameBuffer, texture, mipLevel, i, i + 1);
-    _rasterize_line(frameBuffer, texture, mipLevel, _numPolyVerts - 1, 0);
+    for (PRint i = 0; i + 1 < context->numPolyVerts; ++i)
+        _rasterize_line(context, frameBuffer, texture, mipLevel, i, i + 1);
+    _rasterize_line(context, frameBuffer, texture, mipLevel, context->numPolyVerts - 1, 0);
 }
 
 // Rasterizes convex polygon points
 static void _rasterize_polygon_point(
-    pr_framebuffer* frameBuffer, const pr_texture* texture, PRubyte mipLevel)
+    pr_raster_context* context, pr_framebuffer* frameBuffer, const pr_texture* texture, PRubyte mipLevel)
 {
-    for (PRint i = 0; i < _numPolyVerts; ++i)
+    for (PRint i = 0; i < context->numPolyVerts; ++i)
     {
         _pr_framebuffer_plot(
             frameBuffer,
-            _rasterVertices[i].x,
-            _rasterVertices[i].y,
+            PR_SUBPIXEL_ROUND(context->rasterVertices[i].x),
+            PR_SUBPIXEL_ROUND(context->rasterVertices[i].y),
             PR_STATE_MACHINE.color0
         );
     }
 }
 
-static void _rasterize_polygon(pr_framebuffer* frameBuffer, const pr_texture* texture, PRubyte mipLevel)
+static void _rasterize_polygon(pr_raster_context* context, pr_framebuffer* frameBuffer, const pr_texture* texture, PRubyte mipLevel)
 {
     // Rasterize polygon with selected MIP level
     switch (PR_STATE_MACHINE.polygonMode)
     {
         case PR_POLYGON_FILL:
-            _rasterize_polygon_fill(frameBuffer, texture, mipLevel);
-            break;
+        {
+            // MIP levels are selected per span, so 'mipLevel' is only used for lines and points
+            pr_texture_sampler sampler;
+            _pr_texture_setup_sampler(texture, PR_STATE_MACHINE.states[PR_MIP_MAPPING], &sampler);
+
+            if (PR_STATE_MACHINE.states[PR_TILE_BINNING] != PR_FALSE)
+            {
+                // Store polygon for deferred rasterization, see '_flush_binned_polygons'
+                _pr_tile_binner_add_polygon(
+                    &(PR_STATE_MACHINE.tileBinner), frameBuffer, &(PR_STATE_MACHINE.clipRect),
+                    context->rasterVertices, (PRuint)context->numPolyVerts, &sampler
+                );
+            }
+            else if (PR_STATE_MACHINE.states[PR_HALF_SPACE_RASTERIZER] != PR_FALSE)
+            {
+                _rasterize_polygon_halfspace(
+                    frameBuffer, context->rasterVertices, context->numPolyVerts, &sampler, &(PR_STATE_MACHINE.clipRect)
+                );
+            }
+            else
+            {
+                _rasterize_polygon_fill(
+                    frameBuffer, frameBuffer->scanlinesStart, frameBuffer->scanlinesEnd,
+                    context->rasterVertices, context->numPolyVerts, &sampler, &(PR_STATE_MACHINE.clipRect)
+                );
+            }
+        }
+        break;
         case PR_POLYGON_LINE:
-            _rasterize_polygon_line(frameBuffer, texture, mipLevel);
+            _rasterize_polygon_line(context, frameBuffer, texture, mipLevel);
             break;
         case PR_POLYGON_POINT:
-            _rasterize_polygon_point(frameBuffer, texture, mipLevel);
+            _rasterize_polygon_point(context, frameBuffer, texture, mipLevel);
             break;
     }
 }
 
-static PRboolean _clip_and_project_polygon(PRint numVertices)
+// Returns PR_TRUE if the projected polygon is completely inside the guard band around the clipping rectangle.
+static PRboolean _is_polygon_inside_guard_band(const pr_raster_context* context)
 {
-    // Get clipping rectangle
-    const PRint xMin = PR_STATE_MACHINE.clipRect.left;
-    const PRint xMax = PR_STATE_MACHINE.clipRect.right;
-    const PRint yMin = PR_STATE_MACHINE.clipRect.top;
-    const PRint yMax = PR_STATE_MACHINE.clipRect.bottom;
+    const PRfloat xMin = (PRfloat)(PR_STATE_MACHINE.clipRect.left - PR_GUARD_BAND_SIZE);
+    const PRfloat xMax = (PRfloat)(PR_STATE_MACHINE.clipRect.right + PR_GUARD_BAND_SIZE);
+    const PRfloat yMin = (PRfloat)(PR_STATE_MACHINE.clipRect.top - PR_GUARD_BAND_SIZE);
+    const PRfloat yMax = (PRfloat)(PR_STATE_MACHINE.clipRect.bottom + PR_GUARD_BAND_SIZE);
 
-    // Z clipping
-    _numPolyVerts = numVertices;
-    _polygon_z_clipping(1.0f, 100.0f);//!!!
-    //_polygon_z_clipping(0.01f, 100.0f);//!!!
+    for (PRint j = 0; j < context->numPolyVerts; ++j)
+    {
+        const pr_clip_vertex* vertex = &(context->clipVertices[j]);
 
-    if (_numPolyVerts < 3)
-        return PR_FALSE;
+        // Negated comparisons also reject NaN coordinates
+        if (!(vertex->x >= xMin && vertex->x <= xMax && vertex->y >= yMin && vertex->y <= yMax))
+            return PR_FALSE;
+    }
 
-    // Projection
-    for (PRint j = 0; j < _numPolyVerts; ++j)
-        _project_vertex(&(_clipVertices[j]), &(PR_STATE_MACHINE.viewport));
+    return PR_TRUE;
+}
+
+// Returns the X (axis 0) or Y (axis 1) screen coordinate of the specified projected vertex
+PR_INLINE PRfloat _screen_coord(const pr_clip_vertex* vertex, PRint axis)
+{
+    return (axis == 0 ? vertex->x : vertex->y);
+}
+
+// Computes the vertex 'c' which is clipped between the projected vertices 'a' and 'b' and the plane at the screen coordinate 'p'
+static pr_clip_vertex _get_screen_plane_vertex(pr_clip_vertex a, pr_clip_vertex b, PRint axis, PRfloat p)
+{
+    const PRfloat pa = _screen_coord(&a, axis);
+    const PRfloat pb = _screen_coord(&b, axis);
+
+    PRinterp m = ((PRinterp)(p - pb)) / (pa - pb);
+    pr_clip_vertex c;
+
+    c.x = (axis == 0 ? p : (PRfloat)(m * (a.x - b.x) + b.x));
+    c.y = (axis == 1 ? p : (PRfloat)(m * (a.y - b.y) + b.y));
+    c.z = (PRfloat)(m * (a.z - b.z) + b.z);
+    c.w = (PRfloat)(m * (a.w - b.w) + b.w);
+
+    c.u = (PRfloat)(m * (a.u - b.u) + b.u);
+    c.v = (PRfloat)(m * (a.v - b.v) + b.v);
+
+    return c;
+}
+
+/*
+Clips the projected polygon 'src' at the plane of the specified screen axis and stores it in 'dst'.
+The inside of the plane is (coord >= p) for 'side' = 1, or (coord <= p) for 'side' = -1. Returns the number of vertices of 'dst'.
+*/
+static PRint _polygon_screen_plane_clipping(
+    const pr_clip_vertex* src, PRint numVerts, pr_clip_vertex* dst, PRint axis, PRfloat p, PRfloat side)
+{
+    PRint x, y, localNumVerts = 0;
+
+    for (x = numVerts - 1, y = 0; y < numVerts; x = y, ++y)
+    {
+        const PRboolean insideX = ((_screen_coord(&src[x], axis) - p) * side >= 0.0f);
+        const PRboolean insideY = ((_screen_coord(&src[y], axis) - p) * side >= 0.0f);
+
+        // Inside
+        if (insideX && insideY)
+            dst[localNumVerts++] = src[y];
+
+        // Leaving
+        if (insideX && !insideY)
+            dst[localNumVerts++] = _get_screen_plane_vertex(src[x], src[y], axis, p);
+
+        // Entering
+        if (!insideX && insideY)
+        {
+            dst[localNumVerts++] = _get_screen_plane_vertex(src[x], src[y], axis, p);
+            dst[localNumVerts++] = src[y];
+        }
+    }
+
+    return localNumVerts;
+}
+
+/*
+Clips the projected polygon at the guard band around the clipping rectangle, before it is rounded to the sub-pixel grid,
+so that the fixed-point conversion of vertices far outside the screen can not overflow.
+Returns PR_FALSE if the polygon is outside the guard band (or has invalid coordinates).
+*/
+static PRboolean _polygon_guard_band_clipping(pr_raster_context* context)
+{
+    const PRfloat xMin = (PRfloat)(PR_STATE_MACHINE.clipRect.left - PR_GUARD_BAND_SIZE);
+    const PRfloat xMax = (PRfloat)(PR_STATE_MACHINE.clipRect.right + PR_GUARD_BAND_SIZE);
+    const PRfloat yMin = (PRfloat)(PR_STATE_MACHINE.clipRect.top - PR_GUARD_BAND_SIZE);
+    const PRfloat yMax = (PRfloat)(PR_STATE_MACHINE.clipRect.bottom + PR_GUARD_BAND_SIZE);
+
+    PRint numVerts = context->numPolyVerts;
+
+    numVerts = _polygon_screen_plane_clipping(context->clipVertices, numVerts, context->clipVerticesTmp, 0, xMin, 1.0f);
+    numVerts = _polygon_screen_plane_clipping(context->clipVerticesTmp, numVerts, context->clipVertices, 0, xMax, -1.0f);
+    numVerts = _polygon_screen_plane_clipping(context->clipVertices, numVerts, context->clipVerticesTmp, 1, yMin, 1.0f);
+    numVerts = _polygon_screen_plane_clipping(context->clipVerticesTmp, numVerts, context->clipVertices, 1, yMax, -1.0f);
+
+    context->numPolyVerts = numVerts;
+
+    // Interpolation with infinite coordinates results in NaN, which is rejected by the guard band test
+    return (numVerts >= 3 && _is_polygon_inside_guard_band(context));
+}
+
+/*
+Culls the projected polygon, rounds it to the sub-pixel grid and clips it against the clipping rectangle.
+With the guard band enabled, filled polygons inside the guard band are not clipped at all,
+because the fill rasterizers only write the pixels inside the clipping rectangle.
+*/
+static PRboolean _setup_projected_polygon(pr_raster_context* context)
+{
+    /*
+    Get clipping rectangle on the sub-pixel grid. The right and bottom planes are moved
+    almost half a pixel outwards, because right and bottom edges are excluded by the fill rule.
+    */
+    const PRint xMin = PR_STATE_MACHINE.clipRect.left * PR_SUBPIXEL_SCALE;
+    const PRint xMax = PR_STATE_MACHINE.clipRect.right * PR_SUBPIXEL_SCALE + (PR_SUBPIXEL_SCALE/2 - 1);
+    const PRint yMin = PR_STATE_MACHINE.clipRect.top * PR_SUBPIXEL_SCALE;
+    const PRint yMax = PR_STATE_MACHINE.clipRect.bottom * PR_SUBPIXEL_SCALE + (PR_SUBPIXEL_SCALE/2 - 1);
 
     // Make culling test
-    if (_is_triangle_culled(_CVERT_VEC2(0), _CVERT_VEC2(1), _CVERT_VEC2(2)))
+    if (_is_triangle_culled(_CVERT_VEC2(context, 0), _CVERT_VEC2(context, 1), _CVERT_VEC2(context, 2)))
         return PR_FALSE;
 
+    // Polygons which exceed the guard band are clipped in floating-point first (see '_polygon_guard_band_clipping')
+    const PRboolean insideGuardBand = _is_polygon_inside_guard_band(context);
+
+    if (!insideGuardBand && !_polygon_guard_band_clipping(context))
+        return PR_FALSE;
+
+    // Check if edge clipping can be skipped
+    const PRboolean skipClipping = (
+        PR_STATE_MACHINE.states[PR_GUARD_BAND] != PR_FALSE &&
+        PR_STATE_MACHINE.polygonMode == PR_POLYGON_FILL &&
+        insideGuardBand
+    );
+
     // Setup raster vertices
-    for (PRint j = 0; j < _numPolyVerts; ++j)
-        _setup_raster_vertex(&(_rasterVertices[j]), &(_clipVertices[j]));
+    for (PRint j = 0; j < context->numPolyVerts; ++j)
+        _setup_raster_vertex(&(context->rasterVertices[j]), &(context->clipVertices[j]));
+
+    if (skipClipping)
+        return PR_TRUE;
 
     // Edge clipping
-    _polygon_xy_clipping(xMin, xMax, yMin, yMax);
+    _polygon_xy_clipping(context, xMin, xMax, yMin, yMax);
 
-    if (_numPolyVerts < 3)
+    if (context->numPolyVerts < 3)
         return PR_FALSE;
 
     return PR_TRUE;
 }
 
-static PRubyte _compute_polygon_miplevel(const pr_texture* texture)
+static PRboolean _clip_and_project_polygon(pr_raster_context* context, PRint numVertices)
 {
-    if (PR_STATE_MACHINE.states[PR_MIP_MAPPING] != PR_FALSE && texture->mips > 0)
+    // Z clipping
+    context->numPolyVerts = numVertices;
+    _polygon_z_clipping(context, Z_CLIP_NEAR, Z_CLIP_FAR);//!!!
+    //_polygon_z_clipping(0.01f, 100.0f);//!!!
+
+    if (context->numPolyVerts < 3)
+        return PR_FALSE;
+
+    // Projection
+    for (PRint j = 0; j < context->numPolyVerts; ++j)
+        _project_vertex(&(context->clipVertices[j]), &(PR_STATE_MACHINE.viewport));
+
+    return _setup_projected_polygon(context);
+}
+
+/*
+Sets up the triangle with the specified vertices of the vertex cache. If no z clipping is required,
+the vertices, which have already been projected by the vertex cache, are used directly.
+*/
+static PRboolean _setup_cached_triangle(pr_raster_context* context, PRuint indexA, PRuint indexB, PRuint indexC)
+{
+    const pr_vertex_cache* vertexCache = &(context->vertexCache);
+    const PRuint indices[3] = { indexA, indexB, indexC };
+    PRboolean clipping = PR_FALSE;
+
+    for (PRint j = 0; j < 3; ++j)
     {
-        // Find closest vertex
-        PRinterp zMin = _rasterVertices[0].z;
-        for (PRint i = 1; i < _numPolyVerts; ++i)
-        {
-            if (zMin > _rasterVertices[i].z)
-                zMin = _rasterVertices[i].z;
-        }
+        const pr_clip_vertex* vertex = _pr_vertex_cache_fetch(vertexCache, indices[j]);
 
-        // Derive mip level from z value
-        zMin = 0.25f / zMin;
-        PRint zLog = _int_log2((PRfloat)zMin);
+        if (vertex->z < Z_CLIP_NEAR || vertex->z > Z_CLIP_FAR)
+            clipping = PR_TRUE;
 
-        return PR_CLAMP(zLog, 0, texture->mips - 1);
+        context->clipVertices[j] = *vertex;
+    }
+
+    if (clipping)
+        return _clip_and_project_polygon(context, 3);
+
+    for (PRint j = 0; j < 3; ++j)
+        context->clipVertices[j] = *_pr_vertex_cache_fetch_screen(vertexCache, indices[j]);
+
+    context->numPolyVerts = 3;
+
+    return _setup_projected_polygon(context);
+}
+
+// Returns the number of triangles of the specified triangle primitives (PR_TRIANGLES, PR_TRIANGLE_STRIP or PR_TRIANGLE_FAN).
+static PRsizei _num_triangles(PRenum primitives, PRsizei numVertices)
+{
+    if (primitives == PR_TRIANGLES)
+        return numVertices / 3;
+    return (numVertices > 2 ? numVertices - 2 : 0);
+}
+
+/*
+Returns the vertex offsets (relative to the first vertex) of the specified triangle.
+Every second triangle of a strip is flipped, so that all triangles have the same winding order for face culling.
+*/
+PR_INLINE void _triangle_vertex_offsets(PRenum primitives, PRsizei triangle, PRsizei* offsets)
+{
+    switch (primitives)
+    {
+        case PR_TRIANGLES:
+            offsets[0] = triangle*3;
+            offsets[1] = triangle*3 + 1;
+            offsets[2] = triangle*3 + 2;
+            break;
+
+        case PR_TRIANGLE_STRIP:
+            offsets[0] = triangle + (triangle & 1);
+            offsets[1] = triangle + 1 - (triangle & 1);
+            offsets[2] = triangle + 2;
+            break;
+
+        case PR_TRIANGLE_FAN:
+            offsets[0] = 0;
+            offsets[1] = triangle + 1;
+            offsets[2] = triangle + 2;
+            break;
     }
-    return 0;
 }
 
 static void _render_triangles(
-    const pr_texture* texture, PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
+    pr_raster_context* context, const pr_texture* texture, PRenum primitives,
+    PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
 {
     // Get clipping dimensions
     pr_framebuffer* frameBuffer = PR_STATE_MACHINE.boundFrameBuffer;
+    pr_vertex_cache* vertexCache = &(context->vertexCache);
+
+    // Transform all vertices in a single batch, so that shared vertices of strips and fans are only transformed once
+    pr_texcoord_transform texCoordTransform;
+    _setup_texcoord_transform(texture, &texCoordTransform);
 
-    // Iterate over the index buffer
-    for (PRsizei i = firstVertex, n = numVertices + firstVertex; i + 2 < n; i += 3)
+    _pr_vertex_cache_transform_range(
+        vertexCache, vertexBuffer, firstVertex, numVertices,
+        &(PR_STATE_MACHINE.worldViewProjectionMatrix), &(PR_STATE_MACHINE.viewport), &texCoordTransform
+    );
+
+    // Iterate over all triangles
+    const PRsizei numTriangles = _num_triangles(primitives, numVertices);
+    PRsizei offsets[3];
+
+    for (PRsizei i = 0; i < numTriangles; ++i)
     {
-        // Fetch vertices
-        const pr_vertex* vertexA = (vertexBuffer->vertices + i);
-        const pr_vertex* vertexB = (vertexBuffer->vertices + (i + 1));
-        const pr_vertex* vertexC = (vertexBuffer->vertices + (i + 2));
+        _triangle_vertex_offsets(primitives, i, offsets);
 
         // Setup polygon
-        _transform_vertex(&(_clipVertices[0]), vertexA);
-        _transform_vertex(&(_clipVertices[1]), vertexB);
-        _transform_vertex(&(_clipVertices[2]), vertexC);
-
-        if (_clip_and_project_polygon(3) != PR_FALSE)
+        if (_setup_cached_triangle(context, firstVertex + offsets[0], firstVertex + offsets[1], firstVertex + offsets[2]) != PR_FALSE)
         {
             // Rasterize active polygon
-            _rasterize_polygon(frameBuffer, texture, _compute_polygon_miplevel(texture));
+            _rasterize_polygon(context, frameBuffer, texture, _compute_polygon_miplevel(context, texture));
         }
     }
+
+    _end_draw_call();
 }
 
-void _pr_render_triangles(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
+static void _draw_triangles(PRenum primitives, PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
 {
     if (PR_STATE_MACHINE.boundFrameBuffer == NULL)
     {
@@ -1049,67 +2155,74 @@ void _pr_render_triangles(PRsizei numVertices, PRsizei firstVertex, const pr_ver
         return;
     }
 
-    pr_texture* texture = PR_STATE_MACHINE.boundTexture;
-    if (texture == NULL || texture->texels == NULL)
+    pr_texture* texture = _bound_texture();
+    if (texture == NULL)
     {
         _pr_texture_singular_color(&PR_SINGULAR_TEXTURE, PR_STATE_MACHINE.color0);
-        _render_triangles(&PR_SINGULAR_TEXTURE, numVertices, firstVertex, vertexBuffer);
+        _render_triangles(&(PR_RASTER_CONTEXT), &PR_SINGULAR_TEXTURE, primitives, numVertices, firstVertex, vertexBuffer);
     }
     else
-        _render_triangles(texture, numVertices, firstVertex, vertexBuffer);
+        _render_triangles(&(PR_RASTER_CONTEXT), texture, primitives, numVertices, firstVertex, vertexBuffer);
+}
+
+void _pr_render_triangles(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
+{
+    _draw_triangles(PR_TRIANGLES, numVertices, firstVertex, vertexBuffer);
 }
 
 void _pr_render_triangle_strip(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
 {
-    //...
+    _draw_triangles(PR_TRIANGLE_STRIP, numVertices, firstVertex, vertexBuffer);
 }
 
 void _pr_render_triangle_fan(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer)
 {
-    //...
+    _draw_triangles(PR_TRIANGLE_FAN, numVertices, firstVertex, vertexBuffer);
 }
 
 static void _render_indexed_triangles(
-    const pr_texture* texture, PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
+    pr_raster_context* context, const pr_texture* texture, PRenum primitives,
+    PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
 {
     // Get clipping dimensions
     pr_framebuffer* frameBuffer = PR_STATE_MACHINE.boundFrameBuffer;
+    pr_vertex_cache* vertexCache = &(context->vertexCache);
+
+    // Transform all referenced vertices once
+    pr_texcoord_transform texCoordTransform;
+    _setup_texcoord_transform(texture, &texCoordTransform);
 
-    // Iterate over the index buffer
-    for (PRsizei i = firstVertex, n = numVertices + firstVertex; i + 2 < n; i += 3)
+    if ( !_pr_vertex_cache_transform(
+            vertexCache, vertexBuffer, indexBuffer, firstVertex, numVertices,
+            &(PR_STATE_MACHINE.worldViewProjectionMatrix), &(PR_STATE_MACHINE.viewport), &texCoordTransform ) )
     {
-        // Fetch indices
-        PRushort indexA = indexBuffer->indices[i];
-        PRushort indexB = indexBuffer->indices[i + 1];
-        PRushort indexC = indexBuffer->indices[i + 2];
+        PR_SET_ERROR_FATAL("element in index buffer out of bounds");
+        return;
+    }
 
-        #ifdef PR_DEBUG
-        if (indexA >= vertexBuffer->numVertices || indexB >= vertexBuffer->numVertices || indexC >= vertexBuffer->numVertices)
-        {
-            PR_SET_ERROR_FATAL("element in index buffer out of bounds");
-            return;
-        }
-        #endif
+    const PRuint* indices = vertexCache->indices;
 
-        // Fetch vertices
-        const pr_vertex* vertexA = (vertexBuffer->vertices + indexA);
-        const pr_vertex* vertexB = (vertexBuffer->vertices + indexB);
-        const pr_vertex* vertexC = (vertexBuffer->vertices + indexC);
+    // Iterate over all triangles with the transformed vertices
+    const PRsizei numTriangles = _num_triangles(primitives, numVertices);
+    PRsizei offsets[3];
 
-        // Setup polygon
-        _transform_vertex(&(_clipVertices[0]), vertexA);
-        _transform_vertex(&(_clipVertices[1]), vertexB);
-        _transform_vertex(&(_clipVertices[2]), vertexC);
+    for (PRsizei i = 0; i < numTriangles; ++i)
+    {
+        _triangle_vertex_offsets(primitives, i, offsets);
 
-        if (_clip_and_project_polygon(3) != PR_FALSE)
+        // Setup polygon
+        if (_setup_cached_triangle(context, indices[offsets[0]], indices[offsets[1]], indices[offsets[2]]) != PR_FALSE)
         {
             // Rasterize active polygon
-            _rasterize_polygon(frameBuffer, texture, _compute_polygon_miplevel(texture));
+            _rasterize_polygon(context, frameBuffer, texture, _compute_polygon_miplevel(context, texture));
         }
     }
+
+    _end_draw_call();
 }
 
-void _pr_render_indexed_triangles(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
+static void _draw_indexed_triangles(
+    PRenum primitives, PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
 {
     if (PR_STATE_MACHINE.boundFrameBuffer == NULL)
     {
@@ -1127,22 +2240,103 @@ void _pr_render_indexed_triangles(PRsizei numVertices, PRsizei firstVertex, cons
         return;
     }
 
-    if (PR_STATE_MACHINE.boundTexture == NULL)
+    pr_texture* texture = _bound_texture();
+    if (texture == NULL)
     {
         _pr_texture_singular_color(&PR_SINGULAR_TEXTURE, PR_STATE_MACHINE.color0);
-        _render_indexed_triangles(&PR_SINGULAR_TEXTURE, numVertices, firstVertex, vertexBuffer, indexBuffer);
+        _render_indexed_triangles(&(PR_RASTER_CONTEXT), &PR_SINGULAR_TEXTURE, primitives, numVertices, firstVertex, vertexBuffer, indexBuffer);
     }
     else
-        _render_indexed_triangles(PR_STATE_MACHINE.boundTexture, numVertices, firstVertex, vertexBuffer, indexBuffer);
+        _render_indexed_triangles(&(PR_RASTER_CONTEXT), texture, primitives, numVertices, firstVertex, vertexBuffer, indexBuffer);
+}
+
+void _pr_render_indexed_triangles(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
+{
+    _draw_indexed_triangles(PR_TRIANGLES, numVertices, firstVertex, vertexBuffer, indexBuffer);
 }
 
 void _pr_render_indexed_triangle_strip(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
 {
-    //...
+    _draw_indexed_triangles(PR_TRIANGLE_STRIP, numVertices, firstVertex, vertexBuffer, indexBuffer);
 }
 
 void _pr_render_indexed_triangle_fan(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
 {
-    //...
+    _draw_indexed_triangles(PR_TRIANGLE_FAN, numVertices, firstVertex, vertexBuffer, indexBuffer);
 }
 
+// --- common --- //
+
+void _pr_render_primitives(PRenum primitives, PRsizei numVertices, PRsizei firstVertex, pr_vertexbuffer* vertexBuffer)
+{
+    switch (primitives)
+    {
+        case PR_POINTS:
+            _pr_render_points(numVertices, firstVertex, vertexBuffer);
+            break;
+
+        case PR_LINES:
+            _pr_render_lines(numVertices, firstVertex, vertexBuffer);
+            break;
+        case PR_LINE_STRIP:
+            _pr_render_line_strip(numVertices, firstVertex, vertexBuffer);
+            break;
+        case PR_LINE_LOOP:
+            _pr_render_line_loop(numVertices, firstVertex, vertexBuffer);
+            break;
+
+        case PR_TRIANGLES:
+            _pr_render_triangles(numVertices, firstVertex, vertexBuffer);
+            break;
+        case PR_TRIANGLE_STRIP:
+            _pr_render_triangle_strip(numVertices, firstVertex, vertexBuffer);
+            break;
+        case PR_TRIANGLE_FAN:
+            _pr_render_triangle_fan(numVertices, firstVertex, vertexBuffer);
+            break;
+
+        default:
+            PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
+            break;
+    }
+}
+
+void _pr_render_indexed_primitives(
+    PRenum primitives, PRsizei numVertices, PRsizei firstVertex, pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer)
+{
+    switch (primitives)
+    {
+        case PR_POINTS:
+            _pr_render_indexed_points(numVertices, firstVertex, vertexBuffer, indexBuffer);
+            break;
+
+        case PR_LINES:
+            _pr_render_indexed_lines(numVertices, firstVertex, vertexBuffer, indexBuffer);
+            break;
+        case PR_LINE_STRIP:
+            _pr_render_indexed_line_strip(numVertices, firstVertex, vertexBuffer, indexBuffer);
+            break;
+        case PR_LINE_LOOP:
+            _pr_render_indexed_line_loop(numVertices, firstVertex, vertexBuffer, indexBuffer);
+            break;
+
+        case PR_TRIANGLES:
+            _pr_render_indexed_triangles(numVertices, firstVertex, vertexBuffer, indexBuffer);
+            break;
+        case PR_TRIANGLE_STRIP:
+            _pr_render_indexed_triangle_strip(numVertices, firstVertex, vertexBuffer, indexBuffer);
+            break;
+        case PR_TRIANGLE_FAN:
+            _pr_render_indexed_triangle_fan(numVertices, firstVertex, vertexBuffer, indexBuffer);
+            break;
+
+        default:
+            PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
+            break;
+    }
+}
+
+void _pr_render_flush()
+{
+    _flush_binned_polygons();
+}
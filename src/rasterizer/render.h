@@ -18,7 +18,7 @@
 
 void _pr_render_screenspace_point(PRint x, PRint y);
 
-void _pr_render_points(PRsizei numVertices, PRsizei firstVertex, /*const */pr_vertexbuffer* vertexBuffer);
+void _pr_render_points(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer);
 
 void _pr_render_indexed_points(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer);
 
@@ -48,5 +48,18 @@ void _pr_render_indexed_triangles(PRsizei numVertices, PRsizei firstVertex, cons
 void _pr_render_indexed_triangle_strip(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer);
 void _pr_render_indexed_triangle_fan(PRsizei numVertices, PRsizei firstVertex, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer);
 
+// --- common --- //
+
+//! Renders the specified primitives (PR_POINTS, PR_LINES, ..., PR_TRIANGLE_FAN) from the vertex buffer.
+void _pr_render_primitives(PRenum primitives, PRsizei numVertices, PRsizei firstVertex, pr_vertexbuffer* vertexBuffer);
+
+//! Renders the specified primitives (PR_POINTS, PR_LINES, ..., PR_TRIANGLE_FAN) from the vertex- and index buffer.
+void _pr_render_indexed_primitives(
+    PRenum primitives, PRsizei numVertices, PRsizei firstVertex, pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer
+);
+
+//! Rasterizes all polygons which are still pending in the tile binner (see 'batchDrawCalls' in the state machine).
+void _pr_render_flush();
+
 
 #endif
@@ -13,7 +13,7 @@
 
 
 static pr_state_machine _nullStateMachine;
-pr_state_machine* _stateMachine = &_nullStateMachine;
+PR_THREAD_LOCAL pr_state_machine* _stateMachine = &_nullStateMachine;
 
 
 static void _state_machine_cliprect(PRint left, PRint top, PRint right, PRint bottom)
@@ -118,16 +118,40 @@ void _pr_state_machine_init(pr_state_machine* stateMachine)
     stateMachine->boundIndexBuffer          = NULL;
     stateMachine->boundTexture              = NULL;
 
+    stateMachine->textureRegion.x           = 0;
+    stateMachine->textureRegion.y           = 0;
+    stateMachine->textureRegion.width       = 0;
+    stateMachine->textureRegion.height      = 0;
+
     stateMachine->clearColor                = _pr_color_to_colorindex(0, 0, 0);
     stateMachine->color0                    = _pr_color_to_colorindex(0, 0, 0);
     stateMachine->textureLodBias            = 0;
     stateMachine->cullMode                  = PR_CULL_NONE;
     stateMachine->polygonMode               = PR_POLYGON_FILL;
 
-    stateMachine->states[PR_SCISSOR]        = PR_FALSE;
-    stateMachine->states[PR_MIP_MAPPING]    = PR_FALSE;
+    stateMachine->states[PR_SCISSOR]                = PR_FALSE;
+    stateMachine->states[PR_MIP_MAPPING]            = PR_FALSE;
+    stateMachine->states[PR_TILE_BINNING]           = PR_FALSE;
+    stateMachine->states[PR_HALF_SPACE_RASTERIZER]  = PR_FALSE;
+    stateMachine->states[PR_FAST_CLEAR]             = PR_FALSE;
+    stateMachine->states[PR_GUARD_BAND]             = PR_FALSE;
+    stateMachine->states[PR_TEXTURE_TILING]         = PR_FALSE;
 
     stateMachine->refCounter                = 0;
+
+    stateMachine->recordCommandBuffer       = NULL;
+    stateMachine->batchDrawCalls            = PR_FALSE;
+
+    // Initialize immediate mode
+    _pr_vertexbuffer_singular_init(&(stateMachine->immModeVertexBuffer), PR_NUM_IMMEDIATE_VERTICES);
+    stateMachine->immModeActive             = PR_FALSE;
+    stateMachine->immModeVertCounter        = 0;
+    stateMachine->immModePrimitives         = PR_POINTS;
+    stateMachine->immModeLoopSplit          = PR_FALSE;
+
+    _pr_texture_singular_init(&(stateMachine->singularTexture));
+    _pr_raster_context_init(&(stateMachine->rasterContext));
+    _pr_tile_binner_init(&(stateMachine->tileBinner));
 }
 
 void _pr_state_machine_init_null()
@@ -135,6 +159,19 @@ void _pr_state_machine_init_null()
     _pr_state_machine_init(&_nullStateMachine);
 }
 
+void _pr_state_machine_release(pr_state_machine* stateMachine)
+{
+    _pr_vertexbuffer_singular_clear(&(stateMachine->immModeVertexBuffer));
+    _pr_texture_singular_clear(&(stateMachine->singularTexture));
+    _pr_raster_context_release(&(stateMachine->rasterContext));
+    _pr_tile_binner_release(&(stateMachine->tileBinner));
+}
+
+void _pr_state_machine_release_null()
+{
+    _pr_state_machine_release(&_nullStateMachine);
+}
+
 void _pr_state_machine_makecurrent(pr_state_machine* stateMachine)
 {
     if (stateMachine != NULL)
@@ -222,6 +259,20 @@ void _pr_state_machine_bind_texture(pr_texture* texture)
     PR_STATE_MACHINE.boundTexture = texture;
 }
 
+void _pr_state_machine_texture_region(PRint x, PRint y, PRint width, PRint height)
+{
+    if (x < 0 || y < 0 || width < 0 || height < 0 || x + width > PR_MAX_TEX_SIZE || y + height > PR_MAX_TEX_SIZE)
+    {
+        PR_ERROR(PR_ERROR_INVALID_ARGUMENT);
+        return;
+    }
+
+    PR_STATE_MACHINE.textureRegion.x        = (PRtexsize)x;
+    PR_STATE_MACHINE.textureRegion.y        = (PRtexsize)y;
+    PR_STATE_MACHINE.textureRegion.width    = (PRtexsize)width;
+    PR_STATE_MACHINE.textureRegion.height   = (PRtexsize)height;
+}
+
 void _pr_state_machine_viewport(PRint x, PRint y, PRint width, PRint height)
 {
     if (PR_STATE_MACHINE.boundFrameBuffer == NULL)
@@ -237,7 +288,8 @@ void _pr_state_machine_viewport(PRint x, PRint y, PRint width, PRint height)
     PR_STATE_MACHINE.viewport.x = (PRfloat)x;
 
     #ifdef PR_ORIGIN_LEFT_TOP
-    PR_STATE_MACHINE.viewport.y = (PRfloat)(PR_STATE_MACHINE.boundFrameBuffer->height - 1 - y);
+    // Pixel edge of the flipped viewport origin (pixel centers are moved to integral coordinates in '_project_vertex')
+    PR_STATE_MACHINE.viewport.y = (PRfloat)(PR_STATE_MACHINE.boundFrameBuffer->height - y);
     #else
     PR_STATE_MACHINE.viewport.y = (PRfloat)y;
     #endif
@@ -16,11 +16,20 @@
 #include "vertexbuffer.h"
 #include "indexbuffer.h"
 #include "texture.h"
+#include "tile_binner.h"
+#include "raster_context.h"
+#include "command_buffer.h"
 #include "enums.h"
+#include "static_config.h"
 
 
 #define PR_STATE_MACHINE    (*_stateMachine)
-#define PR_NUM_STATES       2
+#define PR_RASTER_CONTEXT   PR_STATE_MACHINE.rasterContext
+#define PR_SINGULAR_TEXTURE PR_STATE_MACHINE.singularTexture
+#define PR_NUM_STATES       7
+
+// Number of vertices for the vertex buffer of the immediate draw mode (prBegin/prEnd)
+#define PR_NUM_IMMEDIATE_VERTICES   32
 
 
 typedef struct pr_state_machine
@@ -43,6 +52,8 @@ typedef struct pr_state_machine
     pr_indexbuffer*     boundIndexBuffer;
     pr_texture*         boundTexture;
 
+    pr_texture_region   textureRegion;          // Region of the bound texture for the next draw calls
+
     PRcolorindex        clearColor;
     PRcolorindex        color0;                 // Active color index
     PRubyte             textureLodBias;
@@ -53,12 +64,31 @@ typedef struct pr_state_machine
     PRboolean           states[PR_NUM_STATES];
 
     PRsizei             refCounter;                 // Object reference counter
+
+    // Command buffers
+    pr_command_buffer*  recordCommandBuffer;        // Command buffer which is currently recorded (or null)
+    PRboolean           batchDrawCalls;             // Keeps binned polygons across draw calls (see '_pr_render_flush')
+
+    // Immediate mode
+    pr_vertexbuffer     immModeVertexBuffer;
+    PRboolean           immModeActive;
+    PRsizei             immModeVertCounter;
+    PRenum              immModePrimitives;
+    PRboolean           immModeLoopSplit;           // Line loop has been flushed before; its first vertex is kept at index 0
+
+    // Scratch state of the geometry pipeline and the tile binning rasterizer
+    pr_texture          singularTexture;            // Texture with single color (for untextured drawing)
+    pr_raster_context   rasterContext;
+    pr_tile_binner      tileBinner;
 }
 pr_state_machine;
 
 
-//! Reference to the state machine of the current context.
-extern pr_state_machine* _stateMachine;
+/**
+Reference to the state machine of the current context.
+This is thread-local if PR_THREAD_LOCAL_CONTEXT is defined, so each thread can have its own current context.
+*/
+extern PR_THREAD_LOCAL pr_state_machine* _stateMachine;
 
 
 void _pr_ref_add(PRobject obj);
@@ -67,6 +97,8 @@ void _pr_ref_assert(pr_state_machine* stateMachine);
 
 void _pr_state_machine_init(pr_state_machine* stateMachine);
 void _pr_state_machine_init_null();
+void _pr_state_machine_release(pr_state_machine* stateMachine);
+void _pr_state_machine_release_null();
 
 void _pr_state_machine_makecurrent(pr_state_machine* stateMachine);
 
@@ -81,6 +113,8 @@ void _pr_state_machine_bind_vertexbuffer(pr_vertexbuffer* vertexBuffer);
 void _pr_state_machine_bind_indexbuffer(pr_indexbuffer* indexBuffer);
 void _pr_state_machine_bind_texture(pr_texture* texture);
 
+void _pr_state_machine_texture_region(PRint x, PRint y, PRint width, PRint height);
+
 void _pr_state_machine_viewport(PRint x, PRint y, PRint width, PRint height);
 void _pr_state_machine_depth_range(PRfloat minDepth, PRfloat maxDepth);
 void _pr_state_machine_scissor(PRint x, PRint y, PRint width, PRint height);
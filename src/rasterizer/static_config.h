@@ -45,12 +45,41 @@
 //! Use a 24-bit color buffer (instead of 8 bit)
 //#define PR_COLOR_BUFFER_24BIT
 
-//! Merge color- and depth buffers to a single one inside a frame buffer.
-#define PR_MERGE_COLOR_AND_DEPTH_BUFFERS //!CAN NOT BE DISABLED YET!
+//! Merge color- and depth buffers to a single one inside a frame buffer (instead of separate color and depth planes).
+//#define PR_MERGE_COLOR_AND_DEPTH_BUFFERS
 
 //! Makes all pixels with color black a transparent pixel.
 #define PR_BLACK_IS_ALPHA
 
+//! Enables worker threads for the tile binning rasterizer (see PR_TILE_BINNING state).
+#define PR_MULTI_THREADING
+
+//! Maximal number of worker threads (the calling thread is not included).
+#define PR_MAX_NUM_WORKER_THREADS   16
+
+//! Makes the current context and the error state thread-local, so that several threads can render with their own context.
+#define PR_THREAD_LOCAL_CONTEXT
+
+//! Size (in pixels) of the guard band around the clipping rectangle (see PR_GUARD_BAND state).
+#define PR_GUARD_BAND_SIZE          1024
+
+//! Enables SSE2 kernels for batched vertex processing and MIP-map generation (if supported by the target platform).
+#define PR_SIMD
+
+#if defined(PR_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+//! Specifies that the SSE2 kernels are used.
+#   define PR_SSE2_KERNELS
+#endif
+
+//! Stores vertex coordinates and texture-coordinates as 16-bit floats (12 instead of 24 bytes per vertex).
+//#define PR_PACKED_VERTICES
+
+//! Width and height (in pixels) of the screen tiles for the tile binning rasterizer.
+#define PR_TILE_SIZE                64
+
+//! Width and height (in pixels) of the pixel blocks for the half-space rasterizer. Must be a divisor of PR_TILE_SIZE.
+#define PR_BLOCK_SIZE               8
+
 
 #ifdef PR_INTERP_64BIT
 //! 64-bit interpolation type.
@@ -62,5 +91,16 @@ typedef float PRinterp;
 #define PR_FLOAT(x) x##f
 #endif
 
+#ifdef PR_THREAD_LOCAL_CONTEXT
+//! Storage class for variables which are thread-local in the multi-context mode.
+#   ifdef _MSC_VER
+#       define PR_THREAD_LOCAL __declspec(thread)
+#   else
+#       define PR_THREAD_LOCAL __thread
+#   endif
+#else
+#   define PR_THREAD_LOCAL
+#endif
+
 
 #endif
@@ -6,22 +6,147 @@
  */
 
 #include "texture.h"
+#include "texture_loader.h"
 #include "ext_math.h"
 #include "error.h"
 #include "helper.h"
 #include "image.h"
 #include "state_machine.h"
+#include "global_state.h"
+#include "color_palette.h"
 #include "enums.h"
 
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef PR_SSE2_KERNELS
+#   include <emmintrin.h>
+#endif
+
+
+// Number of rows of a MIP level which are filtered and converted by a single task of the MIP builder
+#define _MIP_ROWS_PER_TASK 16
+
+
+/*
+State of the MIP builder for a single MIP level. Each level is box-filtered from the previous level
+into a scratch buffer with four components per texel (RGBX), so that two texels fit into 64 bits.
+*/
+typedef struct pr_mip_builder
+{
+    pr_texture_level    level;          //!< Destination MIP level.
+    const PRubyte*      src;            //!< Colors of the source level, or the RGB image data for the first MIP level.
+    PRtexsize           srcWidth;
+    PRtexsize           srcHeight;
+    PRubyte*            dst;            //!< RGBX colors of the destination level.
+    PRboolean           convert;        //!< Specifies whether the tasks also convert the colors into the texel format (without dithering).
+    const PRubyte*      paletteLUT;     //!< Palette entries for each 8-bit color index (only for the PR_TEXTURE_FORMAT_PALETTE4 format).
+}
+pr_mip_builder;
+
 
 // --- internals --- //
 
-static void _texture_subimage2d(
-    PRcolorindex* texels, PRubyte mip, PRtexsize width, PRtexsize height, PRenum format, const PRvoid* data, PRboolean dither)
+// Returns the pitch of a MIP level with the specified width (see pr_texture_level).
+static PRuint _texture_pitch(PRtexsize width, PRubyte format, PRboolean tiled)
+{
+    switch (format)
+    {
+        case PR_TEXTURE_FORMAT_PALETTE4:
+            return ((PRuint)width + 1) / 2;
+        case PR_TEXTURE_FORMAT_BLOCK:
+            return ((PRuint)width + PR_TEXTURE_BLOCK_MASK) >> PR_TEXTURE_BLOCK_SHIFT;
+    }
+    if (tiled != PR_FALSE)
+        return (((PRuint)width + PR_TEXTURE_TILE_MASK) >> PR_TEXTURE_TILE_SHIFT) << (PR_TEXTURE_TILE_SHIFT*2);
+    return (PRuint)width;
+}
+
+// Returns the size (in bytes) of a MIP level with the specified size (tiled MIP levels are padded to whole tiles).
+static size_t _texture_level_size(PRtexsize width, PRtexsize height, PRubyte format, PRboolean tiled)
+{
+    const size_t pitch = _texture_pitch(width, format, tiled);
+
+    switch (format)
+    {
+        case PR_TEXTURE_FORMAT_PALETTE4:
+            return pitch * height;
+        case PR_TEXTURE_FORMAT_BLOCK:
+            return pitch * (((PRuint)height + PR_TEXTURE_BLOCK_MASK) >> PR_TEXTURE_BLOCK_SHIFT) * sizeof(pr_texture_block);
+    }
+    if (tiled != PR_FALSE)
+        return pitch * (((PRuint)height + PR_TEXTURE_TILE_MASK) >> PR_TEXTURE_TILE_SHIFT) * sizeof(PRcolorindex);
+    return pitch * height * sizeof(PRcolorindex);
+}
+
+// Sets up the descriptor of the specified MIP level, whose texels start at the specified offset and are stored in the specified format.
+static void _texture_setup_level(pr_texture* texture, PRubyte mip, PRubyte format, const PRcolorindex* texels)
+{
+    pr_texture_level* level = &(texture->levels[mip]);
+
+    level->texels           = texels;
+    level->palette          = texture->palette;
+    level->virtualTexture   = texture->virtualTexture;
+    level->width            = PR_MAX(1, PR_MIP_SIZE(texture->width, mip));
+    level->height           = PR_MAX(1, PR_MIP_SIZE(texture->height, mip));
+    level->pitch            = _texture_pitch(level->width, format, texture->tiled);
+    level->format           = format;
+    level->tiled            = texture->tiled;
+    level->pot              = texture->pot;
+    level->mip              = mip;
+
+    if (texture->pot != PR_FALSE)
+    {
+        level->log2Width    = (PRubyte)PR_MAX(0, (PRint)texture->log2Width - (PRint)mip);
+        level->log2Height   = (PRubyte)PR_MAX(0, (PRint)texture->log2Height - (PRint)mip);
+    }
+    else
+    {
+        level->log2Width    = 0;
+        level->log2Height   = 0;
+    }
+}
+
+// Returns the base 2 logarithm of the specified size, or -1 if the size is not a power of two.
+static PRint _texture_log2(PRtexsize size)
+{
+    PRint log2 = 0;
+
+    if (size <= 0 || (size & (size - 1)) != 0)
+        return -1;
+
+    while ((1 << log2) < size)
+        ++log2;
+
+    return log2;
+}
+
+// Copies a row of color indices into the specified MIP level piece by piece, each piece is contiguous inside a row or inside a row of a tile.
+static void _texture_store_row(const pr_texture_level* level, PRtexsize x, PRtexsize y, PRtexsize width, const PRcolorindex* src)
+{
+    PRcolorindex* dst = (PRcolorindex*)level->texels;
+
+    for (PRtexsize i = 0; i < width;)
+    {
+        PRtexsize run = width - i;
+        if (level->tiled != PR_FALSE)
+            PR_CLAMP_SMALLEST(run, PR_TEXTURE_TILE_SIZE - ((x + i) & PR_TEXTURE_TILE_MASK));
+
+        memcpy(
+            dst + _pr_texture_texel_offset(level, (PRuint)(x + i), (PRuint)y),
+            src + i,
+            sizeof(PRcolorindex)*run
+        );
+
+        i += run;
+    }
+}
+
+// Writes the specified image data into the rectangle [x, x + width) x [y, y + height) of the specified MIP level.
+static void _texture_subimage2d_rect(
+    pr_texture* texture, PRubyte mip, PRtexsize x, PRtexsize y, PRtexsize width, PRtexsize height,
+    PRenum format, const PRvoid* data, PRboolean dither)
 {
     if (format != PR_UBYTE_RGB)
     {
@@ -29,6 +154,10 @@ static void _texture_subimage2d(
         return;
     }
 
+    const pr_texture_level level = texture->levels[mip];
+
+    PRcolorindex* dst = (PRcolorindex*)level.texels;
+
     // Setup structure for sub-image
     pr_image subimage;
     subimage.width      = width;
@@ -37,102 +166,463 @@ static void _texture_subimage2d(
     subimage.defFree    = PR_TRUE;
     subimage.colors     = (PRubyte*)data;
 
-    _pr_image_color_to_colorindex(texels, &subimage, dither);
+    if (level.tiled == PR_FALSE && x == 0 && width == level.width)
+    {
+        // Convert whole rows directly into the texels
+        _pr_image_color_to_colorindex(dst + y*level.pitch, &subimage, dither);
+        return;
+    }
+
+    // Convert image into temporary buffer
+    PRcolorindex* colors = PR_CALLOC(PRcolorindex, (size_t)width*height);
+    _pr_image_color_to_colorindex(colors, &subimage, dither);
+
+    for (PRtexsize j = 0; j < height; ++j)
+        _texture_store_row(&level, x, y + j, width, colors + j*width);
+
+    PR_FREE(colors);
 }
 
-static void _texture_subimage2d_rect(
-    pr_texture* texture, PRubyte mip, PRtexsize x, PRtexsize y, PRtexsize width, PRtexsize height, PRenum format, const PRvoid* data)
+// Averages 2x2 blocks of RGBX texels of the rows 'row0' and 'row1' into 'width' texels.
+static void _mip_filter_row_box4(PRubyte* dst, const PRubyte* row0, const PRubyte* row1, PRtexsize width)
 {
-    //...
+    PRtexsize x = 0;
+
+    #ifdef PR_SSE2_KERNELS
+
+    const __m128i zero = _mm_setzero_si128();
+
+    // Filter two destination texels at a time
+    for (; x + 2 <= width; x += 2)
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(row0 + x*8));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(row1 + x*8));
+
+        // Sum up both rows with 16-bit components (texels 0 and 1 in 'lo', texels 2 and 3 in 'hi')
+        const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+        // Sum up neighbor texels and divide by 4
+        __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+        sum = _mm_srli_epi16(sum, 2);
+
+        _mm_storel_epi64((__m128i*)(dst + x*4), _mm_packus_epi16(sum, sum));
+    }
+
+    #endif
+
+    for (; x < width; ++x)
+    {
+        for (PRint i = 0; i < 4; ++i)
+        {
+            dst[x*4 + i] = (PRubyte)((
+                (PRint)row0[x*8 + i] + (PRint)row0[x*8 + 4 + i] +
+                (PRint)row1[x*8 + i] + (PRint)row1[x*8 + 4 + i]
+            ) >> 2);
+        }
+    }
 }
 
-static PRubyte _color_box4_blur(PRubyte a, PRubyte b, PRubyte c, PRubyte d)
+// Fills the specified row of the destination level of the MIP builder.
+static void _mip_builder_filter_row(const pr_mip_builder* builder, PRtexsize y)
 {
-    PRint x;
-    x  = a;
-    x += b;
-    x += c;
-    x += d;
-    return (PRubyte)(x / 4);
+    PRubyte* dst = builder->dst + (size_t)y*builder->level.width*4;
+
+    if (builder->srcHeight == builder->level.height)
+    {
+        if (builder->srcWidth == builder->level.width)
+        {
+            // Expand RGB image data of the first MIP level to RGBX
+            const PRubyte* src = builder->src + (size_t)y*builder->srcWidth*3;
+
+            for (PRtexsize x = 0; x < builder->level.width; ++x)
+            {
+                dst[x*4    ] = src[x*3    ];
+                dst[x*4 + 1] = src[x*3 + 1];
+                dst[x*4 + 2] = src[x*3 + 2];
+                dst[x*4 + 3] = 0;
+            }
+            return;
+        }
+
+        // Source has only a single row: averaging this row twice is equal to the 2x1 box filter
+        _mip_filter_row_box4(dst, builder->src, builder->src, builder->level.width);
+        return;
+    }
+
+    const PRubyte* row0 = builder->src + (size_t)(y*2)*builder->srcWidth*4;
+    const PRubyte* row1 = row0 + builder->srcWidth*4;
+
+    if (builder->srcWidth > 1)
+        _mip_filter_row_box4(dst, row0, row1, builder->level.width);
+    else
+    {
+        // Source has only a single column: 1x2 box filter
+        for (PRint i = 0; i < 4; ++i)
+            dst[i] = (PRubyte)(((PRint)row0[i] + (PRint)row1[i]) >> 1);
+    }
 }
 
-static PRubyte _color_box2_blur(PRubyte a, PRubyte b)
+// Converts a row of RGBX colors into color indices (without dithering).
+static void _mip_convert_row(PRcolorindex* dst, const PRubyte* src, PRtexsize width)
 {
-    PRint x;
-    x  = a;
-    x += b;
-    return (PRubyte)(x / 2);
+    PRtexsize x = 0;
+
+    #if defined(PR_SSE2_KERNELS) && !defined(PR_COLOR_BUFFER_24BIT)
+
+    // Convert 16 texels at a time, each RGBX texel is a 32-bit integer: index = (r & 0xe0) | ((g >> 3) & 0x1c) | (b >> 6)
+    const __m128i maskRed   = _mm_set1_epi32(0xe0);
+    const __m128i maskGreen = _mm_set1_epi32(0x1c);
+    const __m128i maskBlue  = _mm_set1_epi32(0x03);
+
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i indices[4];
+
+        for (PRint i = 0; i < 4; ++i)
+        {
+            const __m128i texels = _mm_loadu_si128((const __m128i*)(src + (x + i*4)*4));
+            indices[i] = _mm_or_si128(
+                _mm_or_si128(
+                    _mm_and_si128(texels, maskRed),
+                    _mm_and_si128(_mm_srli_epi32(texels, 11), maskGreen)
+                ),
+                _mm_and_si128(_mm_srli_epi32(texels, 22), maskBlue)
+            );
+        }
+
+        _mm_storeu_si128(
+            (__m128i*)(dst + x),
+            _mm_packus_epi16(_mm_packs_epi32(indices[0], indices[1]), _mm_packs_epi32(indices[2], indices[3]))
+        );
+    }
+
+    #endif
+
+    for (; x < width; ++x)
+        dst[x] = _pr_color_to_colorindex(src[x*4], src[x*4 + 1], src[x*4 + 2]);
+}
+
+// Returns the 8-bit color index (3 bits red, 3 bits green, 2 bits blue) of the specified color, which is used to look up palette entries.
+PR_INLINE PRubyte _texture_palette_bin(PRubyte r, PRubyte g, PRubyte b)
+{
+    return (PRubyte)((r & 0xe0) | ((g >> 3) & 0x1c) | (b >> 6));
 }
 
-static PRubyte* _image_scale_down_ubyte_rgb(PRtexsize width, PRtexsize height, const PRubyte* data)
+// Converts a row of RGBX colors into 4-bit palette indices (two texels per byte, the low nibble is the left texel).
+static void _mip_convert_row_palette4(PRubyte* dst, const PRubyte* src, PRtexsize width, const PRubyte* paletteLUT)
 {
-    #define COLOR(x, y, i) data[((y)*width + (x))*3 + (i)]
+    for (PRtexsize x = 0; x < width; ++x, src += 4)
+    {
+        const PRubyte index = paletteLUT[_texture_palette_bin(src[0], src[1], src[2])];
 
-    const PRtexsize scaledWidth = (width > 1 ? width/2 : 1);
-    const PRtexsize scaledHeight = (height > 1 ? height/2 : 1);
+        if ((x & 1) == 0)
+            dst[x/2] = index;
+        else
+            dst[x/2] |= (PRubyte)(index << 4);
+    }
+}
 
-    PRubyte* scaled = PR_CALLOC(PRubyte, scaledWidth*scaledHeight*3);
+/*
+Encodes a block of up to 4x4 RGBX colors (a block truncation coding): texels which are brighter than
+the average luminance of the block get the average color of all brighter texels, the others get the average
+color of the remaining texels. 'stride' specifies the number of texels per row of the source colors.
+*/
+static void _mip_encode_block(pr_texture_block* block, const PRubyte* src, PRtexsize stride, PRtexsize width, PRtexsize height)
+{
+    PRint luminance[PR_TEXTURE_BLOCK_SIZE*PR_TEXTURE_BLOCK_SIZE];
+    PRint luminanceSum = 0;
+    const PRint numTexels = width*height;
 
-    if (width > 1 && height > 1)
+    // Compute luminance of each texel
+    for (PRtexsize y = 0; y < height; ++y)
     {
-        for (PRtexsize y = 0; y < scaledHeight; ++y)
+        for (PRtexsize x = 0; x < width; ++x)
         {
-            for (PRtexsize x = 0; x < scaledWidth; ++x)
-            {
-                for (PRint i = 0; i < 3; ++i)
-                {
-                    scaled[(y*scaledWidth + x)*3 + i] = _color_box4_blur(
-                        COLOR(x*2    , y*2    , i),
-                        COLOR(x*2 + 1, y*2    , i),
-                        COLOR(x*2 + 1, y*2 + 1, i),
-                        COLOR(x*2    , y*2 + 1, i)
-                    );
-                }
-            }
+            const PRubyte* color = src + (y*stride + x)*4;
+            const PRint lum = (PRint)color[0]*77 + (PRint)color[1]*150 + (PRint)color[2]*29;
+
+            luminance[(y << PR_TEXTURE_BLOCK_SHIFT) + x] = lum;
+            luminanceSum += lum;
         }
     }
-    else if (width > 1)
+
+    // Split texels at the average luminance and accumulate the colors of both groups
+    PRint colorSum[2][3] = { { 0, 0, 0 }, { 0, 0, 0 } };
+    PRint count[2] = { 0, 0 };
+
+    block->mask = 0;
+
+    for (PRtexsize y = 0; y < height; ++y)
     {
-        for (PRtexsize x = 0; x < scaledWidth; ++x)
+        for (PRtexsize x = 0; x < width; ++x)
         {
-            for (PRint i = 0; i < 3; ++i)
+            const PRubyte* color = src + (y*stride + x)*4;
+            const PRint bit = (y << PR_TEXTURE_BLOCK_SHIFT) + x;
+            const PRint group = (luminance[bit]*numTexels > luminanceSum ? 1 : 0);
+
+            if (group != 0)
+                block->mask |= (PRushort)(1 << bit);
+
+            colorSum[group][0] += color[0];
+            colorSum[group][1] += color[1];
+            colorSum[group][2] += color[2];
+            ++count[group];
+        }
+    }
+
+    // Store average colors (an empty group gets the color of the other group)
+    for (PRint i = 0; i < 2; ++i)
+    {
+        const PRint j = (count[i] > 0 ? i : 1 - i);
+        block->colors[i] = _pr_color_to_colorindex(
+            (PRubyte)(colorSum[j][0] / count[j]),
+            (PRubyte)(colorSum[j][1] / count[j]),
+            (PRubyte)(colorSum[j][2] / count[j])
+        );
+    }
+}
+
+// Converts the specified row of the destination level of the MIP builder into the texel format.
+static void _mip_builder_convert_row(const pr_mip_builder* builder, PRtexsize y)
+{
+    const pr_texture_level* level = &(builder->level);
+    const PRubyte* src = builder->dst + (size_t)y*level->width*4;
+
+    if (level->format == PR_TEXTURE_FORMAT_PALETTE4)
+        _mip_convert_row_palette4((PRubyte*)level->texels + y*level->pitch, src, level->width, builder->paletteLUT);
+    else if (level->tiled == PR_FALSE)
+    {
+        // Convert row directly into the texels
+        _mip_convert_row((PRcolorindex*)level->texels + y*level->pitch, src, level->width);
+    }
+    else
+    {
+        PRcolorindex colors[PR_MAX_TEX_SIZE];
+        _mip_convert_row(colors, src, level->width);
+        _texture_store_row(level, 0, y, level->width, colors);
+    }
+}
+
+// Encodes all blocks of the rows [yStart, yEnd) of the destination level of the MIP builder. 'yStart' must be a multiple of the block size.
+static void _mip_builder_encode_blocks(const pr_mip_builder* builder, PRtexsize yStart, PRtexsize yEnd)
+{
+    const pr_texture_level* level = &(builder->level);
+
+    for (PRtexsize y = yStart; y < yEnd; y += PR_TEXTURE_BLOCK_SIZE)
+    {
+        pr_texture_block* block = (pr_texture_block*)level->texels + (y >> PR_TEXTURE_BLOCK_SHIFT)*level->pitch;
+        const PRtexsize height = PR_MIN(PR_TEXTURE_BLOCK_SIZE, yEnd - y);
+
+        for (PRtexsize x = 0; x < level->width; x += PR_TEXTURE_BLOCK_SIZE, ++block)
+        {
+            _mip_encode_block(
+                block,
+                builder->dst + ((size_t)y*level->width + x)*4,
+                level->width,
+                PR_MIN(PR_TEXTURE_BLOCK_SIZE, level->width - x),
+                height
+            );
+        }
+    }
+}
+
+static void _mip_builder_task(PRuint task, PRuint worker, PRvoid* userData)
+{
+    // Rows are written into disjoint parts of the scratch buffer, so no per-worker state is needed
+    PR_UNUSED(worker);
+
+    const pr_mip_builder* builder = (const pr_mip_builder*)userData;
+
+    const PRtexsize yStart = (PRtexsize)(task*_MIP_ROWS_PER_TASK);
+    const PRtexsize yEnd = PR_MIN(yStart + _MIP_ROWS_PER_TASK, builder->level.height);
+
+    for (PRtexsize y = yStart; y < yEnd; ++y)
+    {
+        _mip_builder_filter_row(builder, y);
+
+        if (builder->convert != PR_FALSE && builder->level.format != PR_TEXTURE_FORMAT_BLOCK)
+            _mip_builder_convert_row(builder, y);
+    }
+
+    // Blocks never cross task boundaries, since the number of rows per task is a multiple of the block size
+    if (builder->convert != PR_FALSE && builder->level.format == PR_TEXTURE_FORMAT_BLOCK)
+        _mip_builder_encode_blocks(builder, yStart, yEnd);
+}
+
+/*
+Selects the 16 palette colors for the PR_TEXTURE_FORMAT_PALETTE4 format from the RGB image data of the first MIP level,
+and stores the nearest palette entry for each 8-bit color index into 'paletteLUT'. The palette consists of
+the average colors of the 16 most frequent 8-bit color indices.
+*/
+static void _texture_build_palette(pr_texture* texture, const PRubyte* data, PRubyte* paletteLUT)
+{
+    PRuint counts[256];
+    PRuint sums[256][3];
+    PRint palette[PR_TEXTURE_PALETTE_SIZE][3];
+
+    memset(counts, 0, sizeof(counts));
+    memset(sums, 0, sizeof(sums));
+
+    // Build histogram of 8-bit color indices
+    const size_t numTexels = (size_t)texture->width * texture->height;
+
+    for (size_t i = 0; i < numTexels; ++i, data += 3)
+    {
+        const PRubyte bin = _texture_palette_bin(data[0], data[1], data[2]);
+        ++counts[bin];
+        sums[bin][0] += data[0];
+        sums[bin][1] += data[1];
+        sums[bin][2] += data[2];
+    }
+
+    // Representative color of each bin: the average color, or the bin center for unused bins
+    PRint binColors[256][3];
+
+    for (PRint bin = 0; bin < 256; ++bin)
+    {
+        if (counts[bin] > 0)
+        {
+            binColors[bin][0] = (PRint)(sums[bin][0] / counts[bin]);
+            binColors[bin][1] = (PRint)(sums[bin][1] / counts[bin]);
+            binColors[bin][2] = (PRint)(sums[bin][2] / counts[bin]);
+        }
+        else
+        {
+            binColors[bin][0] = (bin & 0xe0) + 16;
+            binColors[bin][1] = ((bin << 3) & 0xe0) + 16;
+            binColors[bin][2] = ((bin << 6) & 0xc0) + 32;
+        }
+    }
+
+    // Select the most frequent bins (unused palette entries repeat the first entry)
+    PRint numEntries = 0;
+
+    for (; numEntries < PR_TEXTURE_PALETTE_SIZE; ++numEntries)
+    {
+        PRint best = -1;
+
+        for (PRint bin = 0; bin < 256; ++bin)
+        {
+            if (counts[bin] > 0 && (best < 0 || counts[bin] > counts[best]))
+                best = bin;
+        }
+
+        if (best < 0)
+            break;
+
+        palette[numEntries][0] = binColors[best][0];
+        palette[numEntries][1] = binColors[best][1];
+        palette[numEntries][2] = binColors[best][2];
+        counts[best] = 0;
+    }
+
+    for (PRint i = 0; i < PR_TEXTURE_PALETTE_SIZE; ++i)
+    {
+        const PRint* color = palette[i < numEntries ? i : 0];
+        texture->palette[i] = _pr_color_to_colorindex((PRubyte)color[0], (PRubyte)color[1], (PRubyte)color[2]);
+    }
+
+    // Map each bin to its nearest palette entry
+    for (PRint bin = 0; bin < 256; ++bin)
+    {
+        PRint minDistSq = -1;
+
+        for (PRint i = 0; i < numEntries; ++i)
+        {
+            const PRint dr = binColors[bin][0] - palette[i][0];
+            const PRint dg = binColors[bin][1] - palette[i][1];
+            const PRint db = binColors[bin][2] - palette[i][2];
+            const PRint distSq = dr*dr + dg*dg + db*db;
+
+            if (minDistSq < 0 || distSq < minDistSq)
             {
-                scaled[x*3 + i] = _color_box2_blur(
-                    COLOR(x*2    , 0, i),
-                    COLOR(x*2 + 1, 0, i)
-                );
+                minDistSq = distSq;
+                paletteLUT[bin] = (PRubyte)i;
             }
         }
     }
-    else if (height > 1)
+}
+
+/*
+Fills all MIP levels of the specified texture from the RGB image data of the first level.
+Each level is filtered (and converted into the texel format, if dithering is disabled) in parallel across rows with the global thread pool.
+All levels are built inside a single scratch buffer: two alternating RGBX levels, the first one
+is large enough for the first level, the second one is large enough for the second level
+and for the color indices of the first level.
+*/
+static void _texture_build_mips(pr_texture* texture, const PRubyte* data, PRboolean dither)
+{
+    // Texels of the compact formats are never dithered
+    if (texture->format != PR_TEXTURE_FORMAT_INDEX)
+        dither = PR_FALSE;
+
+    PRubyte paletteLUT[256];
+    if (texture->format == PR_TEXTURE_FORMAT_PALETTE4)
+        _texture_build_palette(texture, data, paletteLUT);
+
+    const size_t levelSize = (size_t)texture->width * texture->height;
+    const size_t nextLevelSize = (size_t)PR_MAX(1, texture->width/2) * PR_MAX(1, texture->height/2);
+
+    PRubyte* scratch = PR_CALLOC(PRubyte, levelSize*4 + PR_MAX(nextLevelSize*4, levelSize*sizeof(PRcolorindex)));
+    PRubyte* scratchLevels[2] = { scratch, scratch + levelSize*4 };
+
+    pr_mip_builder builder;
+    builder.src         = data;
+    builder.srcWidth    = texture->width;
+    builder.srcHeight   = texture->height;
+    builder.convert     = !dither;
+    builder.paletteLUT  = paletteLUT;
+
+    for (PRubyte mip = 0; mip < texture->mips; ++mip)
     {
-        for (PRtexsize y = 0; y < scaledHeight; ++y)
+        builder.level   = texture->levels[mip];
+        builder.dst     = scratchLevels[mip % 2];
+
+        // Filter all rows of the current level
+        const PRuint numTasks = ((PRuint)builder.level.height + _MIP_ROWS_PER_TASK - 1) / _MIP_ROWS_PER_TASK;
+        _pr_thread_pool_dispatch(&(_globalState.threadPool), numTasks, _mip_builder_task, &builder);
+
+        if (dither != PR_FALSE)
         {
-            for (PRint i = 0; i < 3; ++i)
+            // Error diffusion runs across rows, so dithered levels are converted on the calling thread
+            pr_image image;
+            image.width     = builder.level.width;
+            image.height    = builder.level.height;
+            image.format    = 4;
+            image.defFree   = PR_TRUE;
+            image.colors    = builder.dst;
+
+            if (builder.level.tiled == PR_FALSE)
+                _pr_image_color_to_colorindex((PRcolorindex*)builder.level.texels, &image, dither);
+            else
             {
-                scaled[y*scaledWidth*3 + i] = _color_box2_blur(
-                    COLOR(0, y*2    , i),
-                    COLOR(0, y*2 + 1, i)
-                );
+                // Convert into the other scratch level, which is no longer used
+                PRcolorindex* colors = (PRcolorindex*)scratchLevels[(mip + 1) % 2];
+                _pr_image_color_to_colorindex(colors, &image, dither);
+
+                for (PRtexsize y = 0; y < builder.level.height; ++y)
+                    _texture_store_row(&(builder.level), 0, y, builder.level.width, colors + (size_t)y*builder.level.width);
             }
         }
-    }
 
-    return scaled;
+        // Use current level as source for the next level
+        builder.src         = builder.dst;
+        builder.srcWidth    = builder.level.width;
+        builder.srcHeight   = builder.level.height;
+    }
 
-    #undef COLOR
+    PR_FREE(scratch);
 }
 
-static PRubyte* _image_scale_down(PRtexsize width, PRtexsize height, PRenum format, const PRvoid* data)
+// Cancels the pending image load of the specified texture (see pr_texture_loader).
+static void _texture_cancel_load(pr_texture* texture)
 {
-    switch (format)
+    if (texture->pendingLoad != NULL)
     {
-        case PR_UBYTE_RGB:
-            return _image_scale_down_ubyte_rgb(width, height, (const PRubyte*)data);
-        default:
-            break;
+        _pr_texture_loader_cancel(&(_globalState.textureLoader), texture->pendingLoad);
+        texture->pendingLoad = NULL;
     }
-    return NULL;
 }
 
 // --- interface --- //
@@ -142,14 +632,7 @@ pr_texture* _pr_texture_create()
     // Create texture
     pr_texture* texture = PR_MALLOC(pr_texture);
 
-    texture->width  = 0;
-    texture->height = 0;
-    texture->mips   = 0;
-    texture->texels = NULL;
-
-    for (size_t i = 0; i < PR_MAX_NUM_MIPS; ++i)
-        texture->mipTexels[i] = NULL;
-
+    _pr_texture_init(texture);
     _pr_ref_add(texture);
 
     return texture;
@@ -161,11 +644,46 @@ void _pr_texture_delete(pr_texture* texture)
     {
         _pr_ref_release(texture);
 
-        PR_FREE(texture->texels);
+        _pr_texture_release(texture);
         PR_FREE(texture);
     }
 }
 
+void _pr_texture_init(pr_texture* texture)
+{
+    texture->width  = 0;
+    texture->height = 0;
+    texture->mips   = 0;
+    texture->texels = NULL;
+    texture->format = PR_TEXTURE_FORMAT_INDEX;
+    texture->tiled  = PR_FALSE;
+    texture->pot    = PR_FALSE;
+
+    texture->virtualTexture = NULL;
+    texture->layers         = 1;
+    texture->pendingLoad    = NULL;
+
+    memset(texture->palette, 0, sizeof(texture->palette));
+
+    for (size_t i = 0; i < PR_MAX_NUM_VIRTUAL_MIPS; ++i)
+        memset(&(texture->levels[i]), 0, sizeof(pr_texture_level));
+}
+
+void _pr_texture_release(pr_texture* texture)
+{
+    _texture_cancel_load(texture);
+
+    _pr_virtual_texture_delete(texture->virtualTexture);
+    PR_FREE(texture->texels);
+
+    texture->width          = 0;
+    texture->height         = 0;
+    texture->mips           = 0;
+    texture->format         = PR_TEXTURE_FORMAT_INDEX;
+    texture->virtualTexture = NULL;
+    texture->layers         = 1;
+}
+
 void _pr_texture_singular_init(pr_texture* texture)
 {
     if (texture != NULL)
@@ -174,6 +692,17 @@ void _pr_texture_singular_init(pr_texture* texture)
         texture->height = 1;
         texture->mips   = 0;
         texture->texels = PR_CALLOC(PRcolorindex, 1);
+        texture->format = PR_TEXTURE_FORMAT_INDEX;
+        texture->tiled  = PR_FALSE;
+        texture->pot    = PR_TRUE;
+        texture->log2Width  = 0;
+        texture->log2Height = 0;
+
+        texture->virtualTexture = NULL;
+        texture->layers         = 1;
+        texture->pendingLoad    = NULL;
+
+        _texture_setup_level(texture, 0, PR_TEXTURE_FORMAT_INDEX, texture->texels);
     }
 }
 
@@ -185,6 +714,15 @@ void _pr_texture_singular_clear(pr_texture* texture)
 
 PRboolean _pr_texture_image2d(
     pr_texture* texture, PRtexsize width, PRtexsize height, PRenum format, const PRvoid* data, PRboolean dither, PRboolean generateMips)
+{
+    return _pr_texture_array_image2d(
+        texture, width, height, 1, format, data, dither, generateMips, PR_STATE_MACHINE.states[PR_TEXTURE_TILING]
+    );
+}
+
+PRboolean _pr_texture_array_image2d(
+    pr_texture* texture, PRtexsize width, PRtexsize height, PRtexsize layers,
+    PRenum format, const PRvoid* data, PRboolean dither, PRboolean generateMips, PRboolean tiling)
 {
     // Validate parameters
     if (texture == NULL)
@@ -192,73 +730,115 @@ PRboolean _pr_texture_image2d(
         _pr_error_set(PR_ERROR_NULL_POINTER, __FUNCTION__);
         return PR_FALSE;
     }
-    if (width == 0 || height == 0)
+    if (width <= 0 || height <= 0 || layers <= 0)
     {
         _pr_error_set(PR_ERROR_INVALID_ARGUMENT, "textures must not have a size equal to zero");
         return PR_FALSE;
     }
-    if (width > PR_MAX_TEX_SIZE || height > PR_MAX_TEX_SIZE)
+    if (width > PR_MAX_TEX_SIZE || (PRint)height * layers > PR_MAX_TEX_SIZE)
     {
         _pr_error_set(PR_ERROR_INVALID_ARGUMENT, "maximum texture size exceeded");
         return PR_FALSE;
     }
 
-    // Determine number of texels
-    PRubyte mips = 0;
-    size_t numTexels = 0;
+    // All layers are stacked vertically
+    const PRtexsize layerHeight = height;
+    height *= layers;
 
-    if (generateMips != PR_FALSE)
+    // Determine texel storage format (only 8-bit color indices can be tiled)
+    PRubyte texelFormat = PR_TEXTURE_FORMAT_INDEX;
+
+    switch (format)
     {
-        PRtexsize w = width;
-        PRtexsize h = height;
+        case PR_UBYTE_RGB:
+            break;
+        case PR_UBYTE_RGB_PALETTE4:
+            texelFormat = PR_TEXTURE_FORMAT_PALETTE4;
+            break;
+        case PR_UBYTE_RGB_BLOCK:
+            texelFormat = PR_TEXTURE_FORMAT_BLOCK;
+            break;
+        default:
+            _pr_error_set(PR_ERROR_INVALID_ARGUMENT, "invalid texture image format");
+            return PR_FALSE;
+    }
 
-        while (1)
-        {
-            // Count number of texels
-            numTexels += w*h;
-            ++mips;
+    const PRboolean tiled = (texelFormat == PR_TEXTURE_FORMAT_INDEX && tiling != PR_FALSE);
 
-            if (w == 1 && h == 1)
-                break;
+    // New texels replace the texels of a pending image load
+    _texture_cancel_load(texture);
 
-            // Halve MIP size
-            if (w > 1)
-                w /= 2;
-            if (h > 1)
-                h /= 2;
-        }
+    // Release previous virtual texture (its texel format never matches, so the texels are reallocated)
+    if (texture->virtualTexture != NULL)
+    {
+        _pr_virtual_texture_delete(texture->virtualTexture);
+        texture->virtualTexture = NULL;
     }
-    else
+
+    // Determine size of the texel MIP chain
+    PRubyte mips = 0;
+    size_t numBytes = 0;
+
+    PRtexsize w = width;
+    PRtexsize h = height;
+    PRtexsize lh = layerHeight;
+
+    while (1)
     {
-        mips = 1;
-        numTexels = width*height;
+        // Count number of texel bytes
+        numBytes += _texture_level_size(w, h, texelFormat, tiled);
+        ++mips;
+
+        if (generateMips == PR_FALSE || (w == 1 && h == 1) || (layers > 1 && (lh % 2) != 0))
+            break;
+
+        // Halve layer height
+        lh /= 2;
+
+        // Halve MIP size
+        if (w > 1)
+            w /= 2;
+        if (h > 1)
+            h /= 2;
     }
 
     // Check if texels must be reallocated
-    if (texture->width != width || texture->height != height || texture->mips != mips)
+    if ( texture->width != width || texture->height != height || texture->mips != mips ||
+         texture->format != texelFormat || texture->tiled != tiled )
     {
         // Setup new texture dimension
         texture->width  = width;
         texture->height = height;
         texture->mips   = mips;
+        texture->format = texelFormat;
+        texture->tiled  = tiled;
+
+        // Store whether the fixed-point samplers for power-of-two textures can be used
+        const PRint log2Width = _texture_log2(width);
+        const PRint log2Height = _texture_log2(height);
+
+        texture->pot        = (log2Width >= 0 && log2Height >= 0);
+        texture->log2Width  = (PRubyte)PR_MAX(log2Width, 0);
+        texture->log2Height = (PRubyte)PR_MAX(log2Height, 0);
 
         // Free previous texels
         PR_FREE(texture->texels);
 
         // Create texels
-        texture->texels = PR_CALLOC(PRcolorindex, numTexels);
+        texture->texels = (PRcolorindex*)PR_CALLOC(PRubyte, numBytes);
 
         // Setup MIP texel offsets
-        const PRcolorindex* texels = texture->texels;
-        PRtexsize w = width, h = height;
+        const PRubyte* texels = (const PRubyte*)texture->texels;
+        w = width;
+        h = height;
 
         for (PRubyte mip = 0; mip < texture->mips; ++mip)
         {
             // Store current texel offset
-            texture->mipTexels[mip] = texels;
+            _texture_setup_level(texture, mip, texelFormat, (const PRcolorindex*)texels);
 
             // Goto next texel MIP level
-            texels += w*h;
+            texels += _texture_level_size(w, h, texelFormat, tiled);
 
             // Halve MIP size
             if (w > 1)
@@ -268,91 +848,256 @@ PRboolean _pr_texture_image2d(
         }
     }
 
-    // Fill image data of first MIP level
-    PRcolorindex* texels = texture->texels;
+    texture->layers = layers;
 
-    _texture_subimage2d(texels, 0, width, height, format, data, dither);
+    if (generateMips != PR_FALSE || texelFormat != PR_TEXTURE_FORMAT_INDEX)
+    {
+        // Fill image data of all MIP levels
+        _texture_build_mips(texture, (const PRubyte*)data, dither);
+    }
+    else
+    {
+        // Fill image data of first MIP level
+        _texture_subimage2d_rect(texture, 0, 0, 0, width, height, format, data, dither);
+    }
+
+    return PR_TRUE;
+}
 
-    if (generateMips != PR_FALSE)
+PRboolean _pr_texture_subimage2d(
+    pr_texture* texture, PRubyte mip, PRtexsize x, PRtexsize y, PRtexsize width, PRtexsize height, PRenum format, const PRvoid* data, PRboolean dither)
+{
+    // Validate parameters
+    if (texture == NULL)
     {
-        PRvoid* prevData = (PRvoid*)data;
+        _pr_error_set(PR_ERROR_NULL_POINTER, __FUNCTION__);
+        return PR_FALSE;
+    }
+    if (texture->texels == NULL || mip >= texture->mips || x < 0 || y < 0 || width <= 0 || height <= 0)
+    {
+        _pr_error_set(PR_ERROR_INVALID_ARGUMENT, __FUNCTION__);
+        return PR_FALSE;
+    }
+    if (texture->format != PR_TEXTURE_FORMAT_INDEX)
+    {
+        _pr_error_set(PR_ERROR_INVALID_STATE, "sub-images can not be set for 4-bit, block-compressed, or virtual textures");
+        return PR_FALSE;
+    }
 
-        // Fill image data
-        for (PRubyte mip = 1; mip < texture->mips; ++mip)
-        {
-            // Goto next texel MIP level
-            texels += width*height;
+    const pr_texture_level level = texture->levels[mip];
 
-            // Scale down image data
-            data = _image_scale_down(width, height, format, prevData);
+    if (x + width > level.width || y + height > level.height)
+    {
+        _pr_error_set(PR_ERROR_INVALID_ARGUMENT, __FUNCTION__);
+        return PR_FALSE;
+    }
 
-            if (mip > 1)
-                PR_FREE(prevData);
-            prevData = (PRvoid*)data;
+    // Fill image data for specified MIP level
+    _texture_subimage2d_rect(texture, mip, x, y, width, height, format, data, dither);
 
-            if (data == NULL)
-            {
-                _pr_error_set(PR_ERROR_INVALID_ARGUMENT, __FUNCTION__);
-                return PR_FALSE;
-            }
+    return PR_TRUE;
+}
 
-            // Halve MIP size
-            if (width > 1)
-                width /= 2;
-            if (height > 1)
-                height /= 2;
+PRboolean _pr_texture_virtual_image2d(pr_texture* texture, const char* filename, PRuint numCachePages)
+{
+    if (texture == NULL)
+    {
+        _pr_error_set(PR_ERROR_NULL_POINTER, __FUNCTION__);
+        return PR_FALSE;
+    }
 
-            // Fill image data for current MIP level
-            _texture_subimage2d(texels, mip, width, height, format, data, dither);
+    // Open virtual texture file
+    pr_virtual_texture* virtualTexture = _pr_virtual_texture_create(filename, numCachePages);
+    if (virtualTexture == NULL)
+        return PR_FALSE;
+
+    // Read MIP tail into the texels
+    size_t numTexels = 0;
+
+    for (PRubyte mip = virtualTexture->tailMip; mip < virtualTexture->numMips; ++mip)
+        numTexels += (size_t)virtualTexture->widths[mip] * virtualTexture->heights[mip];
+
+    PRcolorindex* texels = PR_CALLOC(PRcolorindex, numTexels);
+    PRcolorindex* tailTexels = texels;
+
+    for (PRubyte mip = virtualTexture->tailMip; mip < virtualTexture->numMips; ++mip)
+    {
+        if (!_pr_virtual_texture_read_tail(virtualTexture, mip, tailTexels))
+        {
+            PR_FREE(texels);
+            _pr_virtual_texture_delete(virtualTexture);
+            return PR_FALSE;
         }
+        tailTexels += (size_t)virtualTexture->widths[mip] * virtualTexture->heights[mip];
+    }
+
+    // Replace previous texels
+    _texture_cancel_load(texture);
+    _pr_virtual_texture_delete(texture->virtualTexture);
+    PR_FREE(texture->texels);
+
+    texture->width          = virtualTexture->widths[0];
+    texture->height         = virtualTexture->heights[0];
+    texture->mips           = virtualTexture->numMips;
+    texture->texels         = texels;
+    texture->format         = PR_TEXTURE_FORMAT_VIRTUAL;
+    texture->tiled          = PR_FALSE;
+    texture->virtualTexture = virtualTexture;
+    texture->layers         = 1;
 
-        PR_FREE(prevData);
+    const PRint log2Width = _texture_log2(texture->width);
+    const PRint log2Height = _texture_log2(texture->height);
+
+    texture->pot        = (log2Width >= 0 && log2Height >= 0);
+    texture->log2Width  = (PRubyte)PR_MAX(log2Width, 0);
+    texture->log2Height = (PRubyte)PR_MAX(log2Height, 0);
+
+    // Setup paged MIP levels and the MIP levels of the resident MIP tail
+    tailTexels = texels;
+
+    for (PRubyte mip = 0; mip < texture->mips; ++mip)
+    {
+        if (mip < virtualTexture->tailMip)
+            _texture_setup_level(texture, mip, PR_TEXTURE_FORMAT_VIRTUAL, NULL);
+        else
+        {
+            _texture_setup_level(texture, mip, PR_TEXTURE_FORMAT_INDEX, tailTexels);
+            tailTexels += (size_t)virtualTexture->widths[mip] * virtualTexture->heights[mip];
+        }
     }
 
+    virtualTexture->levels = texture->levels;
+
     return PR_TRUE;
 }
 
-PRboolean _pr_texture_subimage2d(
-    pr_texture* texture, PRubyte mip, PRtexsize x, PRtexsize y, PRtexsize width, PRtexsize height, PRenum format, const PRvoid* data, PRboolean dither)
+void _pr_texture_update_virtual(pr_texture* texture)
 {
-    // Validate parameters
     if (texture == NULL)
+        _pr_error_set(PR_ERROR_NULL_POINTER, __FUNCTION__);
+    else if (texture->virtualTexture == NULL)
+        _pr_error_set(PR_ERROR_INVALID_STATE, "texture has no virtual texture");
+    else
+        _pr_virtual_texture_update(texture->virtualTexture);
+}
+
+PRboolean _pr_texture_image2d_from_file_async(pr_texture* texture, const char* filename, PRboolean dither, PRboolean generateMips)
+{
+    // Validate parameters
+    if (texture == NULL || filename == NULL)
     {
         _pr_error_set(PR_ERROR_NULL_POINTER, __FUNCTION__);
         return PR_FALSE;
     }
-    if (texture->texels == NULL || x < 0 || y < 0 || x + width >= texture->width || y + height >= texture->height || width <= 0 || height <= 0 || mip >= texture->mips)
+    if (*filename == '\0')
     {
         _pr_error_set(PR_ERROR_INVALID_ARGUMENT, __FUNCTION__);
         return PR_FALSE;
     }
 
-    // Fill image data for specified MIP level
-    _texture_subimage2d_rect(texture, mip, x, y, width, height, format, data);
+    /*
+    Release previous texels (and a previous pending load), so the texture is drawn with the singular color.
+    This is called outside of command buffers, so no binned polygons refer to the previous texels.
+    */
+    _pr_texture_release(texture);
+
+    texture->pendingLoad = _pr_texture_loader_request(
+        &(_globalState.textureLoader), filename, dither, generateMips, PR_STATE_MACHINE.states[PR_TEXTURE_TILING]
+    );
+
+    return PR_TRUE;
+}
+
+PRboolean _pr_texture_finish_load(pr_texture* texture, PRboolean wait)
+{
+    if (texture == NULL)
+    {
+        _pr_error_set(PR_ERROR_NULL_POINTER, __FUNCTION__);
+        return PR_FALSE;
+    }
+
+    pr_texture_load* load = texture->pendingLoad;
+
+    if (load == NULL)
+        return PR_TRUE;
+    if (!_pr_texture_loader_poll(&(_globalState.textureLoader), load, wait))
+        return PR_FALSE;
+
+    // Errors of the loader thread are reported on the thread which finishes the load
+    if (!load->succeeded)
+        _pr_error_set(PR_ERROR_INVALID_ARGUMENT, "asynchronous texture image load failed");
+
+    // Move texels of the staging texture into the texture (the load is done, so the loader no longer refers to it)
+    texture->pendingLoad = NULL;
+
+    _pr_texture_release(texture);
+
+    *texture = load->staging;
+
+    for (PRubyte mip = 0; mip < texture->mips; ++mip)
+        texture->levels[mip].palette = texture->palette;
+
+    load->staging.texels = NULL;
+    _pr_texture_load_delete(load);
 
     return PR_TRUE;
 }
 
+void _pr_texture_texcoord_transform(const pr_texture* texture, const pr_texture_region* region, pr_texcoord_transform* transform)
+{
+    if (region->width > 0 && region->height > 0)
+    {
+        // Map texture coordinates into the region
+        transform->scaleU   = (PRfloat)region->width / texture->width;
+        transform->scaleV   = (PRfloat)region->height / texture->height;
+        transform->offsetU  = (PRfloat)region->x / texture->width;
+        transform->offsetV  = (PRfloat)region->y / texture->height;
+    }
+    else
+    {
+        // Map texture coordinates into the first layer (this is the identity for all other textures)
+        transform->scaleU   = 1.0f;
+        transform->scaleV   = 1.0f / texture->layers;
+        transform->offsetU  = 0.0f;
+        transform->offsetV  = 0.0f;
+    }
+}
+
 PRubyte _pr_texture_num_mips(PRubyte maxSize)
 {
     return maxSize > 0 ? (PRubyte)(floorf(log2f(maxSize))) + 1 : 0;
 }
 
-const PRcolorindex* _pr_texture_select_miplevel(const pr_texture* texture, PRubyte mip, PRtexsize* width, PRtexsize* height)
+void _pr_texture_select_miplevel(const pr_texture* texture, PRubyte mip, pr_texture_level* level)
 {
-    // Return texel buffer (MIP-map 0) if there are no MIP-maps
+    // Return single texel if there are no MIP-maps
     if (texture->mips == 0)
-        return texture->texels;
+    {
+        *level = texture->levels[0];
+        return;
+    }
 
     // Add MIP level offset
     mip = PR_CLAMP((PRubyte)(((PRint)mip) + _stateMachine->textureLodBias), 0, texture->mips - 1);
 
-    // Store mip size in output parameters
-    *width = PR_MIP_SIZE(texture->width, mip);
-    *height = PR_MIP_SIZE(texture->height, mip);
+    *level = texture->levels[mip];
+}
 
-    // Return MIP-map texel offset
-    return texture->mipTexels[mip];
+void _pr_texture_setup_sampler(const pr_texture* texture, PRboolean mipMapping, pr_texture_sampler* sampler)
+{
+    if (mipMapping != PR_FALSE && texture->mips > 1)
+    {
+        // Select MIP levels per span
+        sampler->texture = texture;
+        sampler->lodBias = _stateMachine->textureLodBias;
+        sampler->level   = texture->levels[0];
+    }
+    else
+    {
+        sampler->texture = NULL;
+        sampler->lodBias = 0;
+        _pr_texture_select_miplevel(texture, 0, &(sampler->level));
+    }
 }
 
 /*PRubyte _pr_texture_compute_miplevel(const pr_texture* texture, PRfloat r1x, PRfloat r1y, PRfloat r2x, PRfloat r2y)
@@ -375,19 +1120,19 @@ const PRcolorindex* _pr_texture_select_miplevel(const pr_texture* texture, PRuby
     return (PRubyte)PR_CLAMP(lod, 0, texture->mips - 1);
 }*/
 
-PRcolorindex _pr_texture_sample_nearest_from_mipmap(const PRcolorindex* mipTexels, PRtexsize mipWidth, PRtexsize mipHeight, PRfloat u, PRfloat v)
+PRcolorindex _pr_texture_sample_nearest_from_mipmap(const pr_texture_level* level, PRfloat u, PRfloat v)
 {
     // Clamp texture coordinates
-    PRint x = (PRint)((u - (PRint)u)*mipWidth);
-    PRint y = (PRint)((v - (PRint)v)*mipHeight);
+    PRint x = (PRint)((u - (PRint)u)*level->width);
+    PRint y = (PRint)((v - (PRint)v)*level->height);
 
     if (x < 0)
-        x += mipWidth;
+        x += level->width;
     if (y < 0)
-        y += mipHeight;
+        y += level->height;
 
     // Sample from texels
-    return mipTexels[y*mipWidth + x];
+    return _pr_texture_fetch(level, (PRuint)x, (PRuint)y);
 }
 
 PRcolorindex _pr_texture_sample_nearest(const pr_texture* texture, PRfloat u, PRfloat v, PRfloat ddx, PRfloat ddy)
@@ -402,12 +1147,11 @@ PRcolorindex _pr_texture_sample_nearest(const pr_texture* texture, PRfloat u, PR
     const PRubyte mip = (PRubyte)PR_CLAMP(lod, 0, texture->mips - 1);
 
     // Get texels from MIP-level
-    PRtexsize w, h;
-    const PRcolorindex* texels = _pr_texture_select_miplevel(texture, mip, &w, &h);
+    pr_texture_level level;
+    _pr_texture_select_miplevel(texture, mip, &level);
 
     // Sample nearest texel
-    return _pr_texture_sample_nearest_from_mipmap(texels, w, h, u, v);
-    //return _pr_color_to_colorindex_r3g3b2(mip*20, mip*20, mip*20);
+    return _pr_texture_sample_nearest_from_mipmap(&level, u, v);
 }
 
 PRint _pr_texture_get_mip_parameter(const pr_texture* texture, PRubyte mip, PRenum param)
@@ -13,6 +13,8 @@
 #include "enums.h"
 #include "vector2.h"
 #include "color.h"
+#include "raster_vertex.h"
+#include "virtual_texture.h"
 
 
 // Maximal 11 MIP-maps restricts the textures to have a
@@ -23,23 +25,122 @@
 #define PR_MIP_SIZE(size, mip)      ((size) >> (mip))
 #define PR_TEXTURE_HAS_MIPS(tex)    ((tex)->mips > 1)
 
+// Tiled textures store their texels in square tiles of (2^PR_TEXTURE_TILE_SHIFT)^2 texels,
+// so that a single tile of 8-bit color indices fills exactly one 64 byte cache line.
+#ifdef PR_COLOR_BUFFER_24BIT
+#   define PR_TEXTURE_TILE_SHIFT    2
+#else
+#   define PR_TEXTURE_TILE_SHIFT    3
+#endif
+
+#define PR_TEXTURE_TILE_SIZE        (1 << PR_TEXTURE_TILE_SHIFT)
+#define PR_TEXTURE_TILE_MASK        (PR_TEXTURE_TILE_SIZE - 1)
+
+// Texel storage formats: 8-bit color indices, 4-bit indices into a 16-color palette per texture,
+// blocks of 4x4 texels with two color indices each (see pr_texture_block),
+// or pages of a virtual texture (see pr_virtual_texture).
+#define PR_TEXTURE_FORMAT_INDEX     0
+#define PR_TEXTURE_FORMAT_PALETTE4  1
+#define PR_TEXTURE_FORMAT_BLOCK     2
+#define PR_TEXTURE_FORMAT_VIRTUAL   3
+
+#define PR_TEXTURE_PALETTE_SIZE     16
+
+#define PR_TEXTURE_BLOCK_SHIFT      2
+#define PR_TEXTURE_BLOCK_SIZE       (1 << PR_TEXTURE_BLOCK_SHIFT)
+#define PR_TEXTURE_BLOCK_MASK       (PR_TEXTURE_BLOCK_SIZE - 1)
+
+struct pr_texture_load;
+
+// Number of fractional bits of the fixed-point texture coordinates for power-of-two textures.
+#define PR_TEXCOORD_FRACTION_BITS   16
+#define PR_TEXCOORD_FIXED(x)        ((PRint)(PRlong)((x) * (1 << PR_TEXCOORD_FRACTION_BITS)))
+
+
+/**
+Block of 4x4 texels for the block-compressed texture format (2 bits per texel with 8-bit color indices).
+Bit (y*4 + x) of the mask selects the color of texel (x, y) inside the block.
+*/
+typedef struct pr_texture_block
+{
+    PRushort        mask;
+    PRcolorindex    colors[2];
+}
+pr_texture_block;
 
-//! Textures can have a maximum size of 256x256 texels.
+//! Texels of a single MIP level, as they are passed to the samplers.
+typedef struct pr_texture_level
+{
+    const PRcolorindex* texels;     //!< Texels, or raw texel data for the PR_TEXTURE_FORMAT_PALETTE4 and PR_TEXTURE_FORMAT_BLOCK formats.
+    const PRcolorindex* palette;    //!< Palette of the PR_TEXTURE_FORMAT_PALETTE4 format.
+    pr_virtual_texture* virtualTexture; //!< Virtual texture of the PR_TEXTURE_FORMAT_VIRTUAL format.
+    PRtexsize           width;
+    PRtexsize           height;
+    PRuint              pitch;      //!< Number of texels per row (or per row of tiles for tiled textures), bytes per row (4-bit format), or blocks per row of blocks.
+    PRubyte             format;     //!< Texel storage format (e.g. PR_TEXTURE_FORMAT_INDEX).
+    PRboolean           tiled;
+    PRboolean           pot;        //!< Specifies whether width and height are powers of two.
+    PRubyte             log2Width;
+    PRubyte             log2Height;
+    PRubyte             mip;        //!< MIP level index (only used for the PR_TEXTURE_FORMAT_VIRTUAL format).
+}
+pr_texture_level;
+
+//! Textures can have a maximum size of 1024x1024 texels (or 16384x16384 texels for virtual textures).
 //! Textures store all their mip maps in a single texel array for compact memory access.
 typedef struct pr_texture
 {
     PRtexsize           width;                      //!< Width of the first MIP level.
     PRtexsize           height;                     //!< Height of the first MIP level.
     PRubyte             mips;                       //!< Number of MIP levels.
-    PRcolorindex*       texels;                     //!< Texel MIP chain.
-    const PRcolorindex* mipTexels[PR_MAX_NUM_MIPS]; //!< Texel offsets for the MIP chain (Use a static array for better cache locality).
+    PRcolorindex*       texels;                     //!< Texel MIP chain (raw texel data for the 4-bit and block-compressed formats).
+    pr_texture_level    levels[PR_MAX_NUM_VIRTUAL_MIPS];    //!< Texel offsets and sizes of the MIP chain (Use a static array for better cache locality).
+    PRubyte             format;                     //!< Texel storage format (e.g. PR_TEXTURE_FORMAT_INDEX).
+    PRcolorindex        palette[PR_TEXTURE_PALETTE_SIZE];   //!< Palette of the PR_TEXTURE_FORMAT_PALETTE4 format.
+    PRboolean           tiled;                      //!< Specifies whether the texels are stored in tiles (see PR_TEXTURE_TILE_SIZE) instead of rows.
+    PRboolean           pot;                        //!< Specifies whether width and height are powers of two.
+    PRubyte             log2Width;                  //!< Base 2 logarithm of the width (only valid for power-of-two textures).
+    PRubyte             log2Height;                 //!< Base 2 logarithm of the height (only valid for power-of-two textures).
+    pr_virtual_texture* virtualTexture;             //!< Virtual texture whose MIP tail is stored in the texels, or null.
+    PRtexsize           layers;                     //!< Number of layers of a texture array (stacked vertically in each MIP level).
+    struct pr_texture_load* pendingLoad;            //!< Asynchronous image load whose texels are not yet moved into the texture, or null.
 }
 pr_texture;
 
+/**
+Sub-rectangle (in texels of the first MIP level) of an atlas texture, into which the texture coordinates
+of the next draw calls are mapped. A region with zero width or height specifies the first layer of the texture.
+*/
+typedef struct pr_texture_region
+{
+    PRtexsize x;
+    PRtexsize y;
+    PRtexsize width;
+    PRtexsize height;
+}
+pr_texture_region;
+
+/**
+Texture sampling state of a polygon. Either all pixels are sampled from a single MIP level,
+or the rasterizer selects the MIP level per span from the screen space derivatives of the texture coordinates.
+*/
+typedef struct pr_texture_sampler
+{
+    pr_texture_level    level;      //!< MIP level for all pixels (only used if 'texture' is null).
+    const pr_texture*   texture;    //!< Texture whose MIP levels are selected per span, or null.
+    PRubyte             lodBias;    //!< Level-of-detail bias for the per-span MIP selection.
+}
+pr_texture_sampler;
+
 
 pr_texture* _pr_texture_create();
 void _pr_texture_delete(pr_texture* texture);
 
+//! Initializes an empty texture without reference counting (e.g. for the staging textures of the texture loader).
+void _pr_texture_init(pr_texture* texture);
+//! Releases the texels of the specified texture and cancels its pending image load. The texture is empty afterwards.
+void _pr_texture_release(pr_texture* texture);
+
 void _pr_texture_singular_init(pr_texture* texture);
 void _pr_texture_singular_clear(pr_texture* texture);
 
@@ -49,13 +150,54 @@ PR_INLINE void _pr_texture_singular_color(pr_texture* texture, PRcolorindex colo
     texture->texels[0] = colorIndex;
 }
 
-//! Sets the 2D image data to the specified texture.
+/**
+Sets the 2D image data to the specified texture. If the PR_TEXTURE_TILING state is enabled,
+the texels are stored in tiles (see PR_TEXTURE_TILE_SIZE), otherwise they are stored row by row.
+With the PR_UBYTE_RGB_PALETTE4 and PR_UBYTE_RGB_BLOCK formats, the texels are stored in the compact formats
+PR_TEXTURE_FORMAT_PALETTE4 and PR_TEXTURE_FORMAT_BLOCK (never tiled and never dithered).
+*/
 PRboolean _pr_texture_image2d(
     pr_texture* texture,
     PRtexsize width, PRtexsize height,
     PRenum format, const PRvoid* data, PRboolean dither, PRboolean generateMips
 );
 
+/**
+Sets the 2D image data of all layers to the specified texture array. The layers are stacked vertically,
+i.e. the texture has a height of (height*layers) texels. MIP maps are only generated as long as
+the layer height can be halved, so that no MIP level mixes the texels of different layers.
+\param[in] tiling Specifies whether the texels are stored in tiles (see PR_TEXTURE_TILING).
+This function does not use the state machine, so it can also be used by the texture loader.
+*/
+PRboolean _pr_texture_array_image2d(
+    pr_texture* texture,
+    PRtexsize width, PRtexsize height, PRtexsize layers,
+    PRenum format, const PRvoid* data, PRboolean dither, PRboolean generateMips, PRboolean tiling
+);
+
+/**
+Starts loading the 2D image data from file into the specified texture on the loader thread (see pr_texture_loader).
+The previous texels are released immediately, so the texture is drawn with the singular color until the load is finished.
+The PR_TEXTURE_TILING state is taken when the load is requested.
+*/
+PRboolean _pr_texture_image2d_from_file_async(pr_texture* texture, const char* filename, PRboolean dither, PRboolean generateMips);
+
+/**
+Moves the texels of the pending image load into the specified texture, if the load is done.
+Returns PR_TRUE if the texture has no pending load afterwards. If 'wait' is PR_TRUE, this blocks until the load is done.
+*/
+PRboolean _pr_texture_finish_load(pr_texture* texture, PRboolean wait);
+
+/**
+Sets the virtual texture file to the specified texture. Only the MIP tail (all MIP levels which fit into a single page)
+is stored in the texels, all finer MIP levels are paged in on demand into a page cache with the specified number of pages.
+\see _pr_virtual_texture_create
+*/
+PRboolean _pr_texture_virtual_image2d(pr_texture* texture, const char* filename, PRuint numCachePages);
+
+//! Loads all pages of the virtual texture, which were requested by the samplers since the last update.
+void _pr_texture_update_virtual(pr_texture* texture);
+
 PRboolean _pr_texture_subimage2d(
     pr_texture* texture,
     PRubyte mip, PRtexsize x, PRtexsize y,
@@ -63,17 +205,76 @@ PRboolean _pr_texture_subimage2d(
     PRenum format, const PRvoid* data, PRboolean dither
 );
 
+/**
+Returns the texture-coordinate transformation for draw calls with the specified texture region:
+texture coordinates in [0, 1] are mapped into the region (or into the first layer if the region is empty),
+and the integer part of the V coordinate steps by the region height (i.e. it selects the layer of a texture array).
+*/
+void _pr_texture_texcoord_transform(const pr_texture* texture, const pr_texture_region* region, pr_texcoord_transform* transform);
+
 //! Returns the number of MIP levels for the specified maximal texture dimension (width or height).
 PRubyte _pr_texture_num_mips(PRubyte maxSize);
 
-//! Returns a pointer to the specified texture MIP level.
-const PRcolorindex* _pr_texture_select_miplevel(const pr_texture* texture, PRubyte mip, PRtexsize* width, PRtexsize* height);
+//! Selects the specified texture MIP level (with the current LOD bias) for the samplers.
+void _pr_texture_select_miplevel(const pr_texture* texture, PRubyte mip, pr_texture_level* level);
+
+/**
+Sets up the sampler for a polygon. With MIP-mapping, the MIP levels are selected per span (with the current LOD bias),
+otherwise all pixels are sampled from the first MIP level (with the current LOD bias).
+*/
+void _pr_texture_setup_sampler(const pr_texture* texture, PRboolean mipMapping, pr_texture_sampler* sampler);
 
 //! Returns the MIP level index for the specified texture.
 //PRubyte _pr_texture_compute_miplevel(const pr_texture* texture, PRfloat r1x, PRfloat r1y, PRfloat r2x, PRfloat r2y);
 
+//! Returns the offset of the specified texel within its MIP level. The coordinates must be inside the MIP level.
+PR_INLINE PRuint _pr_texture_texel_offset(const pr_texture_level* level, PRuint x, PRuint y)
+{
+    if (level->tiled != PR_FALSE)
+    {
+        return
+            (y >> PR_TEXTURE_TILE_SHIFT) * level->pitch +
+            ((x & ~PR_TEXTURE_TILE_MASK) << PR_TEXTURE_TILE_SHIFT) +
+            ((y & PR_TEXTURE_TILE_MASK) << PR_TEXTURE_TILE_SHIFT) +
+            (x & PR_TEXTURE_TILE_MASK);
+    }
+    return y * level->pitch + x;
+}
+
+//! Returns the specified texel of the MIP level. The coordinates must be inside the MIP level.
+PR_INLINE PRcolorindex _pr_texture_fetch(const pr_texture_level* level, PRuint x, PRuint y)
+{
+    if (level->format == PR_TEXTURE_FORMAT_INDEX)
+        return level->texels[_pr_texture_texel_offset(level, x, y)];
+
+    if (level->format == PR_TEXTURE_FORMAT_PALETTE4)
+    {
+        // Two texels per byte, the low nibble is the left texel
+        const PRubyte pair = ((const PRubyte*)level->texels)[y * level->pitch + (x >> 1)];
+        return level->palette[(pair >> ((x & 1) << 2)) & 0x0f];
+    }
+
+    if (level->format == PR_TEXTURE_FORMAT_VIRTUAL)
+        return _pr_virtual_texture_fetch(level->virtualTexture, level->mip, x, y);
+
+    const pr_texture_block* block = (const pr_texture_block*)level->texels +
+        (y >> PR_TEXTURE_BLOCK_SHIFT) * level->pitch + (x >> PR_TEXTURE_BLOCK_SHIFT);
+    return block->colors[(block->mask >> (((y & PR_TEXTURE_BLOCK_MASK) << PR_TEXTURE_BLOCK_SHIFT) + (x & PR_TEXTURE_BLOCK_MASK))) & 1];
+}
+
 //! Samples the nearest texel from the specified MIP-map level.
-PRcolorindex _pr_texture_sample_nearest_from_mipmap(const PRcolorindex* mipTexels, PRtexsize mipWidth, PRtexsize mipHeight, PRfloat u, PRfloat v);
+PRcolorindex _pr_texture_sample_nearest_from_mipmap(const pr_texture_level* level, PRfloat u, PRfloat v);
+
+/**
+Samples the nearest texel from the specified power-of-two MIP-map level. The texture coordinates
+are in fixed-point format (see PR_TEXCOORD_FIXED) and are wrapped with bit masks.
+*/
+PR_INLINE PRcolorindex _pr_texture_sample_nearest_pot(const pr_texture_level* level, PRint u, PRint v)
+{
+    const PRuint x = (PRuint)(u >> (PR_TEXCOORD_FRACTION_BITS - level->log2Width)) & (PRuint)(level->width - 1);
+    const PRuint y = (PRuint)(v >> (PR_TEXCOORD_FRACTION_BITS - level->log2Height)) & (PRuint)(level->height - 1);
+    return _pr_texture_fetch(level, x, y);
+}
 
 //! Samples the nearest texel from the specified texture. MIP-map selection is compuited by tex-coord derivations ddx and ddy.
 PRcolorindex _pr_texture_sample_nearest(const pr_texture* texture, PRfloat u, PRfloat v, PRfloat ddx, PRfloat ddy);
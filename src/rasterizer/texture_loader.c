@@ -0,0 +1,243 @@
+/*
+ * texture_loader.c
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#include "texture_loader.h"
+#include "image.h"
+#include "helper.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+// --- internals --- //
+
+// Decodes the image file and builds the texels of the staging texture (this must not use the state machine of any context).
+static void _texture_load_process(pr_texture_load* load)
+{
+    pr_image* image = _pr_image_load_from_file(load->filename);
+
+    if (image != NULL)
+    {
+        load->succeeded = _pr_texture_array_image2d(
+            &(load->staging),
+            (PRtexsize)(image->width),
+            (PRtexsize)(image->height),
+            1,
+            PR_UBYTE_RGB,
+            image->colors,
+            load->dither,
+            load->generateMips,
+            load->tiled
+        );
+        _pr_image_delete(image);
+    }
+}
+
+static void _texture_loader_thread(PRvoid* userData)
+{
+    pr_texture_loader* loader = (pr_texture_loader*)userData;
+
+    _pr_mutex_lock(&(loader->mutex));
+
+    while (1)
+    {
+        // Wait for next load
+        while (!loader->quit && loader->first == NULL)
+            _pr_condition_wait(&(loader->workCondition), &(loader->mutex));
+
+        if (loader->quit)
+            break;
+
+        pr_texture_load* load = loader->first;
+
+        loader->first = load->next;
+        if (loader->first == NULL)
+            loader->last = NULL;
+
+        load->next = NULL;
+
+        // Process load without holding the mutex
+        _pr_mutex_unlock(&(loader->mutex));
+        {
+            _texture_load_process(load);
+        }
+        _pr_mutex_lock(&(loader->mutex));
+
+        if (load->canceled)
+            _pr_texture_load_delete(load);
+        else
+        {
+            load->done = PR_TRUE;
+            _pr_condition_broadcast(&(loader->doneCondition));
+        }
+    }
+
+    _pr_mutex_unlock(&(loader->mutex));
+}
+
+// --- interface --- //
+
+void _pr_texture_loader_init(pr_texture_loader* loader)
+{
+    loader->first   = NULL;
+    loader->last    = NULL;
+    loader->running = PR_FALSE;
+    loader->quit    = PR_FALSE;
+
+    _pr_mutex_init(&(loader->mutex));
+    _pr_condition_init(&(loader->workCondition));
+    _pr_condition_init(&(loader->doneCondition));
+}
+
+void _pr_texture_loader_release(pr_texture_loader* loader)
+{
+    // Terminate loader thread
+    _pr_mutex_lock(&(loader->mutex));
+    {
+        loader->quit = PR_TRUE;
+        _pr_condition_broadcast(&(loader->workCondition));
+    }
+    _pr_mutex_unlock(&(loader->mutex));
+
+    if (loader->running)
+        _pr_thread_join(&(loader->thread));
+
+    // Delete all loads which have not been started
+    while (loader->first != NULL)
+    {
+        pr_texture_load* load = loader->first;
+        loader->first = load->next;
+        _pr_texture_load_delete(load);
+    }
+
+    loader->last    = NULL;
+    loader->running = PR_FALSE;
+
+    _pr_condition_release(&(loader->doneCondition));
+    _pr_condition_release(&(loader->workCondition));
+    _pr_mutex_release(&(loader->mutex));
+}
+
+pr_texture_load* _pr_texture_loader_request(
+    pr_texture_loader* loader, const char* filename, PRboolean dither, PRboolean generateMips, PRboolean tiled)
+{
+    // Create load with a copy of the filename
+    pr_texture_load* load = PR_MALLOC(pr_texture_load);
+
+    const size_t len = strlen(filename);
+
+    load->filename = PR_CALLOC(char, len + 1);
+    memcpy(load->filename, filename, len);
+
+    _pr_texture_init(&(load->staging));
+
+    load->dither        = dither;
+    load->generateMips  = generateMips;
+    load->tiled         = tiled;
+    load->succeeded     = PR_FALSE;
+    load->done          = PR_FALSE;
+    load->canceled      = PR_FALSE;
+    load->next          = NULL;
+
+    PRboolean queued = PR_FALSE;
+
+    _pr_mutex_lock(&(loader->mutex));
+    {
+        // Start loader thread with the first load
+        if (!loader->running && !loader->quit)
+            loader->running = _pr_thread_start(&(loader->thread), _texture_loader_thread, loader);
+
+        if (loader->running)
+        {
+            // Append load to the queue
+            if (loader->last != NULL)
+                loader->last->next = load;
+            else
+                loader->first = load;
+            loader->last = load;
+
+            _pr_condition_signal(&(loader->workCondition));
+
+            queued = PR_TRUE;
+        }
+    }
+    _pr_mutex_unlock(&(loader->mutex));
+
+    // Otherwise load the image on the calling thread
+    if (!queued)
+    {
+        _texture_load_process(load);
+        load->done = PR_TRUE;
+    }
+
+    return load;
+}
+
+PRboolean _pr_texture_loader_poll(pr_texture_loader* loader, pr_texture_load* load, PRboolean wait)
+{
+    PRboolean done = PR_FALSE;
+
+    _pr_mutex_lock(&(loader->mutex));
+    {
+        if (wait)
+        {
+            while (!load->done)
+                _pr_condition_wait(&(loader->doneCondition), &(loader->mutex));
+        }
+        done = load->done;
+    }
+    _pr_mutex_unlock(&(loader->mutex));
+
+    return done;
+}
+
+void _pr_texture_loader_cancel(pr_texture_loader* loader, pr_texture_load* load)
+{
+    _pr_mutex_lock(&(loader->mutex));
+    {
+        if (load->done)
+            _pr_texture_load_delete(load);
+        else
+        {
+            // Remove load from the queue, if it has not been started yet
+            pr_texture_load* prev = NULL;
+            pr_texture_load* it = loader->first;
+
+            while (it != NULL && it != load)
+            {
+                prev = it;
+                it = it->next;
+            }
+
+            if (it != NULL)
+            {
+                if (prev != NULL)
+                    prev->next = load->next;
+                else
+                    loader->first = load->next;
+
+                if (loader->last == load)
+                    loader->last = prev;
+
+                _pr_texture_load_delete(load);
+            }
+            else
+                load->canceled = PR_TRUE;
+        }
+    }
+    _pr_mutex_unlock(&(loader->mutex));
+}
+
+void _pr_texture_load_delete(pr_texture_load* load)
+{
+    if (load != NULL)
+    {
+        _pr_texture_release(&(load->staging));
+        PR_FREE(load->filename);
+        PR_FREE(load);
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * texture_loader.h
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#ifndef PR_TEXTURE_LOADER_H
+#define PR_TEXTURE_LOADER_H
+
+
+#include "texture.h"
+#include "thread.h"
+
+
+/**
+Asynchronous image load of a texture. The loader thread decodes the image file and builds the texels
+into the staging texture, which is never used for drawing, until the texels are moved into the destination texture.
+*/
+typedef struct pr_texture_load
+{
+    pr_texture                  staging;        //!< Texture which receives the texels on the loader thread.
+    char*                       filename;
+    PRboolean                   dither;
+    PRboolean                   generateMips;
+    PRboolean                   tiled;          //!< State of PR_TEXTURE_TILING when the load was requested.
+    PRboolean                   succeeded;      //!< Specifies whether the staging texture could be built.
+    PRboolean                   done;           //!< Set by the loader thread when the staging texture is complete.
+    PRboolean                   canceled;       //!< Set when the load is no longer needed; the loader thread deletes it.
+    struct pr_texture_load*     next;
+}
+pr_texture_load;
+
+//! Single background thread which processes the asynchronous image loads in request order.
+typedef struct pr_texture_loader
+{
+    pr_thread           thread;
+    pr_mutex            mutex;
+    pr_condition        workCondition;  //!< Signaled when a new load has been queued.
+    pr_condition        doneCondition;  //!< Signaled when a load is done.
+    pr_texture_load*    first;          //!< Queue of loads which have not been started yet.
+    pr_texture_load*    last;
+    PRboolean           running;        //!< Specifies whether the loader thread has been started.
+    PRboolean           quit;
+}
+pr_texture_loader;
+
+
+//! Initializes the texture loader. The loader thread is started with the first load.
+void _pr_texture_loader_init(pr_texture_loader* loader);
+//! Terminates the loader thread (after the current load) and deletes all loads which have not been started yet.
+void _pr_texture_loader_release(pr_texture_loader* loader);
+
+/**
+Queues a new load of the specified image file. If the loader thread can not be started, the image is loaded on the calling thread.
+\param[in] tiled Specifies whether the texels are stored in tiles (see PR_TEXTURE_TILING).
+*/
+pr_texture_load* _pr_texture_loader_request(
+    pr_texture_loader* loader, const char* filename, PRboolean dither, PRboolean generateMips, PRboolean tiled
+);
+
+//! Returns PR_TRUE if the specified load is done. If 'wait' is PR_TRUE, this blocks until the load is done.
+PRboolean _pr_texture_loader_poll(pr_texture_loader* loader, pr_texture_load* load, PRboolean wait);
+
+//! Cancels the specified load. Loads which are still in progress are deleted by the loader thread when they are done.
+void _pr_texture_loader_cancel(pr_texture_loader* loader, pr_texture_load* load);
+
+//! Deletes the specified load, which must not be referenced by the loader (i.e. it must be done).
+void _pr_texture_load_delete(pr_texture_load* load);
+
+
+#endif
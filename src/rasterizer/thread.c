@@ -0,0 +1,155 @@
+/*
+ * thread.c
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#include "thread.h"
+
+#ifndef _WIN32
+#   include <unistd.h>
+#endif
+
+
+// --- internals --- //
+
+#ifdef _WIN32
+
+static DWORD WINAPI _thread_entry(LPVOID param)
+{
+    pr_thread* thread = (pr_thread*)param;
+    thread->proc(thread->userData);
+    return 0;
+}
+
+#else
+
+static void* _thread_entry(void* param)
+{
+    pr_thread* thread = (pr_thread*)param;
+    thread->proc(thread->userData);
+    return NULL;
+}
+
+#endif
+
+// --- threads --- //
+
+PRboolean _pr_thread_start(pr_thread* thread, PR_THREAD_PROC proc, PRvoid* userData)
+{
+    thread->proc        = proc;
+    thread->userData    = userData;
+
+    #ifdef _WIN32
+    thread->handle = CreateThread(NULL, 0, _thread_entry, thread, 0, NULL);
+    return thread->handle != NULL ? PR_TRUE : PR_FALSE;
+    #else
+    return pthread_create(&(thread->handle), NULL, _thread_entry, thread) == 0 ? PR_TRUE : PR_FALSE;
+    #endif
+}
+
+void _pr_thread_join(pr_thread* thread)
+{
+    #ifdef _WIN32
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    #else
+    pthread_join(thread->handle, NULL);
+    #endif
+}
+
+PRuint _pr_thread_num_processors()
+{
+    #ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (PRuint)info.dwNumberOfProcessors : 1;
+    #else
+    long num = sysconf(_SC_NPROCESSORS_ONLN);
+    return num > 0 ? (PRuint)num : 1;
+    #endif
+}
+
+// --- mutex --- //
+
+void _pr_mutex_init(pr_mutex* mutex)
+{
+    #ifdef _WIN32
+    InitializeCriticalSection(&(mutex->handle));
+    #else
+    pthread_mutex_init(&(mutex->handle), NULL);
+    #endif
+}
+
+void _pr_mutex_release(pr_mutex* mutex)
+{
+    #ifdef _WIN32
+    DeleteCriticalSection(&(mutex->handle));
+    #else
+    pthread_mutex_destroy(&(mutex->handle));
+    #endif
+}
+
+void _pr_mutex_lock(pr_mutex* mutex)
+{
+    #ifdef _WIN32
+    EnterCriticalSection(&(mutex->handle));
+    #else
+    pthread_mutex_lock(&(mutex->handle));
+    #endif
+}
+
+void _pr_mutex_unlock(pr_mutex* mutex)
+{
+    #ifdef _WIN32
+    LeaveCriticalSection(&(mutex->handle));
+    #else
+    pthread_mutex_unlock(&(mutex->handle));
+    #endif
+}
+
+// --- condition --- //
+
+void _pr_condition_init(pr_condition* condition)
+{
+    #ifdef _WIN32
+    InitializeConditionVariable(&(condition->handle));
+    #else
+    pthread_cond_init(&(condition->handle), NULL);
+    #endif
+}
+
+void _pr_condition_release(pr_condition* condition)
+{
+    #ifndef _WIN32
+    pthread_cond_destroy(&(condition->handle));
+    #endif
+}
+
+void _pr_condition_wait(pr_condition* condition, pr_mutex* mutex)
+{
+    #ifdef _WIN32
+    SleepConditionVariableCS(&(condition->handle), &(mutex->handle), INFINITE);
+    #else
+    pthread_cond_wait(&(condition->handle), &(mutex->handle));
+    #endif
+}
+
+void _pr_condition_signal(pr_condition* condition)
+{
+    #ifdef _WIN32
+    WakeConditionVariable(&(condition->handle));
+    #else
+    pthread_cond_signal(&(condition->handle));
+    #endif
+}
+
+void _pr_condition_broadcast(pr_condition* condition)
+{
+    #ifdef _WIN32
+    WakeAllConditionVariable(&(condition->handle));
+    #else
+    pthread_cond_broadcast(&(condition->handle));
+    #endif
+}
@@ -0,0 +1,100 @@
+/*
+ * thread.h
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#ifndef PR_THREAD_H
+#define PR_THREAD_H
+
+
+#include "types.h"
+
+#ifdef _WIN32
+#   include <Windows.h>
+#else
+#   include <pthread.h>
+#endif
+
+
+typedef void (*PR_THREAD_PROC)(PRvoid* userData);
+
+//! Native thread wrapper.
+typedef struct pr_thread
+{
+    #ifdef _WIN32
+    HANDLE              handle;
+    #else
+    pthread_t           handle;
+    #endif
+    PR_THREAD_PROC      proc;
+    PRvoid*             userData;
+}
+pr_thread;
+
+//! Native mutex wrapper.
+typedef struct pr_mutex
+{
+    #ifdef _WIN32
+    CRITICAL_SECTION    handle;
+    #else
+    pthread_mutex_t     handle;
+    #endif
+}
+pr_mutex;
+
+//! Native condition variable wrapper.
+typedef struct pr_condition
+{
+    #ifdef _WIN32
+    CONDITION_VARIABLE  handle;
+    #else
+    pthread_cond_t      handle;
+    #endif
+}
+pr_condition;
+
+
+//! Starts the specified thread. Returns PR_FALSE if the thread could not be created.
+PRboolean _pr_thread_start(pr_thread* thread, PR_THREAD_PROC proc, PRvoid* userData);
+//! Waits until the specified thread has terminated.
+void _pr_thread_join(pr_thread* thread);
+
+//! Returns the number of logical processors (at least 1).
+PRuint _pr_thread_num_processors();
+
+void _pr_mutex_init(pr_mutex* mutex);
+void _pr_mutex_release(pr_mutex* mutex);
+void _pr_mutex_lock(pr_mutex* mutex);
+void _pr_mutex_unlock(pr_mutex* mutex);
+
+void _pr_condition_init(pr_condition* condition);
+void _pr_condition_release(pr_condition* condition);
+//! Atomically unlocks the mutex and waits for the condition. The mutex is locked again when this function returns.
+void _pr_condition_wait(pr_condition* condition, pr_mutex* mutex);
+void _pr_condition_signal(pr_condition* condition);
+void _pr_condition_broadcast(pr_condition* condition);
+
+//! Atomically loads the specified value with relaxed memory ordering (i.e. without synchronization with other memory accesses).
+PR_INLINE PRuint _pr_atomic_load_relaxed(volatile PRuint* value)
+{
+    #ifdef _WIN32
+    return *value; // Aligned 32-bit reads are atomic on all Windows platforms
+    #else
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+    #endif
+}
+
+//! Atomically stores the specified value with relaxed memory ordering (i.e. without synchronization with other memory accesses).
+PR_INLINE void _pr_atomic_store_relaxed(volatile PRuint* value, PRuint newValue)
+{
+    #ifdef _WIN32
+    *value = newValue; // Aligned 32-bit writes are atomic on all Windows platforms
+    #else
+    __atomic_store_n(value, newValue, __ATOMIC_RELAXED);
+    #endif
+}
+
+
+#endif
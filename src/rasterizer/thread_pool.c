@@ -0,0 +1,183 @@
+/*
+ * thread_pool.c
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#include "thread_pool.h"
+#include "helper.h"
+
+#include <stdlib.h>
+
+
+// --- internals --- //
+
+typedef struct pr_worker_param
+{
+    pr_thread_pool* threadPool;
+    PRuint          worker;
+}
+pr_worker_param;
+
+// Processes tasks of the current job until there are no tasks left. The mutex must be locked!
+static void _thread_pool_run_tasks(pr_thread_pool* threadPool, PRuint worker)
+{
+    while (threadPool->nextTask < threadPool->numTasks)
+    {
+        PRuint task = threadPool->nextTask++;
+
+        _pr_mutex_unlock(&(threadPool->mutex));
+        {
+            threadPool->proc(task, worker, threadPool->userData);
+        }
+        _pr_mutex_lock(&(threadPool->mutex));
+    }
+}
+
+static void _thread_pool_worker(PRvoid* userData)
+{
+    pr_worker_param* param = (pr_worker_param*)userData;
+    pr_thread_pool* threadPool = param->threadPool;
+    const PRuint worker = param->worker;
+
+    PR_FREE(param);
+
+    // Start with the initial generation, in case a job has been dispatched before this thread was running
+    PRuint generation = 0;
+
+    _pr_mutex_lock(&(threadPool->mutex));
+
+    while (1)
+    {
+        // Wait for next job
+        while (!threadPool->quit && threadPool->generation == generation)
+            _pr_condition_wait(&(threadPool->workCondition), &(threadPool->mutex));
+
+        if (threadPool->quit)
+            break;
+
+        generation = threadPool->generation;
+
+        _thread_pool_run_tasks(threadPool, worker);
+
+        // Notify dispatcher when the last worker is done
+        if (--threadPool->numBusyWorkers == 0)
+            _pr_condition_signal(&(threadPool->doneCondition));
+    }
+
+    _pr_mutex_unlock(&(threadPool->mutex));
+}
+
+// --- interface --- //
+
+void _pr_thread_pool_init(pr_thread_pool* threadPool, PRuint numWorkers)
+{
+    threadPool->numWorkers      = 0;
+    threadPool->workers         = NULL;
+    threadPool->proc            = NULL;
+    threadPool->userData        = NULL;
+    threadPool->numTasks        = 0;
+    threadPool->nextTask        = 0;
+    threadPool->numBusyWorkers  = 0;
+    threadPool->generation      = 0;
+    threadPool->quit            = PR_FALSE;
+
+    _pr_mutex_init(&(threadPool->mutex));
+    _pr_condition_init(&(threadPool->workCondition));
+    _pr_condition_init(&(threadPool->doneCondition));
+
+    if (numWorkers == 0)
+        return;
+
+    // Start worker threads
+    threadPool->workers = PR_CALLOC(pr_thread, numWorkers);
+
+    for (PRuint i = 0; i < numWorkers; ++i)
+    {
+        pr_worker_param* param = PR_MALLOC(pr_worker_param);
+        param->threadPool   = threadPool;
+        param->worker       = i + 1;
+
+        if (!_pr_thread_start(&(threadPool->workers[i]), _thread_pool_worker, param))
+        {
+            PR_FREE(param);
+            break;
+        }
+
+        ++threadPool->numWorkers;
+    }
+}
+
+void _pr_thread_pool_release(pr_thread_pool* threadPool)
+{
+    // Terminate worker threads
+    _pr_mutex_lock(&(threadPool->mutex));
+    {
+        threadPool->quit = PR_TRUE;
+        _pr_condition_broadcast(&(threadPool->workCondition));
+    }
+    _pr_mutex_unlock(&(threadPool->mutex));
+
+    for (PRuint i = 0; i < threadPool->numWorkers; ++i)
+        _pr_thread_join(&(threadPool->workers[i]));
+
+    PR_FREE(threadPool->workers);
+    threadPool->numWorkers = 0;
+
+    _pr_condition_release(&(threadPool->doneCondition));
+    _pr_condition_release(&(threadPool->workCondition));
+    _pr_mutex_release(&(threadPool->mutex));
+}
+
+void _pr_thread_pool_dispatch(pr_thread_pool* threadPool, PRuint numTasks, PR_TASK_PROC proc, PRvoid* userData)
+{
+    if (numTasks == 0)
+        return;
+
+    // Run all tasks on the calling thread if there is nothing to share
+    if (threadPool->numWorkers == 0 || numTasks == 1)
+    {
+        for (PRuint task = 0; task < numTasks; ++task)
+            proc(task, 0, userData);
+        return;
+    }
+
+    PRboolean busy = PR_FALSE;
+
+    _pr_mutex_lock(&(threadPool->mutex));
+    {
+        // Workers might still be busy with the job of another context
+        busy = (threadPool->proc != NULL);
+
+        if (!busy)
+        {
+            // Publish new job
+            threadPool->proc            = proc;
+            threadPool->userData        = userData;
+            threadPool->numTasks        = numTasks;
+            threadPool->nextTask        = 0;
+            threadPool->numBusyWorkers  = threadPool->numWorkers;
+            ++threadPool->generation;
+
+            _pr_condition_broadcast(&(threadPool->workCondition));
+
+            // Take part in processing the tasks
+            _thread_pool_run_tasks(threadPool, 0);
+
+            // Wait until all workers are done
+            while (threadPool->numBusyWorkers > 0)
+                _pr_condition_wait(&(threadPool->doneCondition), &(threadPool->mutex));
+
+            threadPool->proc = NULL;
+        }
+    }
+    _pr_mutex_unlock(&(threadPool->mutex));
+
+    // Otherwise run all tasks on the calling thread
+    if (busy)
+    {
+        for (PRuint task = 0; task < numTasks; ++task)
+            proc(task, 0, userData);
+    }
+}
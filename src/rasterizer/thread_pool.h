@@ -0,0 +1,57 @@
+/*
+ * thread_pool.h
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#ifndef PR_THREAD_POOL_H
+#define PR_THREAD_POOL_H
+
+
+#include "thread.h"
+
+
+/**
+Task procedure for the thread pool.
+\param[in] task Specifies the task index in the range [0, numTasks).
+\param[in] worker Specifies the worker index in the range [0, numWorkers]. The calling thread is always worker 0.
+\param[in] userData Raw pointer to the user data which was passed to '_pr_thread_pool_dispatch'.
+*/
+typedef void (*PR_TASK_PROC)(PRuint task, PRuint worker, PRvoid* userData);
+
+typedef struct pr_thread_pool
+{
+    PRuint          numWorkers;     //!< Number of worker threads (without the calling thread).
+    pr_thread*      workers;
+
+    pr_mutex        mutex;
+    pr_condition    workCondition;  //!< Signaled when a new job has been dispatched.
+    pr_condition    doneCondition;  //!< Signaled when the last worker has finished the current job.
+
+    // Current job
+    PR_TASK_PROC    proc;           //!< Task procedure of the current job, or null if the workers are idle.
+    PRvoid*         userData;
+    PRuint          numTasks;
+    PRuint          nextTask;
+    PRuint          numBusyWorkers;
+    PRuint          generation;     //!< Incremented with each dispatch, so that workers don't run a job twice.
+    PRboolean       quit;
+}
+pr_thread_pool;
+
+
+//! Initializes the thread pool with the specified number of worker threads. This can be zero.
+void _pr_thread_pool_init(pr_thread_pool* threadPool, PRuint numWorkers);
+//! Terminates all worker threads of the specified thread pool.
+void _pr_thread_pool_release(pr_thread_pool* threadPool);
+
+/**
+Runs the task procedure for all tasks in the range [0, numTasks) and returns when all tasks are done.
+The calling thread takes part in processing the tasks.
+If the workers are still busy with a job from another thread, all tasks are processed on the calling thread (as worker 0).
+*/
+void _pr_thread_pool_dispatch(pr_thread_pool* threadPool, PRuint numTasks, PR_TASK_PROC proc, PRvoid* userData);
+
+
+#endif
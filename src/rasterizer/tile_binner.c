@@ -0,0 +1,233 @@
+/*
+ * tile_binner.c
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#include "tile_binner.h"
+#include "ext_math.h"
+#include "helper.h"
+#include "static_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+// --- internals --- //
+
+// Returns the new capacity for a dynamic array which must hold at least 'required' elements.
+static PRuint _grow_capacity(PRuint capacity, PRuint required)
+{
+    if (capacity < 64)
+        capacity = 64;
+    while (capacity < required)
+        capacity *= 2;
+    return capacity;
+}
+
+static void _tile_binner_setup_tiles(pr_tile_binner* binner, pr_framebuffer* frameBuffer, const pr_rect* clipRect)
+{
+    binner->frameBuffer = frameBuffer;
+    binner->clipRect    = *clipRect;
+    binner->numTilesX   = (frameBuffer->width + PR_TILE_SIZE - 1) / PR_TILE_SIZE;
+    binner->numTilesY   = (frameBuffer->height + PR_TILE_SIZE - 1) / PR_TILE_SIZE;
+
+    const PRuint numTiles = binner->numTilesX * binner->numTilesY;
+
+    if (binner->binCapacity < numTiles)
+    {
+        // Reallocate tile bins (all bins are empty at this point)
+        for (PRuint i = 0; i < binner->binCapacity; ++i)
+            PR_FREE(binner->bins[i].polygons);
+
+        PR_FREE(binner->bins);
+        PR_FREE(binner->activeTiles);
+
+        binner->bins        = PR_CALLOC(pr_tile_bin, numTiles);
+        binner->activeTiles = PR_CALLOC(PRuint, numTiles);
+        binner->binCapacity = numTiles;
+    }
+}
+
+static void _tile_binner_setup_workers(pr_tile_binner* binner, PRuint numWorkers, PRuint height)
+{
+    if (binner->numWorkers < numWorkers || binner->scanlineCapacity < height)
+    {
+        // Release previous worker scratch buffers
+        for (PRuint i = 0; i < binner->numWorkers; ++i)
+        {
+            PR_FREE(binner->workers[i].scanlinesStart);
+            PR_FREE(binner->workers[i].scanlinesEnd);
+        }
+        PR_FREE(binner->workers);
+
+        // Allocate new scratch buffers for each worker
+        binner->numWorkers          = PR_MAX(binner->numWorkers, numWorkers);
+        binner->scanlineCapacity    = PR_MAX(binner->scanlineCapacity, height);
+        binner->workers             = PR_CALLOC(pr_tile_worker, binner->numWorkers);
+
+        for (PRuint i = 0; i < binner->numWorkers; ++i)
+        {
+            binner->workers[i].scanlinesStart   = PR_CALLOC(pr_scaline_side, binner->scanlineCapacity);
+            binner->workers[i].scanlinesEnd     = PR_CALLOC(pr_scaline_side, binner->scanlineCapacity);
+        }
+    }
+}
+
+static void _tile_bin_append(pr_tile_binner* binner, PRuint tile, PRuint polygon)
+{
+    pr_tile_bin* bin = &(binner->bins[tile]);
+
+    if (bin->numPolygons == 0)
+        binner->activeTiles[binner->numActiveTiles++] = tile;
+
+    if (bin->numPolygons == bin->capacity)
+    {
+        bin->capacity = _grow_capacity(bin->capacity, bin->numPolygons + 1);
+        bin->polygons = (PRuint*)realloc(bin->polygons, sizeof(PRuint)*bin->capacity);
+    }
+
+    bin->polygons[bin->numPolygons++] = polygon;
+}
+
+static void _tile_binner_raster_task(PRuint task, PRuint worker, PRvoid* userData)
+{
+    pr_tile_binner* binner = (pr_tile_binner*)userData;
+    pr_framebuffer* frameBuffer = binner->frameBuffer;
+
+    // Get tile rectangle
+    const PRuint tile = binner->activeTiles[task];
+    const pr_tile_bin* bin = &(binner->bins[tile]);
+
+    pr_rect tileRect;
+    tileRect.left   = (PRint)((tile % binner->numTilesX) * PR_TILE_SIZE);
+    tileRect.top    = (PRint)((tile / binner->numTilesX) * PR_TILE_SIZE);
+    tileRect.right  = PR_MIN(tileRect.left + PR_TILE_SIZE, (PRint)frameBuffer->width) - 1;
+    tileRect.bottom = PR_MIN(tileRect.top + PR_TILE_SIZE, (PRint)frameBuffer->height) - 1;
+
+    // Scissor tile against the clipping rectangle
+    PR_CLAMP_LARGEST(tileRect.left, binner->clipRect.left);
+    PR_CLAMP_LARGEST(tileRect.top, binner->clipRect.top);
+    PR_CLAMP_SMALLEST(tileRect.right, binner->clipRect.right);
+    PR_CLAMP_SMALLEST(tileRect.bottom, binner->clipRect.bottom);
+
+    // Rasterize all polygons of this tile in submission order
+    for (PRuint i = 0; i < bin->numPolygons; ++i)
+    {
+        binner->rasterProc(
+            frameBuffer,
+            &(binner->workers[worker]),
+            binner->vertices,
+            &(binner->polygons[bin->polygons[i]]),
+            &tileRect
+        );
+    }
+}
+
+// --- interface --- //
+
+void _pr_tile_binner_init(pr_tile_binner* binner)
+{
+    memset(binner, 0, sizeof(pr_tile_binner));
+}
+
+void _pr_tile_binner_release(pr_tile_binner* binner)
+{
+    for (PRuint i = 0; i < binner->binCapacity; ++i)
+        PR_FREE(binner->bins[i].polygons);
+
+    for (PRuint i = 0; i < binner->numWorkers; ++i)
+    {
+        PR_FREE(binner->workers[i].scanlinesStart);
+        PR_FREE(binner->workers[i].scanlinesEnd);
+    }
+
+    PR_FREE(binner->vertices);
+    PR_FREE(binner->polygons);
+    PR_FREE(binner->bins);
+    PR_FREE(binner->activeTiles);
+    PR_FREE(binner->workers);
+
+    memset(binner, 0, sizeof(pr_tile_binner));
+}
+
+void _pr_tile_binner_add_polygon(
+    pr_tile_binner* binner, pr_framebuffer* frameBuffer, const pr_rect* clipRect,
+    const pr_raster_vertex* vertices, PRuint numVertices,
+    const pr_texture_sampler* sampler)
+{
+    if (binner->numPolygons == 0)
+        _tile_binner_setup_tiles(binner, frameBuffer, clipRect);
+
+    // Copy raster vertices
+    if (binner->numVertices + numVertices > binner->vertexCapacity)
+    {
+        binner->vertexCapacity = _grow_capacity(binner->vertexCapacity, binner->numVertices + numVertices);
+        binner->vertices = (pr_raster_vertex*)realloc(binner->vertices, sizeof(pr_raster_vertex)*binner->vertexCapacity);
+    }
+
+    memcpy(binner->vertices + binner->numVertices, vertices, sizeof(pr_raster_vertex)*numVertices);
+
+    // Store polygon
+    if (binner->numPolygons == binner->polygonCapacity)
+    {
+        binner->polygonCapacity = _grow_capacity(binner->polygonCapacity, binner->numPolygons + 1);
+        binner->polygons = (pr_binned_polygon*)realloc(binner->polygons, sizeof(pr_binned_polygon)*binner->polygonCapacity);
+    }
+
+    const PRuint polygonIndex = binner->numPolygons++;
+    pr_binned_polygon* polygon = &(binner->polygons[polygonIndex]);
+
+    polygon->firstVertex    = binner->numVertices;
+    polygon->numVertices    = numVertices;
+    polygon->sampler        = *sampler;
+
+    binner->numVertices += numVertices;
+
+    // Find bounding box
+    PRint xMin = vertices[0].x, xMax = vertices[0].x;
+    PRint yMin = vertices[0].y, yMax = vertices[0].y;
+
+    for (PRuint i = 1; i < numVertices; ++i)
+    {
+        PR_CLAMP_SMALLEST(xMin, vertices[i].x);
+        PR_CLAMP_LARGEST(xMax, vertices[i].x);
+        PR_CLAMP_SMALLEST(yMin, vertices[i].y);
+        PR_CLAMP_LARGEST(yMax, vertices[i].y);
+    }
+
+    // Append polygon to all overlapped tiles inside the clipping rectangle (bounding box is in sub-pixel coordinates)
+    const PRint txMin = PR_CLAMP(PR_SUBPIXEL_FLOOR(xMin), clipRect->left, clipRect->right) / PR_TILE_SIZE;
+    const PRint txMax = PR_CLAMP(PR_SUBPIXEL_FLOOR(xMax), clipRect->left, clipRect->right) / PR_TILE_SIZE;
+    const PRint tyMin = PR_CLAMP(PR_SUBPIXEL_FLOOR(yMin), clipRect->top, clipRect->bottom) / PR_TILE_SIZE;
+    const PRint tyMax = PR_CLAMP(PR_SUBPIXEL_FLOOR(yMax), clipRect->top, clipRect->bottom) / PR_TILE_SIZE;
+
+    for (PRint ty = tyMin; ty <= tyMax; ++ty)
+    {
+        for (PRint tx = txMin; tx <= txMax; ++tx)
+            _tile_bin_append(binner, (PRuint)ty * binner->numTilesX + (PRuint)tx, polygonIndex);
+    }
+}
+
+void _pr_tile_binner_flush(pr_tile_binner* binner, pr_thread_pool* threadPool, PR_TILE_RASTER_PROC rasterProc)
+{
+    if (binner->numPolygons == 0)
+        return;
+
+    // Rasterize all active tiles in parallel
+    _tile_binner_setup_workers(binner, threadPool->numWorkers + 1, binner->frameBuffer->height);
+
+    binner->rasterProc = rasterProc;
+
+    _pr_thread_pool_dispatch(threadPool, binner->numActiveTiles, _tile_binner_raster_task, binner);
+
+    // Reset binner for the next polygons
+    for (PRuint i = 0; i < binner->numActiveTiles; ++i)
+        binner->bins[binner->activeTiles[i]].numPolygons = 0;
+
+    binner->numActiveTiles  = 0;
+    binner->numPolygons     = 0;
+    binner->numVertices     = 0;
+    binner->frameBuffer     = NULL;
+}
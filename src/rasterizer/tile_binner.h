@@ -0,0 +1,103 @@
+/*
+ * tile_binner.h
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#ifndef PR_TILE_BINNER_H
+#define PR_TILE_BINNER_H
+
+
+#include "framebuffer.h"
+#include "raster_vertex.h"
+#include "thread_pool.h"
+#include "texture.h"
+#include "rect.h"
+
+
+//! Polygon which has already been clipped and projected, and is waiting to be rasterized tile by tile.
+typedef struct pr_binned_polygon
+{
+    PRuint              firstVertex;    //!< Index of the first raster vertex in the binner's vertex array.
+    PRuint              numVertices;    //!< Number of raster vertices.
+    pr_texture_sampler  sampler;        //!< Texture sampling state.
+}
+pr_binned_polygon;
+
+//! List of polygon indices which overlap a single screen tile.
+typedef struct pr_tile_bin
+{
+    PRuint*     polygons;
+    PRuint      numPolygons;
+    PRuint      capacity;
+}
+pr_tile_bin;
+
+//! Scratch buffers of a single worker. Each worker rasterizes into its own scanline sides.
+typedef struct pr_tile_worker
+{
+    pr_scaline_side*    scanlinesStart;
+    pr_scaline_side*    scanlinesEnd;
+}
+pr_tile_worker;
+
+//! Rasterizes a binned polygon into the specified tile rectangle.
+typedef void (*PR_TILE_RASTER_PROC)(
+    pr_framebuffer* frameBuffer, pr_tile_worker* worker,
+    const pr_raster_vertex* vertices, const pr_binned_polygon* polygon, const pr_rect* tileRect
+);
+
+/**
+Sort-middle tile binner. Polygons are binned into screen tiles of size PR_TILE_SIZE
+after clipping and projection, and the tiles are rasterized in parallel when the binner is flushed.
+Each tile is processed by a single worker, so the framebuffer memory of a tile stays in the worker's cache.
+*/
+typedef struct pr_tile_binner
+{
+    pr_framebuffer*     frameBuffer;        //!< Framebuffer the current polygons are binned for.
+    pr_rect             clipRect;           //!< Clipping rectangle of the current polygons.
+
+    pr_raster_vertex*   vertices;
+    PRuint              numVertices;
+    PRuint              vertexCapacity;
+
+    pr_binned_polygon*  polygons;
+    PRuint              numPolygons;
+    PRuint              polygonCapacity;
+
+    pr_tile_bin*        bins;
+    PRuint              numTilesX;
+    PRuint              numTilesY;
+    PRuint              binCapacity;
+
+    PRuint*             activeTiles;        //!< Indices of all tiles with at least one polygon.
+    PRuint              numActiveTiles;
+
+    pr_tile_worker*     workers;
+    PRuint              numWorkers;
+    PRuint              scanlineCapacity;
+
+    PR_TILE_RASTER_PROC rasterProc;         //!< Raster procedure of the current flush.
+}
+pr_tile_binner;
+
+
+void _pr_tile_binner_init(pr_tile_binner* binner);
+void _pr_tile_binner_release(pr_tile_binner* binner);
+
+/**
+Bins the specified polygon into all tiles its bounding box overlaps. The raster vertices are copied.
+The polygon may exceed the clipping rectangle, the tiles are scissored against it.
+The clipping rectangle must be the same for all polygons until the binner is flushed.
+*/
+void _pr_tile_binner_add_polygon(
+    pr_tile_binner* binner, pr_framebuffer* frameBuffer, const pr_rect* clipRect,
+    const pr_raster_vertex* vertices, PRuint numVertices, const pr_texture_sampler* sampler
+);
+
+//! Rasterizes all binned polygons on the specified thread pool and resets the binner.
+void _pr_tile_binner_flush(pr_tile_binner* binner, pr_thread_pool* threadPool, PR_TILE_RASTER_PROC rasterProc);
+
+
+#endif
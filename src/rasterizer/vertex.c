@@ -10,8 +10,110 @@
 #include <string.h>
 
 
+// --- internals --- //
+
+#ifdef PR_PACKED_VERTICES
+
+typedef union pr_float_bits
+{
+    PRfloat f;
+    PRuint  u;
+}
+pr_float_bits;
+
+#endif
+
+// --- interface --- //
+
 void _pr_vertex_init(pr_vertex* vertex)
 {
     if (vertex != NULL)
         memset(vertex, 0, sizeof(pr_vertex));
 }
+
+#ifdef PR_PACKED_VERTICES
+
+PRushort _pr_float_to_half(PRfloat value)
+{
+    pr_float_bits bits;
+    bits.f = value;
+
+    const PRuint sign = (bits.u >> 16) & 0x8000;
+    const PRuint absBits = bits.u & 0x7fffffff;
+
+    // NaN and infinity
+    if (absBits >= 0x7f800000)
+        return (PRushort)(sign | 0x7c00 | (absBits > 0x7f800000 ? 0x0200 : 0));
+
+    // Overflow to infinity (65520 is the first value which rounds above the largest half)
+    if (absBits >= 0x477ff000)
+        return (PRushort)(sign | 0x7c00);
+
+    // Underflow to denormalized half or zero
+    if (absBits < 0x38800000)
+    {
+        if (absBits < 0x33000000)
+            return (PRushort)sign;
+
+        const PRuint mantissa = (absBits & 0x007fffff) | 0x00800000;
+        const PRuint shift = 126 - (absBits >> 23);
+        const PRuint half = mantissa >> shift;
+        const PRuint rest = mantissa & ((1u << shift) - 1);
+        const PRuint mid = 1u << (shift - 1);
+
+        return (PRushort)(sign | (half + (rest > mid || (rest == mid && (half & 1)))));
+    }
+
+    // Normalized half: rebias exponent and round mantissa to nearest even
+    const PRuint half = (absBits - 0x38000000) >> 13;
+    const PRuint rest = absBits & 0x1fff;
+
+    return (PRushort)(sign | (half + (rest > 0x1000 || (rest == 0x1000 && (half & 1)))));
+}
+
+PRfloat _pr_half_to_float(PRushort value)
+{
+    pr_float_bits bits;
+
+    const PRuint sign = ((PRuint)value & 0x8000) << 16;
+    const PRuint exponent = ((PRuint)value >> 10) & 0x1f;
+    const PRuint mantissa = (PRuint)value & 0x03ff;
+
+    if (exponent == 0x1f)
+        bits.u = sign | 0x7f800000 | (mantissa << 13);
+    else if (exponent != 0)
+        bits.u = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    else if (mantissa != 0)
+    {
+        // Denormalized half (mantissa * 2^-24)
+        bits.f = (PRfloat)mantissa * (1.0f / 16777216.0f);
+        bits.u |= sign;
+    }
+    else
+        bits.u = sign;
+
+    return bits.f;
+}
+
+#endif
+
+void _pr_vertex_unpack(pr_float_vertex* dst, const pr_vertex* src, PRuint numVertices)
+{
+    #ifdef PR_PACKED_VERTICES
+
+    for (PRuint i = 0; i < numVertices; ++i)
+    {
+        dst[i].coord.x      = _pr_half_to_float(src[i].coord[0]);
+        dst[i].coord.y      = _pr_half_to_float(src[i].coord[1]);
+        dst[i].coord.z      = _pr_half_to_float(src[i].coord[2]);
+        dst[i].coord.w      = _pr_half_to_float(src[i].coord[3]);
+        dst[i].texCoord.x   = _pr_half_to_float(src[i].texCoord[0]);
+        dst[i].texCoord.y   = _pr_half_to_float(src[i].texCoord[1]);
+    }
+
+    #else
+
+    memcpy(dst, src, sizeof(pr_vertex)*numVertices);
+
+    #endif
+}
@@ -16,24 +16,70 @@
 #include "static_config.h"
 
 
-//! Simple vertex with 3D coordinate and 2D texture-coordinate.
-typedef struct pr_vertex
+//! Vertex with 3D coordinate and 2D texture-coordinate as 32-bit floats.
+typedef struct pr_float_vertex
 {
-    // Before vertex processing
     pr_vector4 coord;       //!< Original coordinate.
     pr_vector2 texCoord;    //!< Texture-coordinate.
+}
+pr_float_vertex;
 
-    #if 1//!remove!
-    pr_vector4 ndc;         //!< Normalized device coordinate.
-    #ifdef PR_PERSPECTIVE_CORRECTED
-    pr_vector2 invTexCoord; //!< Inverse texture-coordinates.
-    #endif
-    #endif
+#ifdef PR_PACKED_VERTICES
+
+/**
+Packed vertex as it is stored in a vertex buffer. Coordinate and texture-coordinate are 16-bit floats (half precision),
+which are unpacked to a 'pr_float_vertex' right before the vertex transformation.
+*/
+typedef struct pr_vertex
+{
+    PRushort coord[4];      //!< Original coordinate.
+    PRushort texCoord[2];   //!< Texture-coordinate.
 }
 pr_vertex;
 
+//! Converts the specified 32-bit float into a 16-bit float (rounded to nearest even).
+PRushort _pr_float_to_half(PRfloat value);
+//! Converts the specified 16-bit float into a 32-bit float.
+PRfloat _pr_half_to_float(PRushort value);
+
+#else
+
+//! Vertex as it is stored in a vertex buffer. Transformed vertices are never written back into a vertex buffer.
+typedef pr_float_vertex pr_vertex;
+
+#endif
+
 
 void _pr_vertex_init(pr_vertex* vertex);
 
+//! Unpacks the specified vertices into 32-bit float vertices.
+void _pr_vertex_unpack(pr_float_vertex* dst, const pr_vertex* src, PRuint numVertices);
+
+PR_INLINE void _pr_vertex_set_coord(pr_vertex* vertex, PRfloat x, PRfloat y, PRfloat z, PRfloat w)
+{
+    #ifdef PR_PACKED_VERTICES
+    vertex->coord[0] = _pr_float_to_half(x);
+    vertex->coord[1] = _pr_float_to_half(y);
+    vertex->coord[2] = _pr_float_to_half(z);
+    vertex->coord[3] = _pr_float_to_half(w);
+    #else
+    vertex->coord.x = x;
+    vertex->coord.y = y;
+    vertex->coord.z = z;
+    vertex->coord.w = w;
+    #endif
+}
+
+PR_INLINE void _pr_vertex_set_texcoord(pr_vertex* vertex, PRfloat u, PRfloat v)
+{
+    #ifdef PR_PACKED_VERTICES
+    vertex->texCoord[0] = _pr_float_to_half(u);
+    vertex->texCoord[1] = _pr_float_to_half(v);
+    #else
+    vertex->texCoord.x = u;
+    vertex->texCoord.y = v;
+    #endif
+}
+
 
 #endif
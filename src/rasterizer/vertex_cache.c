@@ -0,0 +1,146 @@
+/*
+ * vertex_cache.c
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#include "vertex_cache.h"
+#include "vertex_transform.h"
+#include "helper.h"
+#include "enums.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+// --- internals --- //
+
+static void _vertex_cache_reserve(pr_vertex_cache* vertexCache, PRuint numVertices)
+{
+    if (vertexCache->capacity < numVertices)
+    {
+        PR_FREE(vertexCache->vertices);
+        PR_FREE(vertexCache->screenVertices);
+        PR_FREE(vertexCache->referenced);
+
+        vertexCache->vertices       = PR_CALLOC(pr_clip_vertex, numVertices);
+        vertexCache->screenVertices = PR_CALLOC(pr_clip_vertex, numVertices);
+        vertexCache->referenced     = PR_CALLOC(PRubyte, numVertices);
+        vertexCache->capacity       = numVertices;
+    }
+}
+
+// Returns the 32-bit indices of the specified index range, which are only converted for 8- and 16-bit index buffers.
+static const PRuint* _vertex_cache_fetch_indices(
+    pr_vertex_cache* vertexCache, const pr_indexbuffer* indexBuffer, PRsizei firstIndex, PRsizei numIndices)
+{
+    if (indexBuffer->format == PR_UINT)
+        return (const PRuint*)indexBuffer->indices + firstIndex;
+
+    if (vertexCache->indexCapacity < (PRuint)numIndices)
+    {
+        PR_FREE(vertexCache->unpackedIndices);
+        vertexCache->unpackedIndices    = PR_CALLOC(PRuint, numIndices);
+        vertexCache->indexCapacity      = (PRuint)numIndices;
+    }
+
+    _pr_indexbuffer_unpack(indexBuffer, firstIndex, numIndices, vertexCache->unpackedIndices);
+
+    return vertexCache->unpackedIndices;
+}
+
+// --- interface --- //
+
+void _pr_vertex_cache_init(pr_vertex_cache* vertexCache)
+{
+    memset(vertexCache, 0, sizeof(pr_vertex_cache));
+}
+
+void _pr_vertex_cache_release(pr_vertex_cache* vertexCache)
+{
+    PR_FREE(vertexCache->vertices);
+    PR_FREE(vertexCache->screenVertices);
+    PR_FREE(vertexCache->referenced);
+    PR_FREE(vertexCache->unpackedIndices);
+
+    memset(vertexCache, 0, sizeof(pr_vertex_cache));
+}
+
+PRboolean _pr_vertex_cache_transform(
+    pr_vertex_cache* vertexCache, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer, PRsizei firstIndex, PRsizei numIndices,
+    const pr_matrix4* worldViewProjectionMatrix, const pr_viewport* viewport, const pr_texcoord_transform* texCoordTransform)
+{
+    if (numIndices == 0)
+        return PR_TRUE;
+
+    const PRuint* indices = _vertex_cache_fetch_indices(vertexCache, indexBuffer, firstIndex, numIndices);
+    vertexCache->indices = indices;
+
+    // Find range of referenced vertices
+    PRuint indexMin = indices[0], indexMax = indices[0];
+
+    for (PRsizei i = 1; i < numIndices; ++i)
+    {
+        if (indexMin > indices[i])
+            indexMin = indices[i];
+        if (indexMax < indices[i])
+            indexMax = indices[i];
+    }
+
+    if (indexMax >= (PRuint)vertexBuffer->numVertices)
+        return PR_FALSE;
+
+    const PRuint numVertices = indexMax - indexMin + 1;
+
+    _vertex_cache_reserve(vertexCache, numVertices);
+    vertexCache->firstIndex = indexMin;
+
+    // Mark all referenced vertices
+    PRubyte* referenced = vertexCache->referenced;
+    memset(referenced, 0, numVertices);
+
+    for (PRsizei i = 0; i < numIndices; ++i)
+        referenced[indices[i] - indexMin] = 1;
+
+    // Transform each run of referenced vertices in a single batch
+    for (PRuint first = 0, last = 0; first < numVertices; first = last)
+    {
+        while (first < numVertices && referenced[first] == 0)
+            ++first;
+
+        last = first;
+        while (last < numVertices && referenced[last] != 0)
+            ++last;
+
+        _pr_vertex_transform_batch(
+            vertexCache->vertices + first,
+            vertexCache->screenVertices + first,
+            vertexBuffer->vertices + indexMin + first,
+            last - first,
+            worldViewProjectionMatrix,
+            viewport,
+            texCoordTransform
+        );
+    }
+
+    return PR_TRUE;
+}
+
+void _pr_vertex_cache_transform_range(
+    pr_vertex_cache* vertexCache, const pr_vertexbuffer* vertexBuffer, PRsizei firstVertex, PRsizei numVertices,
+    const pr_matrix4* worldViewProjectionMatrix, const pr_viewport* viewport, const pr_texcoord_transform* texCoordTransform)
+{
+    _vertex_cache_reserve(vertexCache, numVertices);
+    vertexCache->firstIndex = firstVertex;
+
+    _pr_vertex_transform_batch(
+        vertexCache->vertices,
+        vertexCache->screenVertices,
+        vertexBuffer->vertices + firstVertex,
+        numVertices,
+        worldViewProjectionMatrix,
+        viewport,
+        texCoordTransform
+    );
+}
@@ -0,0 +1,69 @@
+/*
+ * vertex_cache.h
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#ifndef PR_VERTEX_CACHE_H
+#define PR_VERTEX_CACHE_H
+
+
+#include "vertexbuffer.h"
+#include "indexbuffer.h"
+#include "raster_vertex.h"
+#include "matrix4.h"
+#include "viewport.h"
+
+
+/**
+Post-transform vertex cache for draw calls. All vertices which are referenced by a draw call are transformed
+exactly once into clip space and projected into screen space, and the triangle assembly fetches them by index.
+*/
+typedef struct pr_vertex_cache
+{
+    pr_clip_vertex* vertices;       //!< Transformed vertices in clip space, indexed by (vertex index - firstIndex).
+    pr_clip_vertex* screenVertices; //!< Projected vertices in screen space (only valid if no z clipping is required).
+    PRubyte*        referenced;     //!< Specifies for each vertex whether it is referenced by the index range.
+    PRuint          firstIndex;     //!< Smallest vertex index of the current draw call.
+    PRuint          capacity;
+    const PRuint*   indices;        //!< 32-bit vertex indices of the current indexed draw call.
+    PRuint*         unpackedIndices;//!< Indices which have been converted from 8- or 16-bit index buffers.
+    PRuint          indexCapacity;
+}
+pr_vertex_cache;
+
+
+void _pr_vertex_cache_init(pr_vertex_cache* vertexCache);
+void _pr_vertex_cache_release(pr_vertex_cache* vertexCache);
+
+/**
+Transforms all vertices which are referenced by the indices in the range [firstIndex, firstIndex + numIndices)
+of the specified index buffer. Afterwards these indices are available as 32-bit indices in 'vertexCache->indices'.
+\return PR_FALSE if an index is out of bounds of the vertex buffer.
+*/
+PRboolean _pr_vertex_cache_transform(
+    pr_vertex_cache* vertexCache, const pr_vertexbuffer* vertexBuffer, const pr_indexbuffer* indexBuffer, PRsizei firstIndex, PRsizei numIndices,
+    const pr_matrix4* worldViewProjectionMatrix, const pr_viewport* viewport, const pr_texcoord_transform* texCoordTransform
+);
+
+//! Transforms all vertices in the range [firstVertex, firstVertex + numVertices) of the specified vertex buffer.
+void _pr_vertex_cache_transform_range(
+    pr_vertex_cache* vertexCache, const pr_vertexbuffer* vertexBuffer, PRsizei firstVertex, PRsizei numVertices,
+    const pr_matrix4* worldViewProjectionMatrix, const pr_viewport* viewport, const pr_texcoord_transform* texCoordTransform
+);
+
+//! Returns the clip space vertex with the specified index (must be referenced by the last transformation).
+PR_INLINE const pr_clip_vertex* _pr_vertex_cache_fetch(const pr_vertex_cache* vertexCache, PRuint index)
+{
+    return &(vertexCache->vertices[index - vertexCache->firstIndex]);
+}
+
+//! Returns the screen space vertex with the specified index (must be referenced by the last transformation).
+PR_INLINE const pr_clip_vertex* _pr_vertex_cache_fetch_screen(const pr_vertex_cache* vertexCache, PRuint index)
+{
+    return &(vertexCache->screenVertices[index - vertexCache->firstIndex]);
+}
+
+
+#endif
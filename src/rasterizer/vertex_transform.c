@@ -0,0 +1,191 @@
+/*
+ * vertex_transform.c
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#include "vertex_transform.h"
+
+#include "ext_math.h"
+
+#ifdef PR_SSE2_KERNELS
+#   include <emmintrin.h>
+#endif
+
+
+// Number of packed vertices which are unpacked at once before they are transformed
+#define _UNPACK_CHUNK_SIZE 64
+
+
+// --- internals --- //
+
+static void _transform_vertex(
+    pr_clip_vertex* clipVert, pr_clip_vertex* screenVert, const pr_float_vertex* vert,
+    const pr_matrix4* matrix, const pr_viewport* viewport, const pr_texcoord_transform* texCoordTransform)
+{
+    // Transform coordinate into clip space
+    _pr_matrix_mul_float4(&(clipVert->x), matrix, &(vert->coord.x));
+    clipVert->u = vert->texCoord.x * texCoordTransform->scaleU + texCoordTransform->offsetU;
+    clipVert->v = vert->texCoord.y * texCoordTransform->scaleV + texCoordTransform->offsetV;
+
+    // Project coordinate into screen space (-0.5 moves the pixel centers to integral coordinates)
+    PRfloat rhw = 1.0f / clipVert->w;
+
+    PRfloat x = clipVert->x * rhw;
+    PRfloat y = clipVert->y * rhw;
+
+    screenVert->x = viewport->x + (x + 1.0f) * viewport->halfWidth - 0.5f;
+    screenVert->y = viewport->y + (y + 1.0f) * viewport->halfHeight - 0.5f;
+    screenVert->z = rhw;
+    screenVert->w = clipVert->w;
+
+    #ifdef PR_PERSPECTIVE_CORRECTED
+    screenVert->u = clipVert->u * rhw;
+    screenVert->v = clipVert->v * rhw;
+    #else
+    screenVert->u = clipVert->u;
+    screenVert->v = clipVert->v;
+    #endif
+}
+
+#ifdef PR_SSE2_KERNELS
+
+// Returns (lhs.m[0][row] * x) + (lhs.m[1][row] * y) + (lhs.m[2][row] * z) + (lhs.m[3][row] * w) for four vertices.
+PR_INLINE __m128 _mul_row_sse2(const pr_matrix4* lhs, PRint row, __m128 x, __m128 y, __m128 z, __m128 w)
+{
+    __m128 r = _mm_mul_ps(_mm_set1_ps(lhs->m[0][row]), x);
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(lhs->m[1][row]), y));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(lhs->m[2][row]), z));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(lhs->m[3][row]), w));
+    return r;
+}
+
+// Transforms four vertices. The arithmetic is identical to the scalar version, so both produce the same results.
+static void _transform_vertex4_sse2(
+    pr_clip_vertex* clipVerts, pr_clip_vertex* screenVerts, const pr_float_vertex* verts,
+    const pr_matrix4* matrix, const pr_viewport* viewport, const pr_texcoord_transform* texCoordTransform)
+{
+    // Load coordinates and texture coordinates as structure of arrays
+    __m128 x = _mm_loadu_ps(&(verts[0].coord.x));
+    __m128 y = _mm_loadu_ps(&(verts[1].coord.x));
+    __m128 z = _mm_loadu_ps(&(verts[2].coord.x));
+    __m128 w = _mm_loadu_ps(&(verts[3].coord.x));
+
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+
+    __m128 u = _mm_setr_ps(verts[0].texCoord.x, verts[1].texCoord.x, verts[2].texCoord.x, verts[3].texCoord.x);
+    __m128 v = _mm_setr_ps(verts[0].texCoord.y, verts[1].texCoord.y, verts[2].texCoord.y, verts[3].texCoord.y);
+
+    u = _mm_add_ps(_mm_mul_ps(u, _mm_set1_ps(texCoordTransform->scaleU)), _mm_set1_ps(texCoordTransform->offsetU));
+    v = _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(texCoordTransform->scaleV)), _mm_set1_ps(texCoordTransform->offsetV));
+
+    // Transform coordinates into clip space
+    __m128 cx = _mul_row_sse2(matrix, 0, x, y, z, w);
+    __m128 cy = _mul_row_sse2(matrix, 1, x, y, z, w);
+    __m128 cz = _mul_row_sse2(matrix, 2, x, y, z, w);
+    __m128 cw = _mul_row_sse2(matrix, 3, x, y, z, w);
+
+    // Project coordinates into screen space
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    __m128 rhw = _mm_div_ps(one, cw);
+
+    __m128 sx = _mm_add_ps(_mm_mul_ps(cx, rhw), one);
+    __m128 sy = _mm_add_ps(_mm_mul_ps(cy, rhw), one);
+
+    sx = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(viewport->x), _mm_mul_ps(sx, _mm_set1_ps(viewport->halfWidth))), half);
+    sy = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(viewport->y), _mm_mul_ps(sy, _mm_set1_ps(viewport->halfHeight))), half);
+
+    #ifdef PR_PERSPECTIVE_CORRECTED
+    __m128 su = _mm_mul_ps(u, rhw);
+    __m128 sv = _mm_mul_ps(v, rhw);
+    #else
+    __m128 su = u;
+    __m128 sv = v;
+    #endif
+
+    // Store vertices as array of structures
+    PRfloat texCoords[4][4];
+
+    _mm_storeu_ps(texCoords[0], u);
+    _mm_storeu_ps(texCoords[1], v);
+    _mm_storeu_ps(texCoords[2], su);
+    _mm_storeu_ps(texCoords[3], sv);
+
+    __m128 sw = cw;
+
+    _MM_TRANSPOSE4_PS(cx, cy, cz, cw);
+    _MM_TRANSPOSE4_PS(sx, sy, rhw, sw);
+
+    _mm_storeu_ps(&(clipVerts[0].x), cx);
+    _mm_storeu_ps(&(clipVerts[1].x), cy);
+    _mm_storeu_ps(&(clipVerts[2].x), cz);
+    _mm_storeu_ps(&(clipVerts[3].x), cw);
+
+    _mm_storeu_ps(&(screenVerts[0].x), sx);
+    _mm_storeu_ps(&(screenVerts[1].x), sy);
+    _mm_storeu_ps(&(screenVerts[2].x), rhw);
+    _mm_storeu_ps(&(screenVerts[3].x), sw);
+
+    for (PRint i = 0; i < 4; ++i)
+    {
+        clipVerts[i].u = texCoords[0][i];
+        clipVerts[i].v = texCoords[1][i];
+        screenVerts[i].u = texCoords[2][i];
+        screenVerts[i].v = texCoords[3][i];
+    }
+}
+
+#endif
+
+static void _transform_vertices(
+    pr_clip_vertex* clipVertices, pr_clip_vertex* screenVertices, const pr_float_vertex* vertices, PRuint numVertices,
+    const pr_matrix4* worldViewProjectionMatrix, const pr_viewport* viewport, const pr_texcoord_transform* texCoordTransform)
+{
+    PRuint i = 0;
+
+    #ifdef PR_SSE2_KERNELS
+    for (; i + 4 <= numVertices; i += 4)
+    {
+        _transform_vertex4_sse2(
+            clipVertices + i, screenVertices + i, vertices + i, worldViewProjectionMatrix, viewport, texCoordTransform
+        );
+    }
+    #endif
+
+    // Transform remaining vertices
+    for (; i < numVertices; ++i)
+    {
+        _transform_vertex(
+            clipVertices + i, screenVertices + i, vertices + i, worldViewProjectionMatrix, viewport, texCoordTransform
+        );
+    }
+}
+
+// --- interface --- //
+
+void _pr_vertex_transform_batch(
+    pr_clip_vertex* clipVertices, pr_clip_vertex* screenVertices, const pr_vertex* vertices, PRuint numVertices,
+    const pr_matrix4* worldViewProjectionMatrix, const pr_viewport* viewport, const pr_texcoord_transform* texCoordTransform)
+{
+    #ifdef PR_PACKED_VERTICES
+
+    // Unpack vertices in small chunks, which stay in the L1 cache until they are transformed
+    pr_float_vertex chunk[_UNPACK_CHUNK_SIZE];
+
+    for (PRuint i = 0; i < numVertices; i += _UNPACK_CHUNK_SIZE)
+    {
+        const PRuint count = PR_MIN(numVertices - i, _UNPACK_CHUNK_SIZE);
+
+        _pr_vertex_unpack(chunk, vertices + i, count);
+        _transform_vertices(clipVertices + i, screenVertices + i, chunk, count, worldViewProjectionMatrix, viewport, texCoordTransform);
+    }
+
+    #else
+
+    _transform_vertices(clipVertices, screenVertices, vertices, numVertices, worldViewProjectionMatrix, viewport, texCoordTransform);
+
+    #endif
+}
@@ -0,0 +1,32 @@
+/*
+ * vertex_transform.h
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#ifndef PR_VERTEX_TRANSFORM_H
+#define PR_VERTEX_TRANSFORM_H
+
+
+#include "vertex.h"
+#include "raster_vertex.h"
+#include "matrix4.h"
+#include "viewport.h"
+#include "static_config.h"
+
+
+/**
+Transforms the specified vertices into clip space (for clipping) and projects them into screen space in a single pass.
+The screen space vertices have the same layout as the clip vertices after projection: x and y are screen coordinates
+(pixel centers at integral coordinates), z is the reciprocal homogeneous w, and u and v are divided by w
+if PR_PERSPECTIVE_CORRECTED is defined. The texture coordinates are transformed by 'texCoordTransform' before. With SSE2, four vertices are transformed at a time.
+With PR_PACKED_VERTICES, the vertices are unpacked in small chunks right before they are transformed.
+*/
+void _pr_vertex_transform_batch(
+    pr_clip_vertex* clipVertices, pr_clip_vertex* screenVertices, const pr_vertex* vertices, PRuint numVertices,
+    const pr_matrix4* worldViewProjectionMatrix, const pr_viewport* viewport, const pr_texcoord_transform* texCoordTransform
+);
+
+
+#endif
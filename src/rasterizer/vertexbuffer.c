@@ -10,8 +10,12 @@
 #include "error.h"
 #include "helper.h"
 #include "static_config.h"
+#include "ext_math.h"
+#include "file_mapping.h"
 
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 pr_vertexbuffer* _pr_vertexbuffer_create()
@@ -52,53 +56,6 @@ void _pr_vertexbuffer_singular_clear(pr_vertexbuffer* vertexBuffer)
         PR_FREE(vertexBuffer->vertices);
 }
 
-//!REMOVE THIS!
-static void _vertex_transform(
-    pr_vertex* vertex, const pr_matrix4* worldViewProjectionMatrix, const pr_viewport* viewport)
-{
-    // Transform view-space coordinate into projection space
-    _pr_matrix_mul_float4(&(vertex->ndc.x), worldViewProjectionMatrix, &(vertex->coord.x));
-
-    // Transform coordinate into normalized device coordinates
-    vertex->ndc.z = 1.0f / vertex->ndc.w;
-    vertex->ndc.x *= vertex->ndc.z;
-    vertex->ndc.y *= vertex->ndc.z;
-
-    // Transform vertex to screen coordiante (+0.5 is for rounding adjustment)
-    vertex->ndc.x = viewport->x + (vertex->ndc.x + 1.0f) * viewport->halfWidth + 0.5f;
-    vertex->ndc.y = viewport->y + (vertex->ndc.y + 1.0f) * viewport->halfHeight + 0.5f;
-    //vertex->ndc.z = viewport->minDepth + vertex->ndc.z * viewport->depthSize;
-
-    #ifdef PR_PERSPECTIVE_CORRECTED
-    // Setup inverse-texture coordinates
-    vertex->invTexCoord.x = vertex->texCoord.x * vertex->ndc.z;
-    vertex->invTexCoord.y = vertex->texCoord.y * vertex->ndc.z;
-    #endif
-}
-
-void _pr_vertexbuffer_transform(
-    PRsizei numVertices, PRsizei firstVertex, pr_vertexbuffer* vertexBuffer,
-    const pr_matrix4* worldViewProjectionMatrix, const pr_viewport* viewport)
-{
-    const PRsizei lastVertex = numVertices + firstVertex;
-
-    if (lastVertex >= vertexBuffer->numVertices)
-    {
-        _pr_error_set(PR_ERROR_INDEX_OUT_OF_BOUNDS, __FUNCTION__);
-        return;
-    }
-
-    for (PRsizei i = firstVertex; i < lastVertex; ++i)
-        _vertex_transform((vertexBuffer->vertices + i), worldViewProjectionMatrix, viewport);
-}
-
-void _pr_vertexbuffer_transform_all(
-    pr_vertexbuffer* vertexBuffer, const pr_matrix4* worldViewProjectionMatrix, const pr_viewport* viewport)
-{
-    for (PRsizei i = 0; i < vertexBuffer->numVertices; ++i)
-        _vertex_transform((vertexBuffer->vertices + i), worldViewProjectionMatrix, viewport);
-}
-
 static void _vertexbuffer_resize(pr_vertexbuffer* vertexBuffer, PRsizei numVertices)
 {
     // Check if vertex buffer must be reallocated
@@ -135,43 +92,41 @@ void _pr_vertexbuffer_data(pr_vertexbuffer* vertexBuffer, PRsizei numVertices, c
         if (coordsByteAlign != NULL)
         {
             const PRfloat* coord = (const PRfloat*)coordsByteAlign;
-
-            vert->coord.x = coord[0];
-            vert->coord.y = coord[1];
-            vert->coord.z = coord[2];
-            vert->coord.w = 1.0f;//coord[3];
-
+            _pr_vertex_set_coord(vert, coord[0], coord[1], coord[2], 1.0f);
             coordsByteAlign += vertexStride;
         }
         else
-        {
-            vert->coord.x = 0.0f;
-            vert->coord.y = 0.0f;
-            vert->coord.z = 0.0f;
-            vert->coord.w = 1.0f;
-        }
+            _pr_vertex_set_coord(vert, 0.0f, 0.0f, 0.0f, 1.0f);
 
         // Copy texture coordinates
         if (texCoordsByteAlign != NULL)
         {
             const PRfloat* texCoord = (const PRfloat*)texCoordsByteAlign;
-
-            vert->texCoord.x = texCoord[0];
-            vert->texCoord.y = texCoord[1];
-
+            _pr_vertex_set_texcoord(vert, texCoord[0], texCoord[1]);
             texCoordsByteAlign += vertexStride;
         }
         else
-        {
-            vert->texCoord.x = 0.0f;
-            vert->texCoord.y = 0.0f;
-        }
+            _pr_vertex_set_texcoord(vert, 0.0f, 0.0f);
 
         // Next vertex
         ++vert;
     }
 }
 
+// Converts the specified packed vertices (see 'PRvertex') in a single pass. The source data must not be aligned.
+static void _vertexbuffer_convert(pr_vertex* dst, const PRubyte* src, PRsizei numVertices)
+{
+    PRvertex data;
+
+    for (PRsizei i = 0; i < numVertices; ++i, src += sizeof(PRvertex))
+    {
+        memcpy(&data, src, sizeof(PRvertex));
+
+        _pr_vertex_set_coord(dst + i, data.x, data.y, data.z, 1.0f);
+        _pr_vertex_set_texcoord(dst + i, data.u, data.v);
+    }
+}
+
 void _pr_vertexbuffer_data_from_file(pr_vertexbuffer* vertexBuffer, PRsizei* numVertices, FILE* file)
 {
     if (vertexBuffer == NULL || numVertices == NULL || file == NULL)
@@ -183,34 +138,93 @@ void _pr_vertexbuffer_data_from_file(pr_vertexbuffer* vertexBuffer, PRsizei* num
     // Read number of vertices
     PRushort vertCount = 0;
     fread(&vertCount, sizeof(PRushort), 1, file);
-    *numVertices = (PRsizei)vertCount;
+
+    PRuint vertCount32 = vertCount;
+
+    if (vertCount == PR_FILE_EXTENDED_HEADER && _pr_file_read_extended_magic(file))
+    {
+        // Read 32-bit number of vertices
+        vertCount32 = 0;
+        fread(&vertCount32, sizeof(PRuint), 1, file);
+    }
+
+    // Check that all vertices are inside the file before allocating them
+    if (vertCount32 > INT_MAX || _pr_file_remaining_size(file) / sizeof(PRvertex) < vertCount32)
+    {
+        *numVertices = 0;
+        PR_ERROR(PR_ERROR_UNEXPECTED_EOF);
+        return;
+    }
+
+    *numVertices = (PRsizei)vertCount32;
 
     _vertexbuffer_resize(vertexBuffer, *numVertices);
 
-    // Read all vertices
-    PRvertex data;
-    pr_vertex* vert = vertexBuffer->vertices;
+    // Read all vertices in chunks
+    PRubyte chunk[sizeof(PRvertex) * 256];
 
-    for (PRushort i = 0; i < *numVertices; ++i)
+    for (PRsizei i = 0; i < *numVertices;)
     {
-        if (feof(file))
+        const PRsizei count = PR_MIN(*numVertices - i, 256);
+
+        if (fread(chunk, sizeof(PRvertex), (size_t)count, file) != (size_t)count)
         {
             PR_ERROR(PR_ERROR_UNEXPECTED_EOF);
             return;
         }
 
-        // Read next vertex data
-        fread(&data, sizeof(PRvertex), 1, file);
+        _vertexbuffer_convert(vertexBuffer->vertices + i, chunk, count);
+        i += count;
+    }
+}
 
-        vert->coord.x = data.x;
-        vert->coord.y = data.y;
-        vert->coord.z = data.z;
-        vert->coord.w = 1.0f;
+size_t _pr_vertexbuffer_data_from_memory(pr_vertexbuffer* vertexBuffer, PRsizei* numVertices, const PRubyte* data, size_t size)
+{
+    if (vertexBuffer == NULL || numVertices == NULL || data == NULL)
+    {
+        PR_ERROR(PR_ERROR_NULL_POINTER);
+        return 0;
+    }
 
-        vert->texCoord.x = data.u;
-        vert->texCoord.y = data.v;
+    // Read number of vertices
+    size_t offset = sizeof(PRushort);
+    PRushort vertCount = 0;
+    PRuint vertCount32 = 0;
 
-        ++vert;
+    if (size < offset)
+    {
+        PR_ERROR(PR_ERROR_UNEXPECTED_EOF);
+        return 0;
     }
-}
 
+    memcpy(&vertCount, data, sizeof(PRushort));
+    vertCount32 = vertCount;
+
+    if (vertCount == PR_FILE_EXTENDED_HEADER && _pr_file_has_extended_magic(data + offset, size - offset))
+    {
+        // Read 32-bit number of vertices
+        offset += sizeof(PRuint);
+
+        if (size < offset + sizeof(PRuint))
+        {
+            PR_ERROR(PR_ERROR_UNEXPECTED_EOF);
+            return 0;
+        }
+        memcpy(&vertCount32, data + offset, sizeof(PRuint));
+        offset += sizeof(PRuint);
+    }
+
+    // Check that all vertices are inside the memory block
+    if (vertCount32 > INT_MAX || (size - offset) / sizeof(PRvertex) < vertCount32)
+    {
+        PR_ERROR(PR_ERROR_UNEXPECTED_EOF);
+        return 0;
+    }
+
+    *numVertices = (PRsizei)vertCount32;
+
+    _vertexbuffer_resize(vertexBuffer, *numVertices);
+    _vertexbuffer_convert(vertexBuffer->vertices, data + offset, *numVertices);
+
+    return offset + sizeof(PRvertex) * vertCount32;
+}
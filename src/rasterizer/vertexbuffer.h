@@ -30,22 +30,14 @@ void _pr_vertexbuffer_delete(pr_vertexbuffer* vertexBuffer);
 void _pr_vertexbuffer_singular_init(pr_vertexbuffer* vertexBuffer, PRsizei numVertices);
 void _pr_vertexbuffer_singular_clear(pr_vertexbuffer* vertexBuffer);
 
-void _pr_vertexbuffer_transform(
-    PRsizei numVertices,
-    PRsizei firstVertex,
-    pr_vertexbuffer* vertexBuffer,
-    const pr_matrix4* worldViewProjectionMatrix,
-    const pr_viewport* viewport
-);
-
-void _pr_vertexbuffer_transform_all(
-    pr_vertexbuffer* vertexBuffer,
-    const pr_matrix4* worldViewProjectionMatrix,
-    const pr_viewport* viewport
-);
-
 void _pr_vertexbuffer_data(pr_vertexbuffer* vertexBuffer, PRsizei numVertices, const PRvoid* coords, const PRvoid* texCoords, PRsizei vertexStride);
 void _pr_vertexbuffer_data_from_file(pr_vertexbuffer* vertexBuffer, PRsizei* numVertices, FILE* file);
 
+/**
+Sets the vertex buffer data from the specified memory block, which has the same format as a file for '_pr_vertexbuffer_data_from_file'.
+\return Number of bytes which have been read from the memory block, or 0 on failure.
+*/
+size_t _pr_vertexbuffer_data_from_memory(pr_vertexbuffer* vertexBuffer, PRsizei* numVertices, const PRubyte* data, size_t size);
+
 
 #endif
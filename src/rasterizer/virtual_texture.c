@@ -0,0 +1,434 @@
+/*
+ * virtual_texture.c
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#include "virtual_texture.h"
+#include "texture.h"
+#include "color_palette.h"
+#include "ext_math.h"
+#include "error.h"
+#include "helper.h"
+#include "thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+// Number of bytes of a single page inside a virtual texture file
+#define _PAGE_SIZE_IN_BYTES (PR_VIRTUAL_PAGE_SIZE*PR_VIRTUAL_PAGE_SIZE*3)
+
+
+// --- internals --- //
+
+// Returns the number of MIP levels (down to a size of 1x1) for the specified texture size.
+static PRuint _virtual_texture_num_mips(PRuint width, PRuint height)
+{
+    PRuint size = PR_MAX(width, height);
+    PRuint mips = 1;
+
+    while (size > 1)
+    {
+        size /= 2;
+        ++mips;
+    }
+
+    return mips;
+}
+
+// Returns the number of pages per row (or per column) of a MIP level with the specified width (or height).
+static PRuint _virtual_texture_num_pages(PRuint size)
+{
+    return (size + PR_VIRTUAL_PAGE_MASK) >> PR_VIRTUAL_PAGE_SHIFT;
+}
+
+// Reads the RGB texels of the specified page into the page buffer.
+static PRboolean _virtual_texture_read_page(pr_virtual_texture* virtualTexture, PRubyte mip, PRuint pageX, PRuint pageY)
+{
+    const long offset = virtualTexture->fileOffsets[mip] +
+        (long)(pageY * virtualTexture->numPagesX[mip] + pageX) * _PAGE_SIZE_IN_BYTES;
+
+    return
+        fseek(virtualTexture->file, offset, SEEK_SET) == 0 &&
+        fread(virtualTexture->pageBuffer, 1, _PAGE_SIZE_IN_BYTES, virtualTexture->file) == _PAGE_SIZE_IN_BYTES;
+}
+
+/*
+Returns a free cache slot, or evicts the least recently used page which was not used since the last update.
+Returns -1 if all pages in the cache were used since the last update.
+*/
+static PRint _virtual_texture_alloc_slot(pr_virtual_texture* virtualTexture)
+{
+    PRint lru = -1;
+
+    for (PRuint i = 0; i < virtualTexture->numSlots; ++i)
+    {
+        const pr_virtual_cache_slot* slot = &(virtualTexture->slots[i]);
+
+        if (slot->page == NULL)
+            return (PRint)i;
+
+        if ( slot->lastUsed != virtualTexture->counter &&
+             ( lru < 0 || slot->lastUsed < virtualTexture->slots[lru].lastUsed ) )
+        {
+            lru = (PRint)i;
+        }
+    }
+
+    if (lru >= 0)
+    {
+        // Evict page
+        virtualTexture->slots[lru].page->slot = PR_VIRTUAL_PAGE_MISSING;
+        virtualTexture->slots[lru].page = NULL;
+    }
+
+    return lru;
+}
+
+// Loads the specified page into a cache slot. Returns PR_FALSE if the page cache is full.
+static PRboolean _virtual_texture_load_page(pr_virtual_texture* virtualTexture, PRubyte mip, PRuint pageX, PRuint pageY)
+{
+    pr_virtual_page* page = virtualTexture->pageTables[mip] + pageY * virtualTexture->numPagesX[mip] + pageX;
+
+    const PRint slot = _virtual_texture_alloc_slot(virtualTexture);
+    if (slot < 0)
+        return PR_FALSE;
+
+    if (!_virtual_texture_read_page(virtualTexture, mip, pageX, pageY))
+    {
+        _pr_error_set(PR_ERROR_UNEXPECTED_EOF, "failed to read page from virtual texture file");
+        return PR_TRUE;
+    }
+
+    // Convert page texels into color indices
+    PRcolorindex* dst = virtualTexture->cache + ((size_t)slot << (PR_VIRTUAL_PAGE_SHIFT*2));
+    const PRubyte* src = virtualTexture->pageBuffer;
+
+    for (PRuint i = 0; i < PR_VIRTUAL_PAGE_SIZE*PR_VIRTUAL_PAGE_SIZE; ++i, src += 3)
+        dst[i] = _pr_color_to_colorindex(src[0], src[1], src[2]);
+
+    // Map page to the cache slot
+    virtualTexture->slots[slot].page        = page;
+    virtualTexture->slots[slot].lastUsed    = virtualTexture->counter;
+    page->slot = slot;
+
+    return PR_TRUE;
+}
+
+// Scales down the specified RGB image by half with a 2x2 box filter.
+static void _virtual_texture_scale_down(PRubyte* dst, const PRubyte* src, PRuint width, PRuint height)
+{
+    const PRuint scaledWidth = PR_MAX(1, width/2);
+    const PRuint scaledHeight = PR_MAX(1, height/2);
+
+    for (PRuint y = 0; y < scaledHeight; ++y)
+    {
+        const PRubyte* row0 = src + (y*2)*width*3;
+        const PRubyte* row1 = src + PR_MIN(y*2 + 1, height - 1)*width*3;
+
+        for (PRuint x = 0; x < scaledWidth; ++x)
+        {
+            const PRuint x0 = x*2*3;
+            const PRuint x1 = PR_MIN(x*2 + 1, width - 1)*3;
+
+            for (PRuint i = 0; i < 3; ++i, ++dst)
+                *dst = (PRubyte)(((PRuint)row0[x0 + i] + row0[x1 + i] + row1[x0 + i] + row1[x1 + i]) / 4);
+        }
+    }
+}
+
+// Writes all pages of the specified RGB MIP level into the virtual texture file.
+static PRboolean _virtual_texture_write_level(FILE* file, PRubyte* pageBuffer, const PRubyte* data, PRuint width, PRuint height)
+{
+    const PRuint numPagesX = _virtual_texture_num_pages(width);
+    const PRuint numPagesY = _virtual_texture_num_pages(height);
+
+    for (PRuint pageY = 0; pageY < numPagesY; ++pageY)
+    {
+        for (PRuint pageX = 0; pageX < numPagesX; ++pageX)
+        {
+            // Copy page rows from the image, border pages are padded with zeros
+            const PRuint left = pageX*PR_VIRTUAL_PAGE_SIZE;
+            const PRuint top = pageY*PR_VIRTUAL_PAGE_SIZE;
+            const PRuint rowSize = PR_MIN(PR_VIRTUAL_PAGE_SIZE, width - left)*3;
+
+            memset(pageBuffer, 0, _PAGE_SIZE_IN_BYTES);
+
+            for (PRuint y = 0; y < PR_VIRTUAL_PAGE_SIZE && top + y < height; ++y)
+                memcpy(pageBuffer + y*PR_VIRTUAL_PAGE_SIZE*3, data + ((top + y)*width + left)*3, rowSize);
+
+            if (fwrite(pageBuffer, 1, _PAGE_SIZE_IN_BYTES, file) != _PAGE_SIZE_IN_BYTES)
+                return PR_FALSE;
+        }
+    }
+
+    return PR_TRUE;
+}
+
+// --- interface --- //
+
+pr_virtual_texture* _pr_virtual_texture_create(const char* filename, PRuint numCachePages)
+{
+    if (filename == NULL)
+    {
+        _pr_error_set(PR_ERROR_NULL_POINTER, __FUNCTION__);
+        return NULL;
+    }
+    if (numCachePages == 0)
+    {
+        _pr_error_set(PR_ERROR_INVALID_ARGUMENT, "page cache of virtual texture must not be empty");
+        return NULL;
+    }
+
+    // Open file and read header
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        _pr_error_set(PR_ERROR_INVALID_ARGUMENT, "failed to open virtual texture file");
+        return NULL;
+    }
+
+    pr_virtual_texture_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1)
+    {
+        _pr_error_set(PR_ERROR_UNEXPECTED_EOF, "failed to read virtual texture header");
+        fclose(file);
+        return NULL;
+    }
+
+    if ( header.magic != PR_VIRTUAL_TEXTURE_MAGIC || header.pageShift != PR_VIRTUAL_PAGE_SHIFT ||
+         header.width == 0 || header.width > PR_MAX_VIRTUAL_TEX_SIZE ||
+         header.height == 0 || header.height > PR_MAX_VIRTUAL_TEX_SIZE ||
+         header.numMips != _virtual_texture_num_mips(header.width, header.height) )
+    {
+        _pr_error_set(PR_ERROR_INVALID_ARGUMENT, "invalid virtual texture header");
+        fclose(file);
+        return NULL;
+    }
+
+    // Create virtual texture
+    pr_virtual_texture* virtualTexture = PR_CALLOC(pr_virtual_texture, 1);
+
+    virtualTexture->file    = file;
+    virtualTexture->numMips = (PRubyte)header.numMips;
+    virtualTexture->tailMip = virtualTexture->numMips;
+
+    // Setup MIP level dimensions and file offsets
+    long offset = (long)sizeof(header);
+
+    for (PRubyte mip = 0; mip < virtualTexture->numMips; ++mip)
+    {
+        const PRuint width = PR_MAX(1, header.width >> mip);
+        const PRuint height = PR_MAX(1, header.height >> mip);
+
+        virtualTexture->widths[mip]         = (PRtexsize)width;
+        virtualTexture->heights[mip]        = (PRtexsize)height;
+        virtualTexture->numPagesX[mip]      = _virtual_texture_num_pages(width);
+        virtualTexture->fileOffsets[mip]    = offset;
+
+        const PRuint numLevelPages = virtualTexture->numPagesX[mip] * _virtual_texture_num_pages(height);
+
+        if (numLevelPages == 1 && virtualTexture->tailMip == virtualTexture->numMips)
+            virtualTexture->tailMip = mip;
+        if (mip < virtualTexture->tailMip)
+            virtualTexture->numPages += numLevelPages;
+
+        offset += (long)numLevelPages * _PAGE_SIZE_IN_BYTES;
+    }
+
+    // Create page tables (all pages are missing)
+    virtualTexture->pages = PR_CALLOC(pr_virtual_page, PR_MAX(1, virtualTexture->numPages));
+
+    for (PRuint i = 0; i < virtualTexture->numPages; ++i)
+        virtualTexture->pages[i].slot = PR_VIRTUAL_PAGE_MISSING;
+
+    pr_virtual_page* pageTable = virtualTexture->pages;
+
+    for (PRubyte mip = 0; mip < virtualTexture->tailMip; ++mip)
+    {
+        virtualTexture->pageTables[mip] = pageTable;
+        pageTable += virtualTexture->numPagesX[mip] * _virtual_texture_num_pages(virtualTexture->heights[mip]);
+    }
+
+    // Create page cache
+    virtualTexture->numSlots    = numCachePages;
+    virtualTexture->slots       = PR_CALLOC(pr_virtual_cache_slot, numCachePages);
+    virtualTexture->cache       = PR_CALLOC(PRcolorindex, (size_t)numCachePages << (PR_VIRTUAL_PAGE_SHIFT*2));
+    virtualTexture->pageBuffer  = PR_CALLOC(PRubyte, _PAGE_SIZE_IN_BYTES);
+
+    return virtualTexture;
+}
+
+void _pr_virtual_texture_delete(pr_virtual_texture* virtualTexture)
+{
+    if (virtualTexture != NULL)
+    {
+        fclose(virtualTexture->file);
+
+        PR_FREE(virtualTexture->pages);
+        PR_FREE(virtualTexture->slots);
+        PR_FREE(virtualTexture->cache);
+        PR_FREE(virtualTexture->pageBuffer);
+        PR_FREE(virtualTexture);
+    }
+}
+
+PRboolean _pr_virtual_texture_read_tail(pr_virtual_texture* virtualTexture, PRubyte mip, PRcolorindex* texels)
+{
+    if (!_virtual_texture_read_page(virtualTexture, mip, 0, 0))
+    {
+        _pr_error_set(PR_ERROR_UNEXPECTED_EOF, "failed to read MIP tail from virtual texture file");
+        return PR_FALSE;
+    }
+
+    const PRuint width = (PRuint)virtualTexture->widths[mip];
+    const PRuint height = (PRuint)virtualTexture->heights[mip];
+
+    for (PRuint y = 0; y < height; ++y)
+    {
+        const PRubyte* src = virtualTexture->pageBuffer + y*PR_VIRTUAL_PAGE_SIZE*3;
+
+        for (PRuint x = 0; x < width; ++x, src += 3)
+            *texels++ = _pr_color_to_colorindex(src[0], src[1], src[2]);
+    }
+
+    return PR_TRUE;
+}
+
+void _pr_virtual_texture_update(pr_virtual_texture* virtualTexture)
+{
+    // Load requested pages from the coarsest to the finest MIP level, since coarser pages are the fallback for finer pages
+    for (PRubyte mip = virtualTexture->tailMip; mip-- > 0;)
+    {
+        const PRuint numPagesX = virtualTexture->numPagesX[mip];
+        const PRuint numPagesY = _virtual_texture_num_pages(virtualTexture->heights[mip]);
+
+        for (PRuint pageY = 0; pageY < numPagesY; ++pageY)
+        {
+            for (PRuint pageX = 0; pageX < numPagesX; ++pageX)
+            {
+                pr_virtual_page* page = virtualTexture->pageTables[mip] + pageY * numPagesX + pageX;
+
+                if (page->requested == PR_FALSE)
+                    continue;
+
+                if (page->slot == PR_VIRTUAL_PAGE_MISSING && !_virtual_texture_load_page(virtualTexture, mip, pageX, pageY))
+                {
+                    // Page cache is full, keep the remaining requests for the next update
+                    ++virtualTexture->counter;
+                    return;
+                }
+
+                page->requested = PR_FALSE;
+            }
+        }
+    }
+
+    ++virtualTexture->counter;
+}
+
+PRcolorindex _pr_virtual_texture_fetch(pr_virtual_texture* virtualTexture, PRubyte mip, PRuint x, PRuint y)
+{
+    for (; mip < virtualTexture->tailMip; ++mip)
+    {
+        pr_virtual_page* page = virtualTexture->pageTables[mip] +
+            (y >> PR_VIRTUAL_PAGE_SHIFT) * virtualTexture->numPagesX[mip] + (x >> PR_VIRTUAL_PAGE_SHIFT);
+
+        const PRint slot = page->slot;
+
+        if (slot != PR_VIRTUAL_PAGE_MISSING)
+        {
+            // Mark page as used (only write on change, to keep the cache lines of other worker threads valid)
+            pr_virtual_cache_slot* cacheSlot = &(virtualTexture->slots[slot]);
+            if (_pr_atomic_load_relaxed(&(cacheSlot->lastUsed)) != virtualTexture->counter)
+                _pr_atomic_store_relaxed(&(cacheSlot->lastUsed), virtualTexture->counter);
+
+            return virtualTexture->cache[
+                ((size_t)slot << (PR_VIRTUAL_PAGE_SHIFT*2)) +
+                ((y & PR_VIRTUAL_PAGE_MASK) << PR_VIRTUAL_PAGE_SHIFT) +
+                (x & PR_VIRTUAL_PAGE_MASK)
+            ];
+        }
+
+        // Request missing page and fall back to the next coarser MIP level
+        if (_pr_atomic_load_relaxed(&(page->requested)) == PR_FALSE)
+            _pr_atomic_store_relaxed(&(page->requested), PR_TRUE);
+
+        x = PR_MIN(x >> 1, (PRuint)virtualTexture->widths[mip + 1] - 1);
+        y = PR_MIN(y >> 1, (PRuint)virtualTexture->heights[mip + 1] - 1);
+    }
+
+    // Sample from the resident MIP tail
+    return _pr_texture_fetch(&(virtualTexture->levels[mip]), x, y);
+}
+
+PRboolean _pr_virtual_texture_write(const char* filename, PRuint width, PRuint height, const PRubyte* data)
+{
+    if (filename == NULL || data == NULL)
+    {
+        _pr_error_set(PR_ERROR_NULL_POINTER, __FUNCTION__);
+        return PR_FALSE;
+    }
+    if (width == 0 || width > PR_MAX_VIRTUAL_TEX_SIZE || height == 0 || height > PR_MAX_VIRTUAL_TEX_SIZE)
+    {
+        _pr_error_set(PR_ERROR_INVALID_ARGUMENT, "invalid virtual texture size");
+        return PR_FALSE;
+    }
+
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        _pr_error_set(PR_ERROR_INVALID_ARGUMENT, "failed to create virtual texture file");
+        return PR_FALSE;
+    }
+
+    // Write header
+    pr_virtual_texture_header header;
+    header.magic        = PR_VIRTUAL_TEXTURE_MAGIC;
+    header.width        = width;
+    header.height       = height;
+    header.pageShift    = PR_VIRTUAL_PAGE_SHIFT;
+    header.numMips      = _virtual_texture_num_mips(width, height);
+
+    PRboolean result = (fwrite(&header, sizeof(header), 1, file) == 1);
+
+    // Write pages of all MIP levels, each level is scaled down from the previous one
+    PRubyte* pageBuffer = PR_CALLOC(PRubyte, _PAGE_SIZE_IN_BYTES);
+    PRubyte* levels[2] = { NULL, NULL };
+    const PRubyte* level = data;
+
+    for (PRuint mip = 0; result && mip < header.numMips; ++mip)
+    {
+        result = _virtual_texture_write_level(file, pageBuffer, level, width, height);
+
+        if (mip + 1 < header.numMips)
+        {
+            PRubyte* scaled = levels[mip % 2];
+            if (scaled == NULL)
+            {
+                // The first scaled level is the largest one, so both buffers can be reused for all coarser levels
+                scaled = PR_CALLOC(PRubyte, (size_t)PR_MAX(1, width/2)*PR_MAX(1, height/2)*3);
+                levels[mip % 2] = scaled;
+            }
+
+            _virtual_texture_scale_down(scaled, level, width, height);
+
+            level   = scaled;
+            width   = PR_MAX(1, width/2);
+            height  = PR_MAX(1, height/2);
+        }
+    }
+
+    PR_FREE(levels[0]);
+    PR_FREE(levels[1]);
+    PR_FREE(pageBuffer);
+
+    fclose(file);
+
+    if (!result)
+        _pr_error_set(PR_ERROR_INVALID_STATE, "failed to write virtual texture file");
+
+    return result;
+}
@@ -0,0 +1,121 @@
+/*
+ * virtual_texture.h
+ *
+ * This file is part of the "PicoRenderer" (Copyright (c) 2014 by Lukas Hermanns)
+ * See "LICENSE.txt" for license information.
+ */
+
+#ifndef PR_VIRTUAL_TEXTURE_H
+#define PR_VIRTUAL_TEXTURE_H
+
+
+#include "types.h"
+#include "color.h"
+
+#include <stdio.h>
+
+
+// Maximal 15 MIP-maps restricts the virtual textures to have a
+// maximum size of (2^(15-1) = 16384) in width and height.
+#define PR_MAX_NUM_VIRTUAL_MIPS     15
+#define PR_MAX_VIRTUAL_TEX_SIZE     16384
+
+// Virtual textures are paged in squares of (2^PR_VIRTUAL_PAGE_SHIFT)^2 texels.
+#define PR_VIRTUAL_PAGE_SHIFT       7
+#define PR_VIRTUAL_PAGE_SIZE        (1 << PR_VIRTUAL_PAGE_SHIFT)
+#define PR_VIRTUAL_PAGE_MASK        (PR_VIRTUAL_PAGE_SIZE - 1)
+
+#define PR_VIRTUAL_PAGE_MISSING     (-1)
+
+// Magic number of virtual texture files ("PRVT" in little endian).
+#define PR_VIRTUAL_TEXTURE_MAGIC    0x54565250
+
+
+struct pr_texture_level;
+
+/**
+Header of a virtual texture file. It is followed by the pages of all MIP levels, from the finest to the coarsest level.
+Each level stores its pages row by row, and each page stores PR_VIRTUAL_PAGE_SIZE^2 RGB texels row by row
+(texels of border pages which are outside the MIP level are zero).
+*/
+typedef struct pr_virtual_texture_header
+{
+    PRuint magic;       //!< Must be PR_VIRTUAL_TEXTURE_MAGIC.
+    PRuint width;       //!< Width of the first MIP level.
+    PRuint height;      //!< Height of the first MIP level.
+    PRuint pageShift;   //!< Must be PR_VIRTUAL_PAGE_SHIFT.
+    PRuint numMips;     //!< Number of MIP levels, down to a size of 1x1.
+}
+pr_virtual_texture_header;
+
+//! Page table entry of a virtual texture.
+typedef struct pr_virtual_page
+{
+    PRint       slot;       //!< Cache slot which holds the page, or PR_VIRTUAL_PAGE_MISSING.
+    PRuint      requested;  //!< Set by the samplers when the page was missing (written by all worker threads).
+}
+pr_virtual_page;
+
+//! Slot of the page cache of a virtual texture.
+typedef struct pr_virtual_cache_slot
+{
+    pr_virtual_page*    page;       //!< Page which occupies this slot, or null.
+    PRuint              lastUsed;   //!< Update counter of the last access (for LRU eviction; written by all worker threads).
+}
+pr_virtual_cache_slot;
+
+/**
+Virtual texture whose MIP levels are paged in on demand from a virtual texture file into a page cache of fixed size.
+All MIP levels which fit into a single page (the MIP tail) are always resident.
+*/
+typedef struct pr_virtual_texture
+{
+    FILE*                           file;
+    PRubyte                         numMips;
+    PRubyte                         tailMip;                                //!< First MIP level of the MIP tail.
+    PRtexsize                       widths[PR_MAX_NUM_VIRTUAL_MIPS];
+    PRtexsize                       heights[PR_MAX_NUM_VIRTUAL_MIPS];
+    PRuint                          numPagesX[PR_MAX_NUM_VIRTUAL_MIPS];     //!< Number of pages per row of each MIP level.
+    long                            fileOffsets[PR_MAX_NUM_VIRTUAL_MIPS];   //!< File offsets of the first page of each MIP level.
+    pr_virtual_page*                pageTables[PR_MAX_NUM_VIRTUAL_MIPS];    //!< Page table of each MIP level (outside the MIP tail).
+    pr_virtual_page*                pages;                                  //!< Page table entries of all MIP levels.
+    PRuint                          numPages;
+    PRcolorindex*                   cache;                                  //!< Texels of all cache slots.
+    pr_virtual_cache_slot*          slots;
+    PRuint                          numSlots;
+    PRuint                          counter;                                //!< Update counter, incremented with each update.
+    PRubyte*                        pageBuffer;                             //!< RGB texels of a single page (for loading).
+    const struct pr_texture_level*  levels;                                 //!< MIP levels of the owning texture (for the MIP tail).
+}
+pr_virtual_texture;
+
+
+/**
+Opens the specified virtual texture file. All pages which are outside the MIP tail are missing
+until they are requested by the samplers and loaded with '_pr_virtual_texture_update'.
+\param[in] numCachePages Specifies the number of pages in the page cache. This must be greater than 0.
+*/
+pr_virtual_texture* _pr_virtual_texture_create(const char* filename, PRuint numCachePages);
+void _pr_virtual_texture_delete(pr_virtual_texture* virtualTexture);
+
+//! Reads the specified MIP level of the MIP tail into the texels (row by row).
+PRboolean _pr_virtual_texture_read_tail(pr_virtual_texture* virtualTexture, PRubyte mip, PRcolorindex* texels);
+
+/**
+Loads all pages which were requested by the samplers since the last update, from the coarsest to the finest MIP level.
+If the page cache is full, the least recently used pages are evicted, but never the pages which were used since the last update.
+*/
+void _pr_virtual_texture_update(pr_virtual_texture* virtualTexture);
+
+/**
+Returns the specified texel of a paged MIP level. If its page is missing, the page is requested
+and the texel is sampled from the next coarser MIP level whose page is resident.
+This may be called by several worker threads at once, but not while '_pr_virtual_texture_update' is running.
+*/
+PRcolorindex _pr_virtual_texture_fetch(pr_virtual_texture* virtualTexture, PRubyte mip, PRuint x, PRuint y);
+
+//! Writes the specified RGB image with all its MIP levels into a virtual texture file.
+PRboolean _pr_virtual_texture_write(const char* filename, PRuint width, PRuint height, const PRubyte* data);
+
+
+#endif
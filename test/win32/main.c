@@ -344,7 +344,7 @@ int main()
         16,17,18,   16,18,19, // top
         20,21,22,   20,22,23, // bottom
     };
-    prIndexBufferData(indexBuffer, cubeIndices, NUM_INDICES);
+    prIndexBufferData(indexBuffer, cubeIndices, NUM_INDICES, PR_USHORT);
 
     //float size[3] = { 2.0f, 2.0f, 0.5f };
     float size[3] = { 1.0f, 1.0f, 1.0f };